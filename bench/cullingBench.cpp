@@ -0,0 +1,298 @@
+#include "headers/deviceCapabilities.hpp"
+#include "headers/drawCuller.hpp"
+#include "headers/gpuAllocator.hpp"
+#include "headers/shaderArchive.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+using benchClock = chrono::steady_clock;
+
+// a cube of scattered spheres, the camera sits in the middle and sees about a tenth of it
+static vector<vkCulling::CullInstance> makeScene(uint32_t count) {
+    mt19937 random{1234};
+    uniform_real_distribution<float> position{-500.0f, 500.0f};
+    uniform_real_distribution<float> radius{0.5f, 3.0f};
+    vector<vkCulling::CullInstance> instances(count);
+    for (uint32_t i = 0; i < count; i++) {
+        float x = position(random), y = position(random), z = position(random);
+        instances[i] = {glm::vec4{x, y, z, radius(random)}, 36, (i % 64) * 36, 0, i};
+    }
+    return instances;
+}
+
+static glm::mat4 makeViewProjection() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3{0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    return projection * view;
+}
+
+// best of n in ms, the visible count of the last run
+static double best(uint32_t repeats, const function<uint32_t()> &run, uint32_t &visible) {
+    double bestMs = 1e30;
+    for (uint32_t r = 0; r < repeats; r++) {
+        auto start = benchClock::now();
+        visible = run();
+        bestMs = min(bestMs, chrono::duration<double, milli>(benchClock::now() - start).count());
+    }
+    return bestMs;
+}
+
+static void printRow(const char *name, double ms, uint32_t visible, uint32_t instanceCount, double baseline) {
+    cout << setw(16) << name << fixed << setprecision(3) << setw(10) << ms << setprecision(1) << setw(12)
+         << instanceCount / ms / 1000.0 << setprecision(2) << setw(10) << baseline / ms << setw(10) << visible << endl;
+}
+
+// Culls the scene with the drawCuller the engine would pick on the first device, timed with timestamp queries.
+// Returns the gpu ms, 0 when there is no usable device.
+static double cullOnGpu(const vector<vkCulling::CullInstance> &instances, const glm::mat4 &viewProjection, const string &shaderPath,
+                        uint32_t repeats, uint32_t &visible, const char *&pathName) {
+    if (!filesystem::exists(shaderPath)) {
+        cout << "no shader archive at " << shaderPath << ", skipping the gpu" << endl;
+        return 0.0;
+    }
+    vkPipeline::ShaderArchive archive{shaderPath};
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "cullingBench";
+    appInfo.apiVersion = VK_API_VERSION_1_1;
+    VkInstanceCreateInfo instanceInfo{};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    VkInstance instance;
+    if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+        cout << "no vulkan instance, skipping the gpu" << endl;
+        return 0.0;
+    }
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    vector<VkPhysicalDevice> physicalDevices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data());
+    DeviceCapabilities capabilities;
+    for (auto physicalDevice : physicalDevices) {
+        capabilities = queryDeviceCapabilities(physicalDevice, VK_NULL_HANDLE);
+        if (capabilities.queues.graphicsFamily.has_value()) {
+            break;
+        }
+    }
+    if (!capabilities.queues.graphicsFamily.has_value()) {
+        cout << "no graphics device, skipping the gpu" << endl;
+        vkDestroyInstance(instance, nullptr);
+        return 0.0;
+    }
+    uint32_t queueFamily = capabilities.queues.graphicsFamily.value();
+
+    // the same features and extension createLogicalDevice enables for culling
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo{};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+    VkPhysicalDeviceFeatures features{};
+    features.multiDrawIndirect = capabilities.features.multiDrawIndirect;
+    features.drawIndirectFirstInstance = capabilities.features.drawIndirectFirstInstance;
+    vector<const char *> extensions;
+    bool drawIndirectCount = capabilities.hasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (drawIndirectCount) {
+        extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.pEnabledFeatures = &features;
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    deviceInfo.ppEnabledExtensionNames = extensions.data();
+    VkDevice device;
+    if (vkCreateDevice(capabilities.physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create logical device!"};
+    }
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+    if (drawIndirectCount) {
+        drawIndexedIndirectCount =
+            reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+    VkQueue queue;
+    vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+    double gpuMs = 0.0;
+    {
+        vkMemory::Allocator allocator{capabilities.physicalDevice, device};
+        // every submission is waited for, retired resources can go as soon as the next one is done
+        vector<function<void()>> retired;
+        auto retire = [&retired](function<void()> destroy) { retired.push_back(std::move(destroy)); };
+        VkShaderModule shader = VK_NULL_HANDLE;
+        if (archive.contains("cull.comp")) {
+            shader = archive.createShaderModule(device, "cull.comp", nullptr);
+        }
+        vkCulling::DrawCuller culler{device, capabilities, allocator, nullptr, retire, nullptr, shader,
+                                     drawIndexedIndirectCount, static_cast<uint32_t>(instances.size()), 1};
+        vkDestroyShaderModule(device, shader, nullptr);
+        pathName = vkCulling::pathName(culler.path());
+        if (culler.path() == vkCulling::CullPath::Cpu) {
+            cout << "the device can not cull on the gpu" << endl;
+        }
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = queueFamily;
+        VkCommandPool commandPool;
+        vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+        VkQueryPoolCreateInfo queryInfo{};
+        queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryInfo.queryCount = 2;
+        VkQueryPool queryPool;
+        vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool);
+
+        // every draw command plus the count, read back after the last run
+        VkBufferCreateInfo readbackInfo{};
+        readbackInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        readbackInfo.size = instances.size() * sizeof(VkDrawIndexedIndirectCommand) + sizeof(uint32_t);
+        readbackInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        readbackInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkBuffer readback;
+        vkCreateBuffer(device, &readbackInfo, nullptr, &readback);
+        vkMemory::Allocation readbackMemory =
+            allocator.allocateBuffer(readback, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        culler.setInstances(instances);
+        culler.setViewProjection(viewProjection);
+        double bestMs = 1e30;
+        // the first run uploads the instances and is not counted
+        for (uint32_t r = 0; r <= repeats; r++) {
+            bool last = r == repeats;
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            culler.cull(commandBuffer, 0);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            if (last && culler.path() != vkCulling::CullPath::Cpu) {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                                     nullptr, 0, nullptr);
+                VkBufferCopy drawCopy{0, 0, instances.size() * sizeof(VkDrawIndexedIndirectCommand)};
+                vkCmdCopyBuffer(commandBuffer, culler.drawBuffer(), readback, 1, &drawCopy);
+                VkBufferCopy countCopy{0, drawCopy.size, sizeof(uint32_t)};
+                vkCmdCopyBuffer(commandBuffer, culler.countBuffer(), readback, 1, &countCopy);
+            }
+            vkEndCommandBuffer(commandBuffer);
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+            vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+            vkQueueWaitIdle(queue);
+            for (auto &destroy : retired) {
+                destroy();
+            }
+            retired.clear();
+
+            uint64_t timestamps[2];
+            vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+            double ms = static_cast<double>(timestamps[1] - timestamps[0]) * capabilities.properties.limits.timestampPeriod / 1e6;
+            if (r > 0) {
+                bestMs = min(bestMs, ms);
+            }
+        }
+        gpuMs = bestMs;
+
+        visible = 0;
+        auto *commands = static_cast<const VkDrawIndexedIndirectCommand *>(readbackMemory.mapped);
+        if (culler.path() == vkCulling::CullPath::GpuCompacted) {
+            memcpy(&visible, commands + instances.size(), sizeof(uint32_t));
+        } else if (culler.path() == vkCulling::CullPath::GpuInPlace) {
+            for (size_t i = 0; i < instances.size(); i++) {
+                visible += commands[i].instanceCount;
+            }
+        }
+
+        vkDestroyBuffer(device, readback, nullptr);
+        allocator.free(readbackMemory);
+        vkDestroyQueryPool(device, queryPool, nullptr);
+        vkDestroyCommandPool(device, commandPool, nullptr);
+    }
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return gpuMs;
+}
+
+// cullingBench [--instances n] [--repeats n] [--shaders path] [--cpu-only]
+int main(int argc, char **argv) {
+    uint32_t instanceCount = 500000;
+    uint32_t repeats = 10;
+    string shaderPath = "shaders.pak";
+    bool cpuOnly = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            instanceCount = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            repeats = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            shaderPath = argv[++i];
+        } else if (strcmp(argv[i], "--cpu-only") == 0) {
+            cpuOnly = true;
+        }
+    }
+    repeats = max(repeats, 1u);
+
+    vector<vkCulling::CullInstance> instances = makeScene(instanceCount);
+    glm::mat4 viewProjection = makeViewProjection();
+    vkCulling::Frustum frustum = vkCulling::Frustum::fromViewProjection(viewProjection);
+    vector<VkDrawIndexedIndirectCommand> commands(instances.size());
+    vkCulling::CpuCuller cpuCuller;
+    cpuCuller.setInstances(instances);
+
+    uint32_t scalarVisible = 0, simdVisible = 0;
+    double scalarMs = best(repeats, [&]() { return vkCulling::cullScalar(frustum, instances, commands.data()); }, scalarVisible);
+    double simdMs = best(repeats, [&]() { return cpuCuller.cull(frustum, commands.data()); }, simdVisible);
+
+    cout << instanceCount << " instances, best of " << repeats << endl;
+    cout << "            path        ms  Minst / s   speedup   visible" << endl;
+    printRow("cpu scalar", scalarMs, scalarVisible, instanceCount, scalarMs);
+    printRow("cpu simd", simdMs, simdVisible, instanceCount, scalarMs);
+    bool match = scalarVisible == simdVisible;
+
+    if (!cpuOnly) {
+        uint32_t gpuVisible = 0;
+        const char *pathName = "gpu";
+        double gpuMs = cullOnGpu(instances, viewProjection, shaderPath, repeats, gpuVisible, pathName);
+        if (gpuMs > 0.0) {
+            printRow(pathName, gpuMs, gpuVisible, instanceCount, scalarMs);
+            match = match && gpuVisible == scalarVisible;
+        }
+    }
+    if (!match) {
+        cout << "visible counts differ!" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include "headers/jobSystem.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+using benchClock = chrono::steady_clock;
+
+// fixed amount of floating point work, the result is kept so it is not optimized away
+static float spin(uint32_t seed, uint32_t iterations) {
+    float value = static_cast<float>(seed);
+    for (uint32_t i = 0; i < iterations; i++) {
+        value = sqrt(value * 1.0001f + 1.0f);
+    }
+    return value;
+}
+
+struct Result {
+    double ms;
+    uint64_t stolen;
+};
+
+// many independent small jobs behind one counter
+static Result runJobs(vkJobs::JobSystem &jobs, uint32_t jobCount, uint32_t iterations, vector<float> &sink) {
+    uint64_t stolenBefore = jobs.stolenJobs();
+    auto start = benchClock::now();
+    vkJobs::Counter counter;
+    for (uint32_t i = 0; i < jobCount; i++) {
+        jobs.run([&sink, i, iterations]() { sink[i] = spin(i, iterations); }, &counter);
+    }
+    jobs.wait(counter);
+    return {chrono::duration<double, milli>(benchClock::now() - start).count(), jobs.stolenJobs() - stolenBefore};
+}
+
+// a tree of jobs that wait on their children, exercises help while waiting
+static void tree(vkJobs::JobSystem &jobs, uint32_t depth, uint32_t iterations, vector<float> &sink, uint32_t index) {
+    if (depth == 0) {
+        sink[index % sink.size()] = spin(index, iterations);
+        return;
+    }
+    vkJobs::Counter children;
+    for (uint32_t child = 0; child < 4; child++) {
+        jobs.run([&jobs, depth, iterations, &sink, index, child]() { tree(jobs, depth - 1, iterations, sink, index * 4 + child); }, &children);
+    }
+    jobs.wait(children);
+}
+
+static Result runTree(vkJobs::JobSystem &jobs, uint32_t depth, uint32_t iterations, vector<float> &sink) {
+    uint64_t stolenBefore = jobs.stolenJobs();
+    auto start = benchClock::now();
+    tree(jobs, depth, iterations, sink, 0);
+    return {chrono::duration<double, milli>(benchClock::now() - start).count(), jobs.stolenJobs() - stolenBefore};
+}
+
+static Result runParallelFor(vkJobs::JobSystem &jobs, vector<float> &data) {
+    uint64_t stolenBefore = jobs.stolenJobs();
+    auto start = benchClock::now();
+    jobs.parallelFor(static_cast<uint32_t>(data.size()), 4096, [&data](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            data[i] = spin(i, 64);
+        }
+    });
+    return {chrono::duration<double, milli>(benchClock::now() - start).count(), jobs.stolenJobs() - stolenBefore};
+}
+
+// jobSystemBench [--max-threads n] [--repeats n]
+int main(int argc, char **argv) {
+    uint32_t maxThreads = max(thread::hardware_concurrency(), 1u);
+    uint32_t repeats = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            maxThreads = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            repeats = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+    }
+
+    struct Benchmark {
+        const char *name;
+        function<Result(vkJobs::JobSystem &, vector<float> &)> run;
+    };
+    vector<Benchmark> benchmarks = {
+        {"20k jobs x 2k flops", [](vkJobs::JobSystem &jobs, vector<float> &sink) { return runJobs(jobs, 20000, 2000, sink); }},
+        {"nested tree depth 7", [](vkJobs::JobSystem &jobs, vector<float> &sink) { return runTree(jobs, 7, 2000, sink); }},
+        {"parallelFor 4M", [](vkJobs::JobSystem &jobs, vector<float> &sink) { return runParallelFor(jobs, sink); }},
+    };
+
+    vector<float> sink(4 * 1024 * 1024);
+    for (const auto &benchmark : benchmarks) {
+        cout << benchmark.name << endl;
+        cout << "  threads        ms   speedup  efficiency    stolen" << endl;
+        double baseline = 0.0;
+        for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+            vkJobs::JobSystem jobs{threads};
+            // best of n, the first run also warms up the workers
+            Result best{1e30, 0};
+            for (uint32_t r = 0; r < repeats; r++) {
+                Result result = benchmark.run(jobs, sink);
+                if (result.ms < best.ms) {
+                    best = result;
+                }
+            }
+            if (threads == 1) {
+                baseline = best.ms;
+            }
+            double speedup = baseline / best.ms;
+            cout << fixed << setprecision(2) << setw(9) << threads << setw(10) << best.ms << setw(10) << speedup << setw(12)
+                 << speedup / threads << setw(10) << best.stolen << endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,868 @@
+#include "headers/engine.hpp"
+#include "headers/sessionServer.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using benchClock = chrono::steady_clock;
+
+#ifndef PRAGMA_SHADER_ARCHIVE
+#define PRAGMA_SHADER_ARCHIVE "shaders.pak"
+#endif
+
+struct Options {
+    EngineConfig engine;
+    uint32_t runs = 5;
+    uint32_t frames = 200;
+    uint32_t warmupFrames = 20;
+    vector<uint32_t> sceneSizes = {1000, 10000, 100000};
+    vector<uint32_t> uploadMiB = {1, 16, 64};
+    vector<uint32_t> sessionCounts = {1, 8};
+    string jsonPath;
+    string baselinePath;
+    bool updateBaseline = false;
+    // a metric regresses when its median is this much worse than the baseline median
+    double tolerance = 0.15;
+    // and, for times, at least this many ms worse, so sub millisecond stages do not flap
+    double minDeltaMs = 0.5;
+    bool verbose = false;
+};
+
+// all samples of one measurement, summarized by percentiles
+struct Metric {
+    string unit;
+    bool higherIsBetter = false;
+    vector<double> samples;
+};
+
+struct Summary {
+    double min, mean, p50, p90, p99, max;
+};
+
+// linear interpolation between the closest ranks
+static double percentile(const vector<double> &sorted, double p) {
+    double rank = p * static_cast<double>(sorted.size() - 1);
+    size_t lower = static_cast<size_t>(rank);
+    size_t upper = min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<double>(lower));
+}
+
+static Summary summarize(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    return {samples.front(), total / static_cast<double>(samples.size()), percentile(samples, 0.5), percentile(samples, 0.9),
+            percentile(samples, 0.99), samples.back()};
+}
+
+static vector<uint32_t> parseList(const char *text) {
+    vector<uint32_t> values;
+    stringstream stream{text};
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(static_cast<uint32_t>(stoul(item)));
+        }
+    }
+    return values;
+}
+
+// the engine prints its statistics on every shutdown, only the tables of the bench are wanted
+class QuietScope {
+public:
+    explicit QuietScope(bool quiet) : saved(quiet ? cout.rdbuf(sink.rdbuf()) : nullptr) {
+    }
+    ~QuietScope() {
+        if (saved != nullptr) {
+            cout.rdbuf(saved);
+        }
+    }
+
+private:
+    ostringstream sink;
+    streambuf *saved;
+};
+
+// initVulkan stage by stage, a fresh engine every run and no pipeline cache file, so every run starts cold
+static void benchStartup(const Options &options, map<string, Metric> &metrics) {
+    auto add = [&](const string &name, double ms) {
+        Metric &metric = metrics[name];
+        metric.unit = "ms";
+        metric.samples.push_back(ms);
+    };
+    for (uint32_t run = 0; run < options.runs; run++) {
+        EngineConfig config = options.engine;
+        config.headlessFrameCount = 1;
+        config.windowedFrameCount = 1;
+        // the context of the engine prints its stats when the engine is destroyed
+        QuietScope quiet{!options.verbose};
+        GEngine engine{800, 600, config};
+        engine.run();
+        double total = 0.0, targets = 0.0;
+        for (const auto &stage : engine.getStartupStages()) {
+            add("startup." + string{stage.name}, stage.ms);
+            total += stage.ms;
+            if (strcmp(stage.name, "createOffscreenTargets") == 0 || strcmp(stage.name, "createSwapChain") == 0 ||
+                strcmp(stage.name, "createImageViews") == 0) {
+                targets += stage.ms;
+            }
+        }
+        add("startup.total", total);
+        add(config.headless ? "targets.offscreen" : "targets.swapchain", targets);
+        add("startup.first_frame", engine.getFrameStats().timeToFirstFrameMs);
+    }
+}
+
+// Uploads of size MiB in 4 MiB copies through GEngine::uploadBuffer, one batch at a time. The frame
+// recorded after a batch waits for it, so the batch is done once the fence of that frame was waited
+// on, which is when the frame task of the same frame slot runs again.
+static void benchUpload(const Options &options, uint32_t sizeMiB, Metric &metric) {
+    constexpr VkDeviceSize chunk = 4 << 20;
+    VkDeviceSize size = VkDeviceSize{sizeMiB} << 20;
+    vector<uint8_t> data(static_cast<size_t>(size));
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    EngineConfig config = options.engine;
+    config.headless = true;
+    config.headlessFrameCount = (options.runs + 1) * (config.framesInFlight + 1) + 1;
+    QuietScope quiet{!options.verbose};
+    GEngine engine{800, 600, config};
+    VkBuffer buffer = VK_NULL_HANDLE;
+    vkMemory::Allocation allocation;
+    uint32_t started = 0;
+    uint64_t batchFrame = 0;
+    bool pending = false;
+    benchClock::time_point batchStart;
+    engine.addFrameTask([&](uint64_t frameNumber) {
+        if (frameNumber == 0) {
+            allocation = engine.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer);
+        }
+        if (pending && frameNumber >= batchFrame + config.framesInFlight) {
+            double seconds = chrono::duration<double>(benchClock::now() - batchStart).count();
+            metric.samples.push_back(static_cast<double>(sizeMiB) / seconds);
+            pending = false;
+            // nothing recorded after the batch touches the buffer
+            if (started == options.runs) {
+                engine.destroyBuffer(buffer, allocation);
+                buffer = VK_NULL_HANDLE;
+            }
+        }
+        if (!pending && started < options.runs) {
+            batchStart = benchClock::now();
+            for (VkDeviceSize offset = 0; offset < size; offset += chunk) {
+                engine.uploadBuffer(buffer, offset, data.data() + offset, min(chunk, size - offset), VK_ACCESS_SHADER_READ_BIT,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            }
+            batchFrame = frameNumber;
+            pending = true;
+            started++;
+        }
+    });
+    engine.run();
+    if (buffer != VK_NULL_HANDLE) {
+        throw std::runtime_error{"upload bench ran out of frames!"};
+    }
+    metric.unit = "MiB/s";
+    metric.higherIsBetter = true;
+}
+
+// What benchScene draws: unit cubes out of one vertex and index buffer, the index buffer holding the 36 indices of
+// the cube meshCount times so draws can point at different ranges of it, the pipeline the culled draws are recorded
+// with, and the blended pipelines and materials handed to the draw queue.
+// Created once the engine started, its render pass exists from then on, and destroyed after it stopped.
+class SceneDraws {
+public:
+    static constexpr uint32_t queuedPipelineCount = 2;
+    static constexpr uint32_t materialCount = 32;
+    // ranges of the index buffer, the cube over and over
+    static constexpr uint32_t meshCount = 64;
+
+    SceneDraws(GEngine &engine, uint32_t framesInFlight) : engine(engine), device(engine.getDevice()) {
+        const float corners[8][3] = {{-1, -1, -1}, {1, -1, -1}, {-1, 1, -1}, {1, 1, -1}, {-1, -1, 1}, {1, -1, 1}, {-1, 1, 1}, {1, 1, 1}};
+        const uint32_t cube[36] = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+                                   2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+        VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        vertexMemory = engine.createBuffer(sizeof(corners), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible, vertexBuffer);
+        memcpy(vertexMemory.mapped, corners, sizeof(corners));
+        indexMemory = engine.createBuffer(meshCount * sizeof(cube), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, hostVisible, indexBuffer);
+        for (uint32_t copy = 0; copy < meshCount; copy++) {
+            memcpy(static_cast<uint32_t *>(indexMemory.mapped) + copy * 36, cube, sizeof(cube));
+        }
+
+        // a color and alpha per material, 256 is the largest minUniformBufferOffsetAlignment a device may have
+        materialMemory =
+            engine.createBuffer(materialCount * materialStride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible, materialBuffer);
+        for (uint32_t m = 0; m < materialCount; m++) {
+            glm::vec4 color{(m & 1) ? 1.0f : 0.4f, (m & 2) ? 1.0f : 0.4f, (m & 4) ? 1.0f : 0.4f, 0.25f + 0.05f * static_cast<float>(m % 8)};
+            memcpy(static_cast<char *>(materialMemory.mapped) + m * materialStride, &color, sizeof(color));
+        }
+
+        transformLayout = createSetLayout(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+        materialLayout = createSetLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
+        // a transform set per frame in flight, the transforms live in a buffer per frame
+        VkDescriptorPoolSize poolSizes[2] = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight},
+                                             {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, materialCount}};
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = framesInFlight + materialCount;
+        poolInfo.poolSizeCount = 2;
+        poolInfo.pPoolSizes = poolSizes;
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create the scene descriptor pool!"};
+        }
+        for (uint32_t m = 0; m < materialCount; m++) {
+            VkDescriptorBufferInfo bufferInfo{materialBuffer, m * materialStride, sizeof(glm::vec4)};
+            materialSets.push_back(allocateSet(materialLayout, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferInfo));
+        }
+
+        // both kinds of pipelines share it, the culled ones leave the material set unused
+        VkDescriptorSetLayout setLayouts[2] = {transformLayout, materialLayout};
+        VkPushConstantRange pushRange{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4)};
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 2;
+        layoutInfo.pSetLayouts = setLayouts;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+        if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create the scene pipeline layout!"};
+        }
+        culledPipeline = createPipeline(false, VK_BLEND_FACTOR_ZERO);
+        // alpha blended and additive
+        queuedPipelines[0] = createPipeline(true, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA);
+        queuedPipelines[1] = createPipeline(true, VK_BLEND_FACTOR_ONE);
+    }
+
+    ~SceneDraws() {
+        vkDestroyPipeline(device, culledPipeline, nullptr);
+        for (VkPipeline pipeline : queuedPipelines) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        vkDestroyPipelineLayout(device, layout, nullptr);
+        // frees the sets with it
+        vkDestroyDescriptorPool(device, pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, transformLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, materialLayout, nullptr);
+        engine.destroyBuffer(vertexBuffer, vertexMemory);
+        engine.destroyBuffer(indexBuffer, indexMemory);
+        engine.destroyBuffer(materialBuffer, materialMemory);
+    }
+
+    // states of the draw queue, the materials are its set 1
+    vkDraw::PipelineState queuedPipeline(uint32_t index) const {
+        return {queuedPipelines[index], layout};
+    }
+    vkDraw::MaterialState material(uint32_t index) const {
+        return {materialSets[index], 1};
+    }
+    vkDraw::MeshState mesh(uint32_t index) const {
+        return {vertexBuffer, 0, indexBuffer, 0, VK_INDEX_TYPE_UINT32, 36, index * 36, 0};
+    }
+
+    SceneDraws(const SceneDraws &) = delete;
+    SceneDraws &operator=(const SceneDraws &) = delete;
+
+    // from a frame task, points the draws of the frame at its transforms
+    void prepare(const glm::mat4 &camera) {
+        viewProjection = camera;
+        VkBuffer transforms = engine.getInstanceBuffer();
+        auto found = transformSets.find(transforms);
+        if (found == transformSets.end()) {
+            VkDescriptorSet set = allocateSet(transformLayout, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, {transforms, 0, VK_WHOLE_SIZE});
+            found = transformSets.emplace(transforms, set).first;
+        }
+        transformSet = found->second;
+    }
+
+    // record task, the draws of the culler
+    void drawCulled(VkCommandBuffer commandBuffer) const {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, culledPipeline);
+        bindScene(commandBuffer);
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        engine.getDrawCuller().draw(commandBuffer, engine.getFrameIndex());
+    }
+
+    // record task, one pass of the draw queue. It binds the pipelines, materials and meshes itself
+    void drawQueued(VkCommandBuffer commandBuffer, uint32_t pass) const {
+        bindScene(commandBuffer);
+        engine.getDrawQueue().record(commandBuffer, pass);
+    }
+
+private:
+    GEngine &engine;
+    VkDevice device;
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    vkMemory::Allocation vertexMemory;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    vkMemory::Allocation indexMemory;
+    VkBuffer materialBuffer = VK_NULL_HANDLE;
+    vkMemory::Allocation materialMemory;
+    static constexpr VkDeviceSize materialStride = 256;
+    VkDescriptorSetLayout transformLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout materialLayout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    vector<VkDescriptorSet> materialSets;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipeline culledPipeline = VK_NULL_HANDLE;
+    VkPipeline queuedPipelines[queuedPipelineCount] = {};
+    map<VkBuffer, VkDescriptorSet> transformSets;
+    // of the frame being recorded
+    VkDescriptorSet transformSet = VK_NULL_HANDLE;
+    glm::mat4 viewProjection{1.0f};
+
+    // one binding, whatever reads it from the stage
+    VkDescriptorSetLayout createSetLayout(VkDescriptorType type, VkShaderStageFlags stages) {
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = type;
+        binding.descriptorCount = 1;
+        binding.stageFlags = stages;
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+        setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setLayoutInfo.bindingCount = 1;
+        setLayoutInfo.pBindings = &binding;
+        VkDescriptorSetLayout setLayout;
+        if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create a scene descriptor set layout!"};
+        }
+        return setLayout;
+    }
+
+    VkDescriptorSet allocateSet(VkDescriptorSetLayout setLayout, VkDescriptorType type, VkDescriptorBufferInfo bufferInfo) {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+        VkDescriptorSet set;
+        if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to allocate a scene descriptor set!"};
+        }
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        return set;
+    }
+
+    // culled pipelines take the node from gl_InstanceIndex and are opaque, queued ones read it from the
+    // instance buffer of the draw queue and blend into the target with dstColorFactor
+    VkPipeline createPipeline(bool queued, VkBlendFactor dstColorFactor) {
+        VkShaderModule vertex = engine.createShaderModule(queued ? "sceneQueued.vert" : "scene.vert");
+        VkShaderModule fragment = engine.createShaderModule(queued ? "sceneMaterial.frag" : "scene.frag");
+        VkPipelineShaderStageCreateInfo stages[2]{};
+        stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[0].module = vertex;
+        stages[0].pName = "main";
+        stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[1].module = fragment;
+        stages[1].pName = "main";
+
+        VkVertexInputBindingDescription bindings[2] = {
+            {0, 3 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX},
+            {vkDraw::DrawQueue::instanceBinding, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_INSTANCE},
+        };
+        VkVertexInputAttributeDescription attributes[2] = {
+            {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+            {1, vkDraw::DrawQueue::instanceBinding, VK_FORMAT_R32_UINT, 0},
+        };
+        VkPipelineVertexInputStateCreateInfo vertexInput{};
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInput.vertexBindingDescriptionCount = queued ? 2 : 1;
+        vertexInput.pVertexBindingDescriptions = bindings;
+        vertexInput.vertexAttributeDescriptionCount = queued ? 2 : 1;
+        vertexInput.pVertexAttributeDescriptions = attributes;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        // set by bindScene, the target extent is only known while recording
+        VkPipelineViewportStateCreateInfo viewport{};
+        viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport.viewportCount = 1;
+        viewport.scissorCount = 1;
+        VkPipelineRasterizationStateCreateInfo rasterization{};
+        rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+        // both faces, blended cubes show their back faces through the front ones
+        rasterization.cullMode = VK_CULL_MODE_NONE;
+        rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterization.lineWidth = 1.0f;
+        VkPipelineMultisampleStateCreateInfo multisample{};
+        multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkPipelineColorBlendAttachmentState blendAttachment{};
+        blendAttachment.colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        if (queued) {
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            blendAttachment.dstColorBlendFactor = dstColorFactor;
+            blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+            blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        }
+        VkPipelineColorBlendStateCreateInfo colorBlend{};
+        colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlend.attachmentCount = 1;
+        colorBlend.pAttachments = &blendAttachment;
+        VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamic{};
+        dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamic.dynamicStateCount = 2;
+        dynamic.pDynamicStates = dynamicStates;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = stages;
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewport;
+        pipelineInfo.pRasterizationState = &rasterization;
+        pipelineInfo.pMultisampleState = &multisample;
+        pipelineInfo.pColorBlendState = &colorBlend;
+        pipelineInfo.pDynamicState = &dynamic;
+        pipelineInfo.layout = layout;
+        pipelineInfo.renderPass = engine.getRenderPass();
+        pipelineInfo.subpass = 0;
+        VkPipeline pipeline = engine.getPipelineCache().createGraphicsPipeline(pipelineInfo);
+        engine.destroyShaderModule(vertex);
+        engine.destroyShaderModule(fragment);
+        return pipeline;
+    }
+
+    void bindScene(VkCommandBuffer commandBuffer) const {
+        VkExtent2D extent = engine.getTargetExtent();
+        VkViewport viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &transformSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(viewProjection), &viewProjection);
+    }
+};
+
+// A scene of nodeCount nodes, a quarter of them roots with three children each. Every frame all roots move and
+// every node is drawn as a cube by a record task. Nine in ten are opaque and drawn by the culler, the rest are
+// blended, submitted to the draw queue back to front and recorded from it after the opaque ones.
+static void benchScene(const Options &options, uint32_t nodeCount, map<string, Metric> &metrics) {
+    EngineConfig config = options.engine;
+    config.headless = true;
+    config.headlessFrameCount = options.warmupFrames + options.frames;
+    config.maxDrawInstances = max(nodeCount, 4u);
+    config.keepFrameHistory = true;
+    QuietScope quiet{!options.verbose};
+    GEngine engine{800, 600, config};
+    engine.start();
+    SceneDraws sceneDraws{engine, max(config.framesInFlight, 1u)};
+    engine.addRecordTask([&](VkCommandBuffer commandBuffer) { sceneDraws.drawCulled(commandBuffer); });
+    engine.addRecordTask([&](VkCommandBuffer commandBuffer) { sceneDraws.drawQueued(commandBuffer, 1); });
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3{0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+
+    vector<vkScene::NodeId> roots;
+    vector<vkScene::NodeId> nodes;
+    // the blended ones, drawn through the draw queue
+    vector<vkScene::NodeId> blendedNodes;
+    // view distance of every blended node, by position in blendedNodes
+    vector<float> depths;
+    vector<vkDraw::PipelineId> pipelines;
+    vector<vkDraw::MaterialId> materials;
+    vector<vkDraw::MeshId> meshes;
+    engine.addFrameTask([&](uint64_t frameNumber) {
+        auto &store = engine.getTransformStore();
+        auto &queue = engine.getDrawQueue();
+        if (frameNumber == 0) {
+            mt19937 random{nodeCount};
+            uniform_real_distribution<float> position{-500.0f, 500.0f};
+            vector<vkCulling::CullInstance> instances;
+            for (uint32_t i = 0; i + 4 <= config.maxDrawInstances; i += 4) {
+                vkScene::Transform transform;
+                transform.position = {position(random), position(random), position(random)};
+                glm::vec3 center = transform.position;
+                roots.push_back(store.create(vkScene::noParent, transform));
+                nodes.push_back(roots.back());
+                for (uint32_t c = 0; c < 3; c++) {
+                    transform.position = {static_cast<float>(c), 1.0f, 0.0f};
+                    nodes.push_back(store.create(roots.back(), transform));
+                }
+                // one draw in ten is blended, the children stay within the bounds of their root
+                for (size_t n = nodes.size() - 4; n < nodes.size(); n++) {
+                    if (nodes[n] % 10 == 0) {
+                        blendedNodes.push_back(nodes[n]);
+                        depths.push_back(glm::length(center));
+                    } else {
+                        instances.push_back({glm::vec4{center, 4.0f}, 36, (nodes[n] % SceneDraws::meshCount) * 36, 0, nodes[n]});
+                    }
+                }
+            }
+            auto &culler = engine.getDrawCuller();
+            culler.setInstances(instances);
+            culler.setViewProjection(viewProjection);
+            for (uint32_t i = 0; i < SceneDraws::queuedPipelineCount; i++) {
+                pipelines.push_back(queue.addPipeline(sceneDraws.queuedPipeline(i)));
+            }
+            for (uint32_t i = 0; i < SceneDraws::materialCount; i++) {
+                materials.push_back(queue.addMaterial(sceneDraws.material(i)));
+            }
+            for (uint32_t i = 0; i < SceneDraws::meshCount; i++) {
+                meshes.push_back(queue.addMesh(sceneDraws.mesh(i)));
+            }
+            queue.setPassOrder(1, vkDraw::PassOrder::BackToFront);
+        }
+        float angle = static_cast<float>(frameNumber) * 0.01f;
+        for (auto root : roots) {
+            vkScene::Transform transform = store.getLocal(root);
+            transform.rotation = glm::angleAxis(angle, glm::vec3{0.0f, 1.0f, 0.0f});
+            store.setLocal(root, transform);
+        }
+        for (size_t n = 0; n < blendedNodes.size(); n++) {
+            vkScene::NodeId node = blendedNodes[n];
+            queue.submit(1, pipelines[node % pipelines.size()], materials[(node / 8) % materials.size()], meshes[node % meshes.size()],
+                         depths[n], node);
+        }
+        sceneDraws.prepare(viewProjection);
+    });
+    while (!engine.finished()) {
+        engine.renderFrame();
+    }
+    engine.stop();
+
+    const auto &stats = engine.getFrameStats();
+    string prefix = "scene." + to_string(nodeCount) + ".";
+    auto addHistory = [&](const char *name, const FrameTiming &timing) {
+        if (timing.history.size() <= options.warmupFrames) {
+            return;
+        }
+        Metric &metric = metrics[prefix + name];
+        metric.unit = "ms";
+        metric.samples.assign(timing.history.begin() + options.warmupFrames, timing.history.end());
+    };
+    addHistory("cpu_frame", stats.cpuFrame);
+    addHistory("gpu_frame", stats.gpuFrame);
+    addHistory("fence_wait", stats.fenceWait);
+}
+
+// sessionCount headless sessions on one SessionServer, each rendering --frames frames. Reports what a session
+// adds on top of the shared context: its start time and the device memory it allocates, and the frames rendered
+// per second by all of them together
+static void benchSessions(const Options &options, uint32_t sessionCount, map<string, Metric> &metrics) {
+    string prefix = "sessions." + to_string(sessionCount) + ".";
+    auto deviceBytes = [](EngineContext &context) {
+        VkDeviceSize bytes = 0;
+        for (const auto &heap : context.getAllocator().getHeapStats()) {
+            bytes += heap.blockBytes;
+        }
+        return bytes;
+    };
+
+    QuietScope quiet{!options.verbose};
+    SessionServer server{contextConfigFor(options.engine)};
+    EngineContext &context = server.getContext();
+    VkDeviceSize contextBytes = deviceBytes(context);
+    VkDeviceSize sessionBytes = 0;
+    for (uint32_t i = 0; i < sessionCount; i++) {
+        EngineConfig config = options.engine;
+        config.headless = true;
+        config.headlessFrameCount = options.frames;
+        GEngine &engine = server.addSession(800, 600, config);
+        // every session is started before the first frame is rendered
+        if (i == 0) {
+            engine.addFrameTask([&](uint64_t frameNumber) {
+                if (frameNumber == 0) {
+                    sessionBytes = deviceBytes(context) - contextBytes;
+                }
+            });
+        }
+    }
+    auto start = benchClock::now();
+    server.run();
+    double seconds = chrono::duration<double>(benchClock::now() - start).count();
+
+    Metric &startMetric = metrics[prefix + "session_start"];
+    startMetric.unit = "ms";
+    for (const auto &stats : server.getStats()) {
+        startMetric.samples.push_back(stats.startMs);
+    }
+    metrics[prefix + "context_start"] = {"ms", false, {context.startupMs()}};
+    metrics[prefix + "device_memory_per_session"] = {"MiB", false, {static_cast<double>(sessionBytes) / sessionCount / (1024 * 1024)}};
+    metrics[prefix + "frames_per_second"] = {"fps", true, {static_cast<double>(options.frames) * sessionCount / seconds}};
+}
+
+static string escape(const string &text) {
+    string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+static void writeJson(const string &path, const Options &options, const map<string, Metric> &metrics) {
+    ofstream out{path};
+    if (!out) {
+        throw std::runtime_error{"failed to open " + path + "!"};
+    }
+    out << "{\n  \"runs\": " << options.runs << ",\n  \"frames\": " << options.frames << ",\n  \"metrics\": {";
+    bool first = true;
+    out << setprecision(6);
+    for (const auto &[name, metric] : metrics) {
+        if (metric.samples.empty()) {
+            continue;
+        }
+        Summary summary = summarize(metric.samples);
+        out << (first ? "\n" : ",\n") << "    \"" << escape(name) << "\": {\"unit\": \"" << metric.unit << "\", \"better\": \""
+            << (metric.higherIsBetter ? "higher" : "lower") << "\", \"count\": " << metric.samples.size() << ", \"min\": " << summary.min
+            << ", \"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90 << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max << "}";
+        first = false;
+    }
+    out << "\n  }\n}\n";
+}
+
+// Just enough json for the files writeJson produces: every number is stored under its path,
+// e.g. "metrics/startup.total/p50", strings are skipped.
+class JsonReader {
+public:
+    explicit JsonReader(string text) : text(std::move(text)) {
+    }
+
+    map<string, double> numbers() {
+        map<string, double> out;
+        value("", out);
+        return out;
+    }
+
+private:
+    string text;
+    size_t at = 0;
+
+    void skipSpace() {
+        while (at < text.size() && isspace(static_cast<unsigned char>(text[at]))) {
+            at++;
+        }
+    }
+    void expect(char c) {
+        skipSpace();
+        if (at >= text.size() || text[at] != c) {
+            throw std::runtime_error{"malformed baseline json at byte " + to_string(at) + "!"};
+        }
+        at++;
+    }
+    string readString() {
+        expect('"');
+        string out;
+        while (at < text.size() && text[at] != '"') {
+            if (text[at] == '\\') {
+                at++;
+            }
+            out += text[at++];
+        }
+        expect('"');
+        return out;
+    }
+    void value(const string &path, map<string, double> &out) {
+        skipSpace();
+        if (at >= text.size()) {
+            throw std::runtime_error{"baseline json ends early!"};
+        }
+        char c = text[at];
+        if (c == '{') {
+            at++;
+            skipSpace();
+            if (text[at] == '}') {
+                at++;
+                return;
+            }
+            do {
+                string key = readString();
+                expect(':');
+                value(path.empty() ? key : path + "/" + key, out);
+                skipSpace();
+            } while (at < text.size() && text[at++] == ',');
+            if (text[at - 1] != '}') {
+                throw std::runtime_error{"malformed baseline json at byte " + to_string(at) + "!"};
+            }
+        } else if (c == '"') {
+            readString();
+        } else {
+            size_t end = text.find_first_of(",}] \n\r\t", at);
+            string token = text.substr(at, end - at);
+            at = end;
+            if (token != "true" && token != "false" && token != "null") {
+                out[path] = stod(token);
+            }
+        }
+    }
+};
+
+// medians against the baseline, returns the number of regressions
+static uint32_t compare(const map<string, Metric> &metrics, const string &baselinePath, const Options &options) {
+    ifstream file{baselinePath};
+    if (!file) {
+        throw std::runtime_error{"failed to open baseline " + baselinePath + "!"};
+    }
+    stringstream content;
+    content << file.rdbuf();
+    map<string, double> baseline = JsonReader{content.str()}.numbers();
+
+    uint32_t regressions = 0;
+    cout << "against " << baselinePath << ", tolerance " << fixed << setprecision(1) << options.tolerance * 100.0 << "%" << endl;
+    cout << setw(40) << "metric" << setw(14) << "baseline p50" << setw(14) << "p50" << setw(10) << "change" << endl;
+    for (const auto &[name, metric] : metrics) {
+        auto it = baseline.find("metrics/" + name + "/p50");
+        if (metric.samples.empty() || it == baseline.end()) {
+            continue;
+        }
+        double base = it->second;
+        double current = summarize(metric.samples).p50;
+        double change = base == 0.0 ? 0.0 : (current - base) / base;
+        bool worse = metric.higherIsBetter ? change < -options.tolerance : change > options.tolerance;
+        if (worse && metric.unit == "ms" && current - base < options.minDeltaMs) {
+            worse = false;
+        }
+        regressions += worse;
+        cout << setw(40) << name << fixed << setprecision(3) << setw(14) << base << setw(14) << current << setprecision(1) << setw(9)
+             << change * 100.0 << "%" << (worse ? "  regressed" : "") << endl;
+    }
+    return regressions;
+}
+
+static void printMetrics(const map<string, Metric> &metrics) {
+    cout << setw(40) << "metric" << setw(8) << "unit" << setw(8) << "count" << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99"
+         << setw(12) << "max" << endl;
+    for (const auto &[name, metric] : metrics) {
+        if (metric.samples.empty()) {
+            continue;
+        }
+        Summary summary = summarize(metric.samples);
+        cout << setw(40) << name << setw(8) << metric.unit << setw(8) << metric.samples.size() << fixed << setprecision(3) << setw(12)
+             << summary.p50 << setw(12) << summary.p90 << setw(12) << summary.p99 << setw(12) << summary.max << endl;
+    }
+}
+
+// pragma_bench [--device name] [--runs n] [--frames n] [--warmup n] [--scenes n,n,..] [--uploads MiB,MiB,..] [--sessions n,n,..] [--windowed]
+//              [--shaders path] [--json path] [--baseline path] [--update-baseline] [--tolerance fraction] [--min-delta ms]
+//              [--verbose]
+// exits with EXIT_FAILURE when a metric regressed against the baseline
+int main(int argc, char **argv) {
+    vkProfiler::setThreadName("main");
+    Options options;
+    options.engine.headless = true;
+    options.engine.pipelineCachePath.clear();
+    options.engine.shaderArchivePath = PRAGMA_SHADER_ARCHIVE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            options.engine.preferredDevice = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            options.runs = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frames = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmupFrames = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--scenes") == 0 && i + 1 < argc) {
+            options.sceneSizes = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--uploads") == 0 && i + 1 < argc) {
+            options.uploadMiB = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            options.sessionCounts = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--windowed") == 0) {
+            options.engine.headless = false;
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            options.engine.shaderArchivePath = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--update-baseline") == 0) {
+            options.updateBaseline = true;
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            options.tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-delta") == 0 && i + 1 < argc) {
+            options.minDeltaMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            options.verbose = true;
+        }
+    }
+    options.runs = max(options.runs, 1u);
+    options.frames = max(options.frames, 1u);
+    if (options.updateBaseline && options.baselinePath.empty()) {
+        cerr << "--update-baseline needs --baseline" << endl;
+        return EXIT_FAILURE;
+    }
+
+    map<string, Metric> metrics;
+    try {
+        cout << "startup, " << options.runs << " runs" << endl;
+        benchStartup(options, metrics);
+        // the scene and upload benches render offscreen even with --windowed, only startup creates the swapchain
+        for (uint32_t sizeMiB : options.uploadMiB) {
+            cout << "upload " << sizeMiB << " MiB, " << options.runs << " runs" << endl;
+            benchUpload(options, sizeMiB, metrics["upload." + to_string(sizeMiB) + "MiB"]);
+        }
+        for (uint32_t nodeCount : options.sceneSizes) {
+            cout << "scene of " << nodeCount << " nodes, " << options.frames << " frames" << endl;
+            benchScene(options, nodeCount, metrics);
+        }
+        for (uint32_t sessionCount : options.sessionCounts) {
+            cout << sessionCount << " sessions on one context, " << options.frames << " frames each" << endl;
+            benchSessions(options, max(sessionCount, 1u), metrics);
+        }
+    } catch (const std::exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    printMetrics(metrics);
+
+    try {
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, options, metrics);
+            cout << "wrote " << options.jsonPath << endl;
+        }
+        if (options.updateBaseline) {
+            writeJson(options.baselinePath, options, metrics);
+            cout << "wrote baseline " << options.baselinePath << endl;
+        } else if (!options.baselinePath.empty()) {
+            uint32_t regressions = compare(metrics, options.baselinePath, options);
+            if (regressions > 0) {
+                cout << regressions << " metrics regressed!" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include "headers/jobSystem.hpp"
+#include "headers/transformStore.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+using benchClock = chrono::steady_clock;
+
+// what a scene graph without the store looks like, nodes on the heap and a recursive walk over all of them
+struct PointerNode {
+    vkScene::Transform local;
+    glm::mat4 world{1.0f};
+    vector<unique_ptr<PointerNode>> children;
+};
+
+static void updatePointerTree(PointerNode &node, const glm::mat4 &parentWorld) {
+    glm::mat4 local = glm::translate(glm::mat4{1.0f}, node.local.position) * glm::mat4_cast(node.local.rotation);
+    node.world = parentWorld * glm::scale(local, node.local.scale);
+    for (auto &child : node.children) {
+        updatePointerTree(*child, node.world);
+    }
+}
+
+static vkScene::Transform randomTransform(mt19937 &random) {
+    uniform_real_distribution<float> unit{-1.0f, 1.0f};
+    vkScene::Transform transform;
+    transform.position = {unit(random) * 10.0f, unit(random) * 10.0f, unit(random) * 10.0f};
+    transform.rotation = glm::angleAxis(unit(random) * 3.14f, glm::normalize(glm::vec3{unit(random), unit(random), 1.0f}));
+    transform.scale = glm::vec3{1.0f + unit(random) * 0.1f};
+    return transform;
+}
+
+struct Scene {
+    unique_ptr<vkScene::TransformStore> store;
+    vector<vkScene::NodeId> roots;
+    vector<vkScene::NodeId> leaves;
+    vector<unique_ptr<PointerNode>> pointerRoots;
+};
+
+// roots with fanout children per node down to depth, built breadth first like a level loader would
+static Scene makeScene(uint32_t rootCount, uint32_t fanout, uint32_t depth) {
+    uint64_t nodeCount = 0, levelCount = rootCount;
+    for (uint32_t level = 0; level <= depth; level++) {
+        nodeCount += levelCount;
+        levelCount *= fanout;
+    }
+    Scene scene;
+    scene.store = make_unique<vkScene::TransformStore>(static_cast<uint32_t>(nodeCount));
+    mt19937 random{42};
+    vector<pair<vkScene::NodeId, PointerNode *>> level, next;
+    for (uint32_t i = 0; i < rootCount; i++) {
+        vkScene::Transform transform = randomTransform(random);
+        scene.pointerRoots.push_back(make_unique<PointerNode>());
+        scene.pointerRoots.back()->local = transform;
+        level.push_back({scene.store->create(vkScene::noParent, transform), scene.pointerRoots.back().get()});
+        scene.roots.push_back(level.back().first);
+    }
+    for (uint32_t d = 0; d < depth; d++) {
+        next.clear();
+        for (auto [parent, pointerParent] : level) {
+            for (uint32_t c = 0; c < fanout; c++) {
+                vkScene::Transform transform = randomTransform(random);
+                pointerParent->children.push_back(make_unique<PointerNode>());
+                pointerParent->children.back()->local = transform;
+                next.push_back({scene.store->create(parent, transform), pointerParent->children.back().get()});
+            }
+        }
+        swap(level, next);
+    }
+    for (auto [node, pointerNode] : level) {
+        scene.leaves.push_back(node);
+    }
+    return scene;
+}
+
+// best of n in ms, prepare runs before every timed run and is not counted
+static double best(uint32_t repeats, const function<void()> &prepare, const function<void()> &run) {
+    double bestMs = 1e30;
+    for (uint32_t r = 0; r < repeats; r++) {
+        prepare();
+        auto start = benchClock::now();
+        run();
+        bestMs = min(bestMs, chrono::duration<double, milli>(benchClock::now() - start).count());
+    }
+    return bestMs;
+}
+
+// transformBench [--roots n] [--fanout n] [--depth n] [--repeats n] [--workers n]
+int main(int argc, char **argv) {
+    uint32_t rootCount = 1000;
+    uint32_t fanout = 10;
+    uint32_t depth = 3;
+    uint32_t repeats = 10;
+    uint32_t workers = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--roots") == 0 && i + 1 < argc) {
+            rootCount = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--fanout") == 0 && i + 1 < argc) {
+            fanout = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            repeats = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+    }
+    repeats = max(repeats, 1u);
+
+    Scene scene = makeScene(rootCount, fanout, depth);
+    vkScene::TransformStore &store = *scene.store;
+    vkJobs::JobSystem jobs{workers};
+    vector<glm::mat4> instances(store.capacity());
+    uint64_t writtenVersion = 0;
+    store.update();
+    store.writeChanged(instances.data(), writtenVersion);
+    cout << store.size() << " nodes, " << rootCount << " roots, fanout " << fanout << ", depth " << depth << ", best of " << repeats
+         << ", " << jobs.workerCount() << " workers" << endl;
+
+    mt19937 random{7};
+    auto touch = [&](const vector<vkScene::NodeId> &nodes, uint32_t count) {
+        return [&, count]() {
+            for (uint32_t i = 0; i < count; i++) {
+                vkScene::NodeId node = nodes[random() % nodes.size()];
+                store.setLocal(node, randomTransform(random));
+            }
+        };
+    };
+    struct Case {
+        const char *name;
+        function<void()> prepare;
+    };
+    uint32_t leafTouches = max(1u, static_cast<uint32_t>(scene.leaves.size() / 100));
+    uint32_t rootTouches = max(1u, rootCount / 100);
+    vector<Case> cases = {
+        {"every node", [&]() {
+             for (auto root : scene.roots) {
+                 store.setLocal(root, store.getLocal(root));
+             }
+         }},
+        {"1% of roots", touch(scene.roots, rootTouches)},
+        {"1% of leaves", touch(scene.leaves, leafTouches)},
+    };
+
+    double pointerMs = best(repeats, []() {}, [&]() {
+        for (auto &root : scene.pointerRoots) {
+            updatePointerTree(*root, glm::mat4{1.0f});
+        }
+    });
+    cout << "  pointer tree, every node " << fixed << setprecision(3) << pointerMs << " ms" << endl;
+    cout << "              case    serial ms  parallel ms    write ms   recomputed" << endl;
+    for (const auto &benchmark : cases) {
+        uint32_t recomputed = 0;
+        double serialMs = best(repeats, benchmark.prepare, [&]() { recomputed = store.update(); });
+        double parallelMs = best(repeats, benchmark.prepare, [&]() { store.update(&jobs); });
+        // the instance buffer catching up on one update
+        double writeMs = best(repeats, [&]() {
+            benchmark.prepare();
+            store.update(&jobs);
+        }, [&]() { store.writeChanged(instances.data(), writtenVersion); });
+        cout << setw(18) << benchmark.name << setprecision(3) << setw(13) << serialMs << setw(13) << parallelMs << setw(12) << writeMs
+             << setw(13) << recomputed << endl;
+    }
+
+    // the leaves were moved since, but the roots of both hold the same transforms again
+    uint32_t mismatches = 0;
+    for (size_t i = 0; i < scene.roots.size(); i++) {
+        store.setLocal(scene.roots[i], scene.pointerRoots[i]->local);
+    }
+    store.update(&jobs);
+    for (size_t i = 0; i < scene.roots.size(); i++) {
+        updatePointerTree(*scene.pointerRoots[i], glm::mat4{1.0f});
+        glm::mat4 world = store.getWorld(scene.roots[i]);
+        for (int c = 0; c < 4; c++) {
+            glm::vec4 difference = world[c] - scene.pointerRoots[i]->world[c];
+            if (glm::dot(difference, difference) > 1e-6f) {
+                mismatches++;
+                break;
+            }
+        }
+    }
+    if (mismatches > 0) {
+        cout << mismatches << " roots disagree with the pointer tree!" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
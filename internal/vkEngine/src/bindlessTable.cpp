@@ -0,0 +1,217 @@
+#include "headers/bindlessTable.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkDescriptors {
+
+namespace {
+
+// combined image samplers count against the sampler and the sampled image limits
+uint32_t textureLimit(const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &limits, uint32_t wanted) {
+    return min({wanted, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSamplers,
+                limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+}
+
+uint32_t bufferLimit(const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &limits, uint32_t wanted, uint32_t textureCount) {
+    // both arrays are visible to every stage, together they may not exceed the per stage resource limit
+    uint32_t resourcesLeft = limits.maxPerStageUpdateAfterBindResources - min(limits.maxPerStageUpdateAfterBindResources, textureCount);
+    return min({wanted, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                resourcesLeft});
+}
+} // namespace
+
+uint32_t SlotAllocator::allocate() {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    return nextSlot < slotCapacity ? nextSlot++ : invalidSlot;
+}
+
+void SlotAllocator::free(uint32_t slot) {
+    freeSlots.push_back(slot);
+}
+
+BindlessTable::BindlessTable(VkDevice device, const DeviceCapabilities &capabilities, const VkAllocationCallbacks *hostCallbacks,
+                             RetireFunction retire, uint32_t textureCount, uint32_t bufferCount)
+    : device(device), hostCallbacks(hostCallbacks), retire(std::move(retire)),
+      textureSlots(textureLimit(capabilities.descriptorIndexingProperties, textureCount)),
+      bufferSlots(bufferLimit(capabilities.descriptorIndexingProperties, bufferCount,
+                              textureLimit(capabilities.descriptorIndexingProperties, textureCount))) {
+    if (!capabilities.supportsBindless()) {
+        throw std::runtime_error{"device does not support bindless descriptors!"};
+    }
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = textureBinding;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = textureSlots.capacity();
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = bufferBinding;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = bufferSlots.capacity();
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+    // slots nobody allocated are never written, partially bound makes that legal as long as shaders
+    // do not read them. unused while pending lets new slots be written while frames in flight read the others
+    VkDescriptorBindingFlagsEXT flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                                        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+    VkDescriptorBindingFlagsEXT bindingFlags[2] = {flags, flags};
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    flagsInfo.bindingCount = 2;
+    flagsInfo.pBindingFlags = bindingFlags;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, hostCallbacks, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create bindless descriptor set layout!"};
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_ALL;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(DrawConstants);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostCallbacks, &layout) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create bindless pipeline layout!"};
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureSlots.capacity()},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferSlots.capacity()},
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, hostCallbacks, &pool) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create bindless descriptor pool!"};
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to allocate bindless descriptor set!"};
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.minLod = 0.0f;
+    // streamed textures change their level count, the view clamps it
+    samplerInfo.maxLod = 1000.0f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    if (vkCreateSampler(device, &samplerInfo, hostCallbacks, &defaultSampler) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create bindless default sampler!"};
+    }
+}
+
+BindlessTable::~BindlessTable() {
+    vkDestroySampler(device, defaultSampler, hostCallbacks);
+    // frees the set with it
+    vkDestroyDescriptorPool(device, pool, hostCallbacks);
+    vkDestroyPipelineLayout(device, layout, hostCallbacks);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, hostCallbacks);
+}
+
+uint32_t BindlessTable::addTexture(VkImageView view, VkSampler sampler) {
+    lock_guard lock{mutex};
+    uint32_t slot = textureSlots.allocate();
+    if (slot != invalidSlot) {
+        writeTexture(slot, view, sampler);
+    }
+    return slot;
+}
+
+void BindlessTable::releaseTexture(uint32_t slot) {
+    // frames in flight may still read the descriptor through this index
+    retire([this, slot]() {
+        lock_guard lock{mutex};
+        textureSlots.free(slot);
+    });
+}
+
+uint32_t BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    lock_guard lock{mutex};
+    uint32_t slot = bufferSlots.allocate();
+    if (slot != invalidSlot) {
+        writeBuffer(slot, buffer, offset, range);
+    }
+    return slot;
+}
+
+void BindlessTable::releaseBuffer(uint32_t slot) {
+    retire([this, slot]() {
+        lock_guard lock{mutex};
+        bufferSlots.free(slot);
+    });
+}
+
+void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, 0, 1, &set, 0, nullptr);
+}
+
+void BindlessTable::pushDraw(VkCommandBuffer commandBuffer, const DrawConstants &constants) const {
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_ALL, 0, sizeof(DrawConstants), &constants);
+}
+
+void BindlessTable::writeTexture(uint32_t slot, VkImageView view, VkSampler sampler) {
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler != VK_NULL_HANDLE ? sampler : defaultSampler;
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = textureBinding;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void BindlessTable::writeBuffer(uint32_t slot, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = bufferBinding;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void BindlessTable::printStats(ostream &out) const {
+    lock_guard lock{mutex};
+    out << "bindless : " << textureSlots.used() << " / " << textureSlots.capacity() << " textures, " << bufferSlots.used() << " / "
+        << bufferSlots.capacity() << " buffers" << endl;
+}
+} // namespace vkDescriptors
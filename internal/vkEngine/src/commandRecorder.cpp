@@ -0,0 +1,102 @@
+#include "headers/commandRecorder.hpp"
+#include "headers/profiler.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkCommand {
+
+ParallelRecorder::ParallelRecorder(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, vkJobs::JobSystem &jobSystem,
+                                   const VkAllocationCallbacks *hostCallbacks)
+    : device(device), hostCallbacks(hostCallbacks), jobSystem(jobSystem) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // buffers are never reset one by one, the whole pool is
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    pools.resize(framesInFlight);
+    for (auto &framePools : pools) {
+        framePools.resize(jobSystem.workerCount());
+        for (auto &threadPool : framePools) {
+            if (vkCreateCommandPool(device, &poolInfo, hostCallbacks, &threadPool.pool) != VK_SUCCESS) {
+                throw std::runtime_error{"failed to create a recording command pool!"};
+            }
+        }
+    }
+}
+
+ParallelRecorder::~ParallelRecorder() {
+    // destroying a pool frees its buffers
+    for (auto &framePools : pools) {
+        for (auto &threadPool : framePools) {
+            vkDestroyCommandPool(device, threadPool.pool, hostCallbacks);
+        }
+    }
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex) {
+    for (auto &threadPool : pools[frameIndex]) {
+        if (threadPool.used > 0) {
+            vkResetCommandPool(device, threadPool.pool, 0);
+            threadPool.used = 0;
+        }
+    }
+}
+
+const vector<VkCommandBuffer> &ParallelRecorder::record(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer,
+                                                        const vector<RecordTask> &tasks) {
+    recorded.assign(tasks.size(), VK_NULL_HANDLE);
+
+    // one task per job, the slot a buffer is written to keeps the order fixed whoever records it
+    jobSystem.parallelFor(static_cast<uint32_t>(tasks.size()), 1, [&](uint32_t begin, uint32_t end) {
+        ThreadPool &threadPool = pools[frameIndex][vkJobs::JobSystem::workerIndex()];
+
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderPass;
+        inheritance.subpass = 0;
+        // known when recording, lets the driver skip resolving it at execute time
+        inheritance.framebuffer = framebuffer;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+
+        for (uint32_t task = begin; task < end; task++) {
+            PROFILE_ZONE("record task");
+            VkCommandBuffer commandBuffer = acquireBuffer(threadPool);
+            if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                throw std::runtime_error{"failed to begin recording secondary command buffer!"};
+            }
+            tasks[task](commandBuffer);
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error{"failed to record secondary command buffer!"};
+            }
+            recorded[task] = commandBuffer;
+        }
+    });
+    return recorded;
+}
+
+VkCommandBuffer ParallelRecorder::acquireBuffer(ThreadPool &threadPool) {
+    if (threadPool.used == threadPool.buffers.size()) {
+        // buffers stay allocated across resets, so this only happens while the task count grows
+        size_t grow = max<size_t>(threadPool.buffers.size(), 4);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = threadPool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = static_cast<uint32_t>(grow);
+
+        size_t first = threadPool.buffers.size();
+        threadPool.buffers.resize(first + grow);
+        if (vkAllocateCommandBuffers(device, &allocInfo, threadPool.buffers.data() + first) != VK_SUCCESS) {
+            threadPool.buffers.resize(first);
+            throw std::runtime_error{"failed to allocate secondary command buffers!"};
+        }
+    }
+    return threadPool.buffers[threadPool.used++];
+}
+} // namespace vkCommand
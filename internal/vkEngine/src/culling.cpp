@@ -0,0 +1,103 @@
+#include "headers/culling.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace vkCulling {
+
+Frustum Frustum::fromViewProjection(const glm::mat4 &viewProjection) {
+    // rows of the matrix, clip space is -w <= x, y <= w and 0 <= z <= w
+    glm::mat4 rows = glm::transpose(viewProjection);
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+    for (auto &plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+VkDrawIndexedIndirectCommand drawCommand(const CullInstance &instance) {
+    return {instance.indexCount, 1, instance.firstIndex, instance.vertexOffset, instance.instanceIndex};
+}
+
+uint32_t cullScalar(const Frustum &frustum, span<const CullInstance> instances, VkDrawIndexedIndirectCommand *out) {
+    uint32_t visible = 0;
+    for (const auto &instance : instances) {
+        glm::vec3 center{instance.sphere};
+        bool inside = true;
+        for (const auto &plane : frustum.planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w + instance.sphere.w < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) {
+            out[visible++] = drawCommand(instance);
+        }
+    }
+    return visible;
+}
+
+void CpuCuller::setInstances(span<const CullInstance> source) {
+    instances.assign(source.begin(), source.end());
+    blocks.resize((instances.size() + 3) / 4);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        Block &block = blocks[b];
+        for (int lane = 0; lane < 4; lane++) {
+            size_t index = b * 4 + lane;
+            // padding lanes get a radius no plane distance can make up for, they are never visible
+            glm::vec4 sphere{0.0f, 0.0f, 0.0f, -numeric_limits<float>::max()};
+            if (index < instances.size()) {
+                sphere = instances[index].sphere;
+            }
+            block.x[lane] = sphere.x;
+            block.y[lane] = sphere.y;
+            block.z[lane] = sphere.z;
+            block.radius[lane] = sphere.w;
+        }
+    }
+}
+
+uint32_t CpuCuller::cull(const Frustum &frustum, VkDrawIndexedIndirectCommand *out, size_t firstInstance, size_t count) const {
+    PROFILE_ZONE("cpu culling");
+    // every plane component broadcast to all four lanes once, not per block
+    struct Plane {
+        glm::aligned_vec4 x, y, z, w;
+    };
+    Plane planes[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4 &plane = frustum.planes[p];
+        planes[p] = {glm::aligned_vec4(plane.x), glm::aligned_vec4(plane.y), glm::aligned_vec4(plane.z), glm::aligned_vec4(plane.w)};
+    }
+
+    size_t lastInstance = min(instances.size(), firstInstance + min(count, instances.size()));
+    size_t lastBlock = (lastInstance + 3) / 4;
+    uint32_t visible = 0;
+    for (size_t b = firstInstance / 4; b < lastBlock; b++) {
+        const Block &block = blocks[b];
+        // smallest signed distance of the sphere surfaces to any plane, branch free over all six planes
+        glm::aligned_vec4 margin = block.x * planes[0].x + block.y * planes[0].y + block.z * planes[0].z + planes[0].w + block.radius;
+        for (int p = 1; p < 6; p++) {
+            glm::aligned_vec4 distance = block.x * planes[p].x + block.y * planes[p].y + block.z * planes[p].z + planes[p].w + block.radius;
+            margin = glm::min(margin, distance);
+        }
+        if (!glm::any(glm::greaterThanEqual(margin, glm::aligned_vec4(0.0f)))) {
+            continue;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            size_t index = b * 4 + lane;
+            if (margin[lane] >= 0.0f && index >= firstInstance && index < lastInstance) {
+                out[visible++] = drawCommand(instances[index]);
+            }
+        }
+    }
+    return visible;
+}
+} // namespace vkCulling
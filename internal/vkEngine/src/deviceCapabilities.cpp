@@ -0,0 +1,116 @@
+#include "headers/deviceCapabilities.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, const vector<VkQueueFamilyProperties> &queueFamilies) {
+    QueueFamilyIndices indices;
+
+    // look at every family, the first match is not necessarily the best one
+    for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+        const auto &queue = queueFamilies[i];
+        indices.queueCounts.push_back(queue.queueCount);
+
+        VkBool32 presentSupport = false;
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
+
+        bool graphics = queue.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool compute = queue.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool transfer = queue.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+        // prefer a graphics family that can also present, it saves ownership transfers of swapchain images
+        if (graphics && (!indices.graphicsFamily.has_value() || (presentSupport && indices.presentFamily != indices.graphicsFamily))) {
+            indices.graphicsFamily = i;
+        }
+        if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i)) {
+            indices.presentFamily = i;
+        }
+        if (compute && !graphics && !indices.computeFamily.has_value()) {
+            indices.computeFamily = i;
+        }
+        if (transfer && !graphics && !compute && !indices.transferFamily.has_value()) {
+            indices.transferFamily = i;
+        }
+    }
+    return indices;
+}
+} // namespace
+
+bool DeviceCapabilities::hasExtension(const char *name) const {
+    return binary_search(extensions.begin(), extensions.end(), string_view{name});
+}
+
+bool DeviceCapabilities::hasExtensions(const vector<const char *> &names) const {
+    return all_of(names.begin(), names.end(), [this](const char *name) { return hasExtension(name); });
+}
+
+bool DeviceCapabilities::supportsBindless() const {
+    const auto &features = descriptorIndexing;
+    return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending &&
+           features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind &&
+           features.shaderSampledImageArrayNonUniformIndexing && features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+DeviceCapabilities queryDeviceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+    PROFILE_ZONE("queryDeviceCapabilities");
+    DeviceCapabilities caps;
+    caps.physicalDevice = physicalDevice;
+    vkGetPhysicalDeviceProperties(physicalDevice, &caps.properties);
+    vkGetPhysicalDeviceFeatures(physicalDevice, &caps.features);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &caps.memoryProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    caps.queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, caps.queueFamilies.data());
+    caps.queues = findQueueFamilies(physicalDevice, surface, caps.queueFamilies);
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    vector<VkExtensionProperties> available(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, available.data());
+    caps.extensions.reserve(available.size());
+    for (const auto &extension : available) {
+        caps.extensions.emplace_back(extension.extensionName);
+    }
+    sort(caps.extensions.begin(), caps.extensions.end());
+
+    // the properties2 query is core since 1.1, which the instance asks for
+    if (caps.properties.apiVersion >= VK_API_VERSION_1_1 && caps.hasExtension(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties{};
+        hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &hostProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        caps.minImportedHostPointerAlignment = hostProperties.minImportedHostPointerAlignment;
+    }
+
+    // the extension needs VK_KHR_maintenance3, which is core in 1.1
+    if (caps.properties.apiVersion >= VK_API_VERSION_1_1 && caps.hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        caps.descriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &caps.descriptorIndexing;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        caps.descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &caps.descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        // the snapshot is copied around, it must not point into a chain
+        caps.descriptorIndexing.pNext = nullptr;
+        caps.descriptorIndexingProperties.pNext = nullptr;
+    }
+
+    if (surface != VK_NULL_HANDLE && caps.hasExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+        caps.swapChainSupport = vkWSIHelper::querySwapChainSupport(physicalDevice, surface);
+    }
+    return caps;
+}
@@ -0,0 +1,334 @@
+#include "headers/drawCuller.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkCulling {
+
+namespace {
+
+constexpr uint32_t workgroupSize = 64;
+constexpr VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+
+VkBufferMemoryBarrier bufferBarrier(VkBuffer buffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    return barrier;
+}
+} // namespace
+
+const char *pathName(CullPath path) {
+    switch (path) {
+    case CullPath::GpuCompacted:
+        return "gpu compacted";
+    case CullPath::GpuInPlace:
+        return "gpu in place";
+    case CullPath::Cpu:
+        return "cpu";
+    }
+    return "unknown";
+}
+
+DrawCuller::DrawCuller(VkDevice device, const DeviceCapabilities &capabilities, vkMemory::Allocator &allocator,
+                       const VkAllocationCallbacks *hostCallbacks, RetireFunction retire, vkPipeline::PipelineCache *pipelineCache,
+                       VkShaderModule cullShader, PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount, uint32_t maxInstances,
+                       uint32_t framesInFlight)
+    : device(device), allocator(allocator), hostCallbacks(hostCallbacks), retire(std::move(retire)),
+      drawIndexedIndirectCount(drawIndexedIndirectCount), maxInstances(max(maxInstances, 1u)),
+      maxDrawIndirectCount(max(capabilities.properties.limits.maxDrawIndirectCount, 1u)),
+      frustum(Frustum::fromViewProjection(glm::mat4{1.0f})) {
+    // indirect commands may only start at instance 0 without drawIndirectFirstInstance, which would lose the instance index
+    multiDraw = capabilities.features.multiDrawIndirect && capabilities.features.drawIndirectFirstInstance;
+    if (cullShader == VK_NULL_HANDLE || !multiDraw) {
+        cullPath = CullPath::Cpu;
+    } else if (drawIndexedIndirectCount != nullptr && this->maxInstances <= maxDrawIndirectCount) {
+        cullPath = CullPath::GpuCompacted;
+    } else {
+        // the compacted draws go out in one call, which can not take more than maxDrawIndirectCount of them.
+        // the in place ones are split into several
+        cullPath = CullPath::GpuInPlace;
+    }
+
+    if (cullPath == CullPath::Cpu) {
+        cpuFrames.resize(max(framesInFlight, 1u));
+        for (auto &frame : cpuFrames) {
+            frame.commands.reserve(this->maxInstances);
+            if (multiDraw) {
+                frame.buffer = createBuffer(this->maxInstances * commandStride, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.allocation);
+            }
+        }
+        return;
+    }
+
+    instanceBuffer = createBuffer(this->maxInstances * sizeof(CullInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceAllocation);
+    // transfer source so tools can read the results back
+    VkBufferUsageFlags drawUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    draws = createBuffer(this->maxInstances * commandStride, drawUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawAllocation);
+    count = createBuffer(sizeof(uint32_t), drawUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         countAllocation);
+    createPipeline(pipelineCache, cullShader);
+}
+
+DrawCuller::~DrawCuller() {
+    vkDestroyPipeline(device, pipeline, hostCallbacks);
+    // frees the set with it
+    vkDestroyDescriptorPool(device, pool, hostCallbacks);
+    vkDestroyPipelineLayout(device, layout, hostCallbacks);
+    vkDestroyDescriptorSetLayout(device, setLayout, hostCallbacks);
+    for (auto [buffer, allocation] : {pair{instanceBuffer, instanceAllocation}, pair{draws, drawAllocation}, pair{count, countAllocation},
+                                      pair{staging, stagingAllocation}}) {
+        vkDestroyBuffer(device, buffer, hostCallbacks);
+        allocator.free(allocation);
+    }
+    for (auto &frame : cpuFrames) {
+        vkDestroyBuffer(device, frame.buffer, hostCallbacks);
+        allocator.free(frame.allocation);
+    }
+}
+
+VkBuffer DrawCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                  vkMemory::Allocation &allocation) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling buffer!"};
+    }
+    allocation = allocator.allocateBuffer(buffer, properties);
+    return buffer;
+}
+
+void DrawCuller::createPipeline(vkPipeline::PipelineCache *pipelineCache, VkShaderModule cullShader) {
+    // instances, draws, count
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    for (uint32_t i = 0; i < 3; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, hostCallbacks, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling descriptor set layout!"};
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(CullConstants);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostCallbacks, &layout) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling pipeline layout!"};
+    }
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, hostCallbacks, &pool) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling descriptor pool!"};
+    }
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to allocate culling descriptor set!"};
+    }
+
+    // the buffers never change, the set is written once
+    VkDescriptorBufferInfo bufferInfos[3] = {
+        {instanceBuffer, 0, VK_WHOLE_SIZE},
+        {draws, 0, VK_WHOLE_SIZE},
+        {count, 0, VK_WHOLE_SIZE},
+    };
+    VkWriteDescriptorSet writes[3]{};
+    for (uint32_t i = 0; i < 3; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
+    if (pipelineCache != nullptr) {
+        pipeline = pipelineCache->createComputePipeline(pipelineInfo);
+    } else if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, hostCallbacks, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling pipeline!"};
+    }
+}
+
+void DrawCuller::setInstances(span<const CullInstance> source) {
+    PROFILE_ZONE("set cull instances");
+    if (source.size() > maxInstances) {
+        throw std::runtime_error{"the draw culler holds at most " + to_string(maxInstances) + " instances!"};
+    }
+    instances.assign(source.begin(), source.end());
+    if (cullPath == CullPath::Cpu) {
+        cpuCuller.setInstances(instances);
+        return;
+    }
+
+    // a staged upload the gpu never saw can go right away, retiring keeps it simple
+    if (staging != VK_NULL_HANDLE) {
+        retire([device = device, callbacks = hostCallbacks, &allocator = allocator, staging = staging, allocation = stagingAllocation]() {
+            vkDestroyBuffer(device, staging, callbacks);
+            allocator.free(allocation);
+        });
+        staging = VK_NULL_HANDLE;
+        stagingAllocation = {};
+    }
+    if (instances.empty()) {
+        return;
+    }
+    VkDeviceSize size = instances.size() * sizeof(CullInstance);
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &staging) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create culling staging buffer!"};
+    }
+    stagingAllocation = allocator.allocateBuffer(staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                 vkMemory::Strategy::Linear);
+    memcpy(stagingAllocation.mapped, instances.data(), size);
+}
+
+void DrawCuller::setViewProjection(const glm::mat4 &viewProjection) {
+    frustum = Frustum::fromViewProjection(viewProjection);
+}
+
+void DrawCuller::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    PROFILE_ZONE("cull draws");
+    if (cullPath != CullPath::Cpu) {
+        cullOnGpu(commandBuffer);
+        return;
+    }
+    // the fence of this frame slot has been waited on, nothing reads its commands anymore
+    auto &frame = cpuFrames[frameIndex];
+    frame.commands.resize(instances.size());
+    frame.drawCount = cpuCuller.cull(frustum, frame.commands.data());
+    if (frame.buffer != VK_NULL_HANDLE && frame.drawCount > 0) {
+        memcpy(frame.allocation.mapped, frame.commands.data(), frame.drawCount * commandStride);
+    }
+}
+
+void DrawCuller::cullOnGpu(VkCommandBuffer commandBuffer) {
+    vector<VkBufferMemoryBarrier> barriers;
+    if (staging != VK_NULL_HANDLE) {
+        // earlier dispatches may still read the old instances
+        VkBufferMemoryBarrier beforeCopy = bufferBarrier(instanceBuffer, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1,
+                             &beforeCopy, 0, nullptr);
+        VkBufferCopy copy{0, 0, instances.size() * sizeof(CullInstance)};
+        vkCmdCopyBuffer(commandBuffer, staging, instanceBuffer, 1, &copy);
+        barriers.push_back(bufferBarrier(instanceBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+        retire([device = device, callbacks = hostCallbacks, &allocator = allocator, staging = staging, allocation = stagingAllocation]() {
+            vkDestroyBuffer(device, staging, callbacks);
+            allocator.free(allocation);
+        });
+        staging = VK_NULL_HANDLE;
+        stagingAllocation = {};
+    }
+    if (cullPath == CullPath::GpuCompacted) {
+        vkCmdFillBuffer(commandBuffer, count, 0, sizeof(uint32_t), 0);
+        barriers.push_back(bufferBarrier(count, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+    }
+    if (!barriers.empty()) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+    }
+    if (instances.empty()) {
+        return;
+    }
+
+    CullConstants constants{};
+    copy(begin(frustum.planes), end(frustum.planes), constants.planes);
+    constants.instanceCount = static_cast<uint32_t>(instances.size());
+    constants.compact = cullPath == CullPath::GpuCompacted ? 1 : 0;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (constants.instanceCount + workgroupSize - 1) / workgroupSize, 1, 1);
+}
+
+void DrawCuller::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+    // a single multi draw is limited to maxDrawIndirectCount commands
+    auto multiDrawIndirect = [&](VkBuffer buffer, uint32_t drawCount) {
+        for (uint32_t first = 0; first < drawCount; first += maxDrawIndirectCount) {
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, first * commandStride, min(maxDrawIndirectCount, drawCount - first),
+                                     static_cast<uint32_t>(commandStride));
+        }
+    };
+    uint32_t instanceCount = static_cast<uint32_t>(instances.size());
+    switch (cullPath) {
+    case CullPath::GpuCompacted:
+        // at most maxInstances, which the constructor checked against maxDrawIndirectCount
+        if (instanceCount > 0) {
+            drawIndexedIndirectCount(commandBuffer, draws, 0, count, 0, instanceCount, static_cast<uint32_t>(commandStride));
+        }
+        break;
+    case CullPath::GpuInPlace:
+        multiDrawIndirect(draws, instanceCount);
+        break;
+    case CullPath::Cpu: {
+        const auto &frame = cpuFrames[frameIndex];
+        if (frame.buffer != VK_NULL_HANDLE) {
+            multiDrawIndirect(frame.buffer, frame.drawCount);
+            break;
+        }
+        for (uint32_t i = 0; i < frame.drawCount; i++) {
+            const auto &command = frame.commands[i];
+            vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset,
+                             command.firstInstance);
+        }
+        break;
+    }
+    }
+}
+
+void DrawCuller::printStats(ostream &out) const {
+    out << "culling : " << pathName(cullPath) << ", " << instances.size() << " / " << maxInstances << " instances";
+    if (cullPath == CullPath::Cpu) {
+        out << ", " << cpuFrames.front().drawCount << " visible";
+    }
+    out << endl;
+}
+} // namespace vkCulling
@@ -0,0 +1,243 @@
+#include "headers/drawQueue.hpp"
+#include "headers/profiler.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkDraw {
+
+namespace {
+
+// positive floats order like their bits, the top 16 keep sign, exponent and 7 mantissa bits
+uint64_t depthBits(float depth) {
+    if (!(depth > 0.0f)) {
+        return 0;
+    }
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 16;
+}
+} // namespace
+
+MeshState meshState(const vkAssets::GpuMesh &mesh) {
+    MeshState state{};
+    state.vertexBuffer = mesh.buffer;
+    state.vertexBufferOffset = mesh.streams[meshFormat::Vertices].offset;
+    state.indexBuffer = mesh.buffer;
+    state.indexBufferOffset = mesh.streams[meshFormat::Indices].offset;
+    state.indexType = VK_INDEX_TYPE_UINT32;
+    state.indexCount = mesh.indexCount;
+    return state;
+}
+
+void radixSort(vector<SortEntry> &entries, vector<SortEntry> &scratch) {
+    PROFILE_ZONE("radix sort");
+    size_t count = entries.size();
+    scratch.resize(count);
+    if (count < 2) {
+        return;
+    }
+    // the histograms of all eight bytes in one pass over the keys
+    uint32_t histograms[8][256] = {};
+    for (const auto &entry : entries) {
+        for (uint32_t byte = 0; byte < 8; byte++) {
+            histograms[byte][(entry.key >> (byte * 8)) & 0xff]++;
+        }
+    }
+    SortEntry *src = entries.data();
+    SortEntry *dst = scratch.data();
+    for (uint32_t byte = 0; byte < 8; byte++) {
+        uint32_t shift = byte * 8;
+        uint32_t *offsets = histograms[byte];
+        // every key has the same value in this byte, the pass would not move anything
+        if (offsets[(src[0].key >> shift) & 0xff] == count) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < 256; digit++) {
+            uint32_t digitCount = offsets[digit];
+            offsets[digit] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+        }
+        swap(src, dst);
+    }
+    // an odd number of passes left the result in scratch
+    if (src != entries.data()) {
+        entries.swap(scratch);
+    }
+}
+
+DrawQueue::DrawQueue(VkDevice device, vkMemory::Allocator &allocator, const VkAllocationCallbacks *hostCallbacks, uint32_t maxDraws,
+                     uint32_t framesInFlight)
+    : device(device), allocator(allocator), hostCallbacks(hostCallbacks), maxDraws(max(maxDraws, 1u)) {
+    draws.reserve(this->maxDraws);
+    entries.reserve(this->maxDraws);
+    scratch.reserve(this->maxDraws);
+    instanceBuffers.resize(max(framesInFlight, 1u));
+    for (auto &frame : instanceBuffers) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = VkDeviceSize{this->maxDraws} * sizeof(uint32_t);
+        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &frame.buffer) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create draw instance buffer!"};
+        }
+        frame.allocation = allocator.allocateBuffer(frame.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+}
+
+DrawQueue::~DrawQueue() {
+    for (auto &frame : instanceBuffers) {
+        vkDestroyBuffer(device, frame.buffer, hostCallbacks);
+        allocator.free(frame.allocation);
+    }
+}
+
+PipelineId DrawQueue::addPipeline(const PipelineState &state) {
+    if (pipelines.size() >= (1u << 12)) {
+        throw std::runtime_error{"draw queue holds at most 4096 pipelines!"};
+    }
+    pipelines.push_back(state);
+    return static_cast<PipelineId>(pipelines.size() - 1);
+}
+
+MaterialId DrawQueue::addMaterial(const MaterialState &state) {
+    if (materials.size() >= (1u << 16)) {
+        throw std::runtime_error{"draw queue holds at most 65536 materials!"};
+    }
+    materials.push_back(state);
+    return static_cast<MaterialId>(materials.size() - 1);
+}
+
+MeshId DrawQueue::addMesh(const MeshState &state) {
+    if (meshes.size() >= (1u << 16)) {
+        throw std::runtime_error{"draw queue holds at most 65536 meshes!"};
+    }
+    meshes.push_back(state);
+    return static_cast<MeshId>(meshes.size() - 1);
+}
+
+void DrawQueue::setPassOrder(uint32_t pass, PassOrder order) {
+    if (pass >= maxPasses) {
+        throw std::runtime_error{"draw queue has only " + to_string(maxPasses) + " passes!"};
+    }
+    passOrders[pass] = order;
+}
+
+uint64_t DrawQueue::makeKey(uint32_t pass, const Draw &draw, float depth) const {
+    uint64_t key = uint64_t{pass} << 60;
+    uint64_t state = uint64_t{draw.pipeline} << 32 | uint64_t{draw.material} << 16 | draw.mesh;
+    if (passOrders[pass] == PassOrder::BackToFront) {
+        return key | (~depthBits(depth) & 0xffff) << 44 | state;
+    }
+    return key | state << 16 | depthBits(depth);
+}
+
+void DrawQueue::submit(uint32_t pass, PipelineId pipeline, MaterialId material, MeshId mesh, float depth, uint32_t instance) {
+    if (draws.size() >= maxDraws) {
+        throw std::runtime_error{"draw queue holds at most " + to_string(maxDraws) + " draws per frame!"};
+    }
+    if (pass >= maxPasses || pipeline >= pipelines.size() || material >= materials.size() || mesh >= meshes.size()) {
+        throw std::runtime_error{"draw submitted with an unknown pass or state!"};
+    }
+    Draw draw{pipeline, material, mesh, instance};
+    entries.push_back({makeKey(pass, draw, depth), static_cast<uint32_t>(draws.size())});
+    draws.push_back(draw);
+}
+
+void DrawQueue::sort(uint32_t frameIndex) {
+    PROFILE_ZONE("sort draws");
+    radixSort(entries, scratch);
+    frameStats = {};
+    frameStats.submitted = static_cast<uint32_t>(draws.size());
+    // the fence of this frame slot has been waited on, nothing reads its instances anymore
+    const auto &frame = instanceBuffers[frameIndex];
+    buildBatches(static_cast<uint32_t *>(frame.allocation.mapped));
+    currentInstances = frame.buffer;
+    draws.clear();
+    entries.clear();
+}
+
+void DrawQueue::buildBatches(uint32_t *out) {
+    batches.clear();
+    uint32_t currentPass = 0;
+    passStarts[0] = 0;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        const Draw &draw = draws[entries[i].index];
+        out[i] = draw.instance;
+        uint32_t pass = static_cast<uint32_t>(entries[i].key >> 60);
+        bool newPass = batches.empty() || pass != currentPass;
+        for (; currentPass < pass; currentPass++) {
+            passStarts[currentPass + 1] = static_cast<uint32_t>(batches.size());
+        }
+        // the previous batch of the same pass decides what is still bound
+        const Batch *previous = newPass ? nullptr : &batches.back();
+        if (previous != nullptr && previous->pipeline == draw.pipeline && previous->material == draw.material &&
+            previous->mesh == draw.mesh) {
+            batches.back().instanceCount++;
+            continue;
+        }
+        const MeshState &mesh = meshes[draw.mesh];
+        Batch batch{draw.pipeline, draw.material, draw.mesh, i, 1, true, true, true, true};
+        if (previous != nullptr) {
+            const MeshState &previousMesh = meshes[previous->mesh];
+            batch.bindPipeline = previous->pipeline != draw.pipeline;
+            batch.bindMaterial =
+                previous->material != draw.material || pipelines[previous->pipeline].layout != pipelines[draw.pipeline].layout;
+            batch.bindVertexBuffer =
+                previousMesh.vertexBuffer != mesh.vertexBuffer || previousMesh.vertexBufferOffset != mesh.vertexBufferOffset;
+            batch.bindIndexBuffer = previousMesh.indexBuffer != mesh.indexBuffer ||
+                                    previousMesh.indexBufferOffset != mesh.indexBufferOffset || previousMesh.indexType != mesh.indexType;
+        }
+        frameStats.drawCalls++;
+        frameStats.pipelineBinds += batch.bindPipeline;
+        frameStats.descriptorBinds += batch.bindMaterial;
+        frameStats.vertexBufferBinds += batch.bindVertexBuffer;
+        frameStats.indexBufferBinds += batch.bindIndexBuffer;
+        batches.push_back(batch);
+    }
+    for (; currentPass < maxPasses; currentPass++) {
+        passStarts[currentPass + 1] = static_cast<uint32_t>(batches.size());
+    }
+}
+
+void DrawQueue::record(VkCommandBuffer commandBuffer, uint32_t pass) const {
+    if (pass >= maxPasses || passStarts[pass] == passStarts[pass + 1]) {
+        return;
+    }
+    VkDeviceSize instanceOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, instanceBinding, 1, &currentInstances, &instanceOffset);
+    for (uint32_t i = passStarts[pass]; i < passStarts[pass + 1]; i++) {
+        const Batch &batch = batches[i];
+        const PipelineState &pipeline = pipelines[batch.pipeline];
+        const MeshState &mesh = meshes[batch.mesh];
+        if (batch.bindPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+        }
+        if (batch.bindMaterial) {
+            const MaterialState &material = materials[batch.material];
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, material.setIndex, 1, &material.set, 0,
+                                    nullptr);
+        }
+        if (batch.bindVertexBuffer) {
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &mesh.vertexBufferOffset);
+        }
+        if (batch.bindIndexBuffer) {
+            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, mesh.indexBufferOffset, mesh.indexType);
+        }
+        vkCmdDrawIndexed(commandBuffer, mesh.indexCount, batch.instanceCount, mesh.firstIndex, mesh.vertexOffset, batch.firstInstance);
+    }
+}
+
+void DrawQueue::printStats(ostream &out) const {
+    out << "draws : " << frameStats.submitted << " submitted, " << frameStats.drawCalls << " draw calls, " << frameStats.pipelineBinds
+        << " pipeline / " << frameStats.descriptorBinds << " descriptor / " << frameStats.vertexBufferBinds << " vertex / "
+        << frameStats.indexBufferBinds << " index binds in the last frame" << endl;
+}
+} // namespace vkDraw
@@ -1,5 +1,6 @@
 #include "headers/engine.hpp"
 #include <cstring>
+#include <headers/messageLog.hpp>
 #include <headers/vulkanValidation.hpp>
 #include <vector>
 
@@ -7,34 +8,215 @@ using namespace std;
 
 const bool logSupported = false;
 
-GEngine::GEngine(uint32_t width, uint32_t height) : width(width), height(height) {
+ContextConfig contextConfigFor(const EngineConfig &config) {
+    ContextConfig context;
+    context.presentable = !config.headless;
+    context.preferredDevice = config.preferredDevice;
+    context.pipelineCachePath = config.pipelineCachePath;
+    context.shaderArchivePath = config.shaderArchivePath;
+    context.workerThreads = config.workerThreads;
+    context.importHostMemory = config.importHostMemory;
+    return context;
+}
+
+GEngine::GEngine(uint32_t width, uint32_t height, EngineConfig config)
+    : GEngine(make_shared<EngineContext>(contextConfigFor(config)), width, height, config) {
+}
+
+GEngine::GEngine(shared_ptr<EngineContext> context, uint32_t width, uint32_t height, EngineConfig config)
+    : width(width), height(height), config(config), context(std::move(context)), jobSystem(&this->context->getJobSystem()),
+      hostAllocator(this->context->getHostAllocator()) {
+    for (FrameTiming *timing : {&frameStats.fenceWait, &frameStats.acquire, &frameStats.cpuFrame, &frameStats.gpuFrame}) {
+        timing->keepHistory = config.keepFrameHistory;
+    }
+}
+
+vkJobs::JobSystem &GEngine::getJobSystem() {
+    return *jobSystem;
+}
+
+VkDevice GEngine::getDevice() const {
+    return device;
 }
 
 void GEngine::run() {
-    initWindow();
-    initVulkan();
+    start();
     mainLoop();
+    stop();
+    if (!config.tracePath.empty()) {
+        if (exportTrace(config.tracePath)) {
+            cout << "wrote trace " << config.tracePath << endl;
+        } else {
+            cerr << "failed to write trace " << config.tracePath << endl;
+        }
+    }
+}
+
+void GEngine::start() {
+    runStart = chrono::steady_clock::now();
+    initVulkan();
+}
+
+void GEngine::renderFrame() {
+    drawFrame();
+}
+
+bool GEngine::finished() const {
+    if (config.headless) {
+        return frameStats.frameCount >= config.headlessFrameCount;
+    }
+    return glfwWindowShouldClose(window) || (config.windowedFrameCount != 0 && frameStats.frameCount >= config.windowedFrameCount);
+}
+
+bool GEngine::frameReady() const {
+    return vkGetFenceStatus(device, frames[currentFrame].inFlight) == VK_SUCCESS;
+}
+
+void GEngine::stop() {
+    PROFILE_ZONE("stop");
+    // other sessions of the context keep their work in flight, this only stalls them once per session
+    vkDeviceWaitIdle(device);
+    // so the stats below count every frame
+    if (readback) {
+        readback->flush();
+    }
+    printStats();
     cleanup();
 }
 
+bool GEngine::exportTrace(const std::string &path) const {
+    return vkProfiler::exportChromeTrace(path);
+}
+
 void GEngine::initWindow() {
-    glfwInit();
+    PROFILE_ZONE("initWindow");
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     this->window = glfwCreateWindow(this->width, this->height, "Vulkan", nullptr, nullptr);
+    glfwSetWindowUserPointer(this->window, this);
+    glfwSetFramebufferSizeCallback(this->window, framebufferResizeCallback);
+}
+
+void GEngine::adoptContext() {
+    instance = context->instance;
+    physicalDevice = context->physicalDevice;
+    capabilities = context->capabilities;
+    device = context->device;
+    gpuAllocator = context->gpuAllocator.get();
+    pipelineCache = context->pipelineCache.get();
+    shaderArchive = context->shaderArchive.get();
+    graphicQueue = context->graphicQueue;
+    presentQueue = context->presentQueue;
+    graphicsQueueFamily = context->graphicsQueueFamily;
+    presentQueueFamily = context->presentQueueFamily;
+    transferQueueFamily = context->transferQueueFamily;
+    computeQueueFamily = context->computeQueueFamily;
+    transferQueues = context->transferQueues;
+    computeQueues = context->computeQueues;
+}
+
+void GEngine::framebufferResizeCallback(GLFWwindow *window, int width, int height) {
+    auto engine = reinterpret_cast<GEngine *>(glfwGetWindowUserPointer(window));
+    engine->framebufferResized = true;
 }
 
 void GEngine::initVulkan() {
-    this->linkVulkan();
-    this->setupDebugMessenger();
-    this->createSurface();
-    this->pickPhysicalDevice();
-    this->createLogicalDevice();
-    this->createSwapChain();
+    PROFILE_ZONE("initVulkan");
+    startupStages.clear();
+    auto stageStart = chrono::steady_clock::now();
+    // closes the stage running since the previous one
+    auto stage = [&](const char *name) {
+        auto now = chrono::steady_clock::now();
+        startupStages.push_back({name, chrono::duration<double, milli>(now - stageStart).count()});
+        stageStart = now;
+    };
+    if (!config.headless && !context->getConfig().presentable) {
+        throw std::runtime_error{"a windowed engine needs a context created with ContextConfig::presentable!"};
+    }
+    if (!context->ready()) {
+        // the instance only needs glfw initialized, not the window, so loading the drivers
+        // runs on the job system while the window is created on this thread
+        vkJobs::Counter instanceReady;
+        jobSystem->run([this]() { context->linkVulkan(); }, &instanceReady);
+        if (!config.headless) {
+            initWindow();
+        }
+        jobSystem->wait(instanceReady);
+        stage("instance");
+        context->setupDebugMessenger();
+        stage("setupDebugMessenger");
+        instance = context->getInstance();
+        if (!config.headless) {
+            this->createSurface();
+            stage("createSurface");
+        }
+        context->pickPhysicalDevice(surface);
+        stage("pickPhysicalDevice");
+        context->createLogicalDevice();
+        stage("createLogicalDevice");
+        context->createAllocator();
+        stage("createAllocator");
+        context->createPipelineCache();
+        stage("createPipelineCache");
+        context->loadShaderArchive();
+        stage("loadShaderArchive");
+        // only once every step went through, a context that threw half way is not handed out
+        context->initialized = true;
+        adoptContext();
+    } else {
+        // a session of a shared context, only its window is new
+        adoptContext();
+        if (!config.headless) {
+            initWindow();
+            this->createSurface();
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, presentQueueFamily, surface, &presentSupport);
+            if (!presentSupport) {
+                throw std::runtime_error{"the present queue of the shared context can not present to this window!"};
+            }
+            capabilities.swapChainSupport = vkWSIHelper::querySwapChainSupport(physicalDevice, surface);
+            stage("createSurface");
+        }
+    }
+    this->createBindlessTable();
+    stage("createBindlessTable");
+    this->createTextureStreamer();
+    stage("createTextureStreamer");
+    this->createDrawCuller();
+    stage("createDrawCuller");
+    if (config.headless) {
+        this->createOffscreenTargets();
+        stage("createOffscreenTargets");
+    } else {
+        this->createSwapChain();
+        stage("createSwapChain");
+    }
     this->createImageViews();
+    stage("createImageViews");
+    this->createRenderPass();
+    this->createFramebuffers();
+    this->createPresentSemaphores();
+    stage("createRenderPass");
+    this->createCommandPool();
+    stage("createCommandPool");
+    this->createQueueCommandPools();
+    stage("createQueueCommandPools");
+    this->createFrames();
+    stage("createFrames");
+    this->createFrameRing();
+    stage("createFrameRing");
+    this->createInstanceBuffers();
+    stage("createInstanceBuffers");
+    this->createDrawQueue();
+    stage("createDrawQueue");
+    this->createFrameGraph();
+    stage("createFrameGraph");
+    this->createReadback();
+    stage("createReadback");
 }
 
-void GEngine::linkVulkan() {
+void EngineContext::linkVulkan() {
+    PROFILE_ZONE("linkVulkan");
     if (vkValidate::enable && !vkValidate::checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested, but not available!");
     }
@@ -45,23 +227,27 @@ void GEngine::linkVulkan() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 for vkGetPhysicalDeviceProperties2 and external memory, both are used only when the device has them
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
+    // headless rendering needs no surface extensions at all
+    auto extensions = vkValidate::getRequiredExtensions(!config.presentable);
     VkDebugUtilsMessengerCreateInfoEXT ref{};
-    vkValidate::addValidation(createInfo, ref);
+    vkValidate::addValidation(createInfo, ref, extensions);
+    // checked before creating the instance, which would only fail with VK_ERROR_EXTENSION_NOT_PRESENT
+    vkValidate::checkRequiredAreSupportedExtensions(extensions);
 
-    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+    if (vkCreateInstance(&createInfo, hostAllocator.callbacks(), &instance) != VK_SUCCESS) {
         throw std::runtime_error("failed to create instance!");
     }
-
-    vkValidate::checkRequiredAreSupportedExtensions();
 }
 
-void GEngine::setupDebugMessenger() {
+void EngineContext::setupDebugMessenger() {
+    PROFILE_ZONE("setupDebugMessenger");
     if (!vkValidate::enable) {
         return;
     }
@@ -69,28 +255,83 @@ void GEngine::setupDebugMessenger() {
     VkDebugUtilsMessengerCreateInfoEXT createInfo{};
     vkValidate::populateDebugMessengerCreateInfo(createInfo, "debug");
 
-    if (vkValidate::CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+    if (vkValidate::CreateDebugUtilsMessengerEXT(instance, &createInfo, hostAllocator.callbacks(), &debugMessenger) != VK_SUCCESS) {
         throw std::runtime_error("failed to set up debug messenger!");
     }
 }
 
 void GEngine::mainLoop() {
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    PROFILE_ZONE("mainLoop");
+    while (!finished()) {
+        if (!config.headless) {
+            glfwPollEvents();
+        }
+        drawFrame();
+    }
+}
+
+void GEngine::printStats() const {
+    const auto &stats = getFrameStats();
+    cout << "rendered " << stats.frameCount << " frames, " << config.framesInFlight << " in flight" << endl;
+    cout << "\ttime to first frame " << stats.timeToFirstFrameMs << " ms" << endl;
+    cout << "\tcpu frame avg " << stats.cpuFrame.averageMs(stats.frameCount) << " ms, max " << stats.cpuFrame.maxMs << " ms" << endl;
+    cout << "\tfence wait avg " << stats.fenceWait.averageMs(stats.frameCount) << " ms, max " << stats.fenceWait.maxMs << " ms" << endl;
+    if (gpuProfiler->enabled()) {
+        cout << "\tgpu frame avg " << stats.gpuFrame.averageMs(stats.gpuFrame.samples) << " ms, max " << stats.gpuFrame.maxMs << " ms" << endl;
+    }
+    if (!config.headless) {
+        cout << "\tacquire avg " << stats.acquire.averageMs(stats.frameCount) << " ms, max " << stats.acquire.maxMs << " ms" << endl;
+    }
+    frameGraph->printStats(cout);
+    drawCuller->printStats(cout);
+    transformStore->printStats(cout);
+    drawQueue->printStats(cout);
+    frameRing->printStats(cout);
+    if (readback) {
+        readback->printStats(cout);
+    }
+    gpuAllocator->printStats(cout);
+    textureStreamer->printStats(cout);
+    if (bindlessTable) {
+        bindlessTable->printStats(cout);
     }
 }
 
 void GEngine::cleanup() {
+    PROFILE_ZONE("cleanup");
+    destroyRetired(true);
+    // writes out the frames still encoding
+    readback.reset();
+    frameGraph.reset();
+    drawCuller.reset();
+    drawQueue.reset();
+    frameRing.reset();
+    textureStreamer.reset();
+    bindlessTable.reset();
+    destroyQueueCommandPools();
+    destroyInstanceBuffers();
+    destroyFrames();
+    for (auto framebuffer : framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, hostAllocator.callbacks());
+    }
+    for (auto semaphore : renderFinished) {
+        vkDestroySemaphore(device, semaphore, hostAllocator.callbacks());
+    }
+    vkDestroyRenderPass(device, renderPass, hostAllocator.callbacks());
     for (auto imageView : swapChainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
-    }
-    vkDestroySwapchainKHR(this->device, this->swapChain, nullptr);
-    vkDestroyDevice(this->device, nullptr);
-    if (vkValidate::enable) {
-        vkValidate::DestroyDebugUtilsMessengerEXT(this->instance, this->debugMessenger, nullptr);
-    }
-    vkDestroySurfaceKHR(this->instance, surface, nullptr);
-    vkDestroyInstance(this->instance, nullptr);
-    glfwDestroyWindow(this->window);
-    glfwTerminate();
-}
\ No newline at end of file
+        vkDestroyImageView(device, imageView, hostAllocator.callbacks());
+    }
+    for (size_t i = 0; i < offscreenImages.size(); i++) {
+        vkDestroyImage(device, offscreenImages[i], hostAllocator.callbacks());
+        gpuAllocator->free(offscreenImageMemory[i]);
+    }
+    if (this->swapChain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(this->device, this->swapChain, hostAllocator.callbacks());
+    }
+    if (this->surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(this->instance, surface, hostAllocator.callbacks());
+    }
+    if (this->window != nullptr) {
+        glfwDestroyWindow(this->window);
+    }
+}
@@ -0,0 +1,96 @@
+#include "headers/engineContext.hpp"
+#include "headers/profiler.hpp"
+#include <chrono>
+#include <headers/messageLog.hpp>
+#include <headers/vulkanValidation.hpp>
+#include <iostream>
+
+using namespace std;
+
+EngineContext::EngineContext(ContextConfig config) : config(std::move(config)) {
+    // before any window, glfw has to be initialized on the thread that polls the events
+    if (this->config.presentable) {
+        glfwInit();
+    }
+    jobSystem = make_unique<vkJobs::JobSystem>(this->config.workerThreads);
+    cout << "job system running on " << jobSystem->workerCount() << " threads" << endl;
+}
+
+EngineContext::~EngineContext() {
+    if (pipelineCache) {
+        pipelineCache->save();
+        pipelineCache->printStats(cout);
+    }
+    pipelineCache.reset();
+    shaderArchive.reset();
+    gpuAllocator.reset();
+    if (device != VK_NULL_HANDLE) {
+        vkDestroyDevice(device, hostAllocator.callbacks());
+    }
+    if (debugMessenger != VK_NULL_HANDLE) {
+        vkValidate::DestroyDebugUtilsMessengerEXT(instance, debugMessenger, hostAllocator.callbacks());
+        vkValidate::messageLog().flush();
+        vkValidate::messageLog().printCounts(cout);
+    }
+    if (instance != VK_NULL_HANDLE) {
+        vkDestroyInstance(instance, hostAllocator.callbacks());
+    }
+    // anything still live here was leaked by the driver or by us
+    hostAllocator.printStats(cout);
+    if (config.presentable) {
+        glfwTerminate();
+    }
+}
+
+void EngineContext::init() {
+    PROFILE_ZONE("EngineContext::init");
+    auto start = chrono::steady_clock::now();
+    linkVulkan();
+    setupDebugMessenger();
+    pickPhysicalDevice();
+    createLogicalDevice();
+    createAllocator();
+    createPipelineCache();
+    loadShaderArchive();
+    initMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    initialized = true;
+}
+
+bool EngineContext::ready() const {
+    return initialized;
+}
+
+const ContextConfig &EngineContext::getConfig() const {
+    return config;
+}
+
+VkInstance EngineContext::getInstance() const {
+    return instance;
+}
+
+VkDevice EngineContext::getDevice() const {
+    return device;
+}
+
+vkJobs::JobSystem &EngineContext::getJobSystem() {
+    return *jobSystem;
+}
+
+vkMemory::HostAllocator &EngineContext::getHostAllocator() {
+    return hostAllocator;
+}
+
+vkMemory::Allocator &EngineContext::getAllocator() {
+    return *gpuAllocator;
+}
+
+double EngineContext::startupMs() const {
+    return initMs;
+}
+
+void EngineContext::printStats(ostream &out) const {
+    out << "context : " << capabilities.properties.deviceName << ", started in " << initMs << " ms" << endl;
+    if (gpuAllocator) {
+        gpuAllocator->printStats(out);
+    }
+}
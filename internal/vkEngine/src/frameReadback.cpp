@@ -0,0 +1,420 @@
+#include "headers/frameReadback.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace vkOutput {
+
+namespace {
+
+using readbackClock = chrono::steady_clock;
+
+double elapsedMs(readbackClock::time_point since) {
+    return chrono::duration<double, milli>(readbackClock::now() - since).count();
+}
+
+void writeAll(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, static_cast<unsigned int>(min<size_t>(size, 1u << 30)));
+#else
+        ssize_t written = ::write(fd, data, size);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error{"failed to write a frame to the output descriptor!"};
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+bool FrameReadback::supportsFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+FrameReadback::FrameReadback(VkDevice device, const DeviceCapabilities &capabilities, vkMemory::Allocator &allocator,
+                             const VkAllocationCallbacks *hostCallbacks, VkFormat format, VkExtent2D extent, const OutputConfig &config)
+    : device(device), allocator(allocator), hostCallbacks(hostCallbacks), config(config) {
+    atomSize = max<VkDeviceSize>(capabilities.properties.limits.nonCoherentAtomSize, 1);
+
+    size_t percent = config.path.find('%');
+    if (percent != string::npos) {
+        size_t at = percent + 1;
+        while (at < config.path.size() && isdigit(static_cast<unsigned char>(config.path[at]))) {
+            numberWidth = numberWidth * 10 + static_cast<uint32_t>(config.path[at++] - '0');
+        }
+        if (at >= config.path.size() || config.path[at] != 'd' || config.path.find('%', at) != string::npos) {
+            throw std::runtime_error{"output path " + config.path + " may only hold one %d or %0Nd!"};
+        }
+        perFrameFiles = true;
+        pathPrefix = config.path.substr(0, percent);
+        pathSuffix = config.path.substr(at + 1);
+    } else if (config.fd >= 0) {
+        streamFd = config.fd;
+    } else if (config.path == "-") {
+        streamFd = 1;
+    } else {
+        file.open(config.path, ios::binary | ios::trunc);
+        if (!file) {
+            throw std::runtime_error{"failed to open output " + config.path + "!"};
+        }
+    }
+
+    // cached memory makes the encoders read at memory speed, it may have to be invalidated though
+    deviceMemory = capabilities.memoryProperties;
+    memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < deviceMemory.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        if ((deviceMemory.memoryTypes[i].propertyFlags & cached) == cached) {
+            memoryProperties = cached;
+            break;
+        }
+    }
+    createSlots(format, extent);
+
+    for (uint32_t i = 0; i < max(config.encoderThreads, 1u); i++) {
+        encoders.emplace_back(&FrameReadback::encoderLoop, this);
+    }
+}
+
+void FrameReadback::createSlots(VkFormat format, VkExtent2D extent) {
+    if (!supportsFormat(format)) {
+        throw std::runtime_error{"frame readback needs an 8 bit rgba or bgra target!"};
+    }
+    slots.resize(max(config.slots, 1u));
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = VkDeviceSize{extent.width} * extent.height * 4;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    for (auto &slot : slots) {
+        slot.extent = extent;
+        slot.bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+        if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &slot.buffer) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create readback buffer!"};
+        }
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, slot.buffer, &requirements);
+        // whole atoms on both ends, so invalidated ranges never leave the allocation
+        requirements.alignment = max(requirements.alignment, atomSize);
+        requirements.size = alignUp(requirements.size, atomSize);
+        slot.allocation = allocator.allocate(requirements, memoryProperties, vkMemory::ResourceKind::Buffer);
+        vkBindBufferMemory(device, slot.buffer, slot.allocation.memory, slot.allocation.offset);
+        if (slot.allocation.mapped == nullptr) {
+            throw std::runtime_error{"readback memory is not mapped!"};
+        }
+        slot.coherent = deviceMemory.memoryTypes[slot.allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (vkCreateFence(device, &fenceInfo, hostCallbacks, &slot.fence) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create readback fence!"};
+        }
+    }
+    nextSlot = 0;
+}
+
+void FrameReadback::destroySlots(vector<Slot> &group) {
+    for (auto &slot : group) {
+        vkDestroyFence(device, slot.fence, hostCallbacks);
+        vkDestroyBuffer(device, slot.buffer, hostCallbacks);
+        allocator.free(slot.allocation);
+    }
+    group.clear();
+}
+
+void FrameReadback::releaseRetired() {
+    auto unused = [](const vector<Slot> &group) {
+        return all_of(group.begin(), group.end(), [](const Slot &slot) { return slot.state == SlotState::Free; });
+    };
+    for (auto &group : retiredSlots) {
+        if (unused(group)) {
+            destroySlots(group);
+        }
+    }
+    retiredSlots.erase(remove_if(retiredSlots.begin(), retiredSlots.end(), [](const vector<Slot> &group) { return group.empty(); }),
+                       retiredSlots.end());
+}
+
+void FrameReadback::resize(VkFormat format, VkExtent2D extent) {
+    PROFILE_ZONE("readback resize");
+    rethrow();
+    if (!supportsFormat(format)) {
+        throw std::runtime_error{"frame readback needs an 8 bit rgba or bgra target!"};
+    }
+    current = nullptr;
+    lock_guard<std::mutex> lock{mutex};
+    // encoders still hold pointers into the old slots, they are only destroyed once every one of them is free
+    retiredSlots.push_back(std::move(slots));
+    slots.clear();
+    createSlots(format, extent);
+    releaseRetired();
+}
+
+FrameReadback::~FrameReadback() {
+    // frames of a failed encoder are lost anyway, the others are still written
+    {
+        unique_lock<std::mutex> lock{mutex};
+        slotFreed.wait(lock, [&] { return finished == submitted; });
+        stopping = true;
+    }
+    work.notify_all();
+    for (auto &encoder : encoders) {
+        encoder.join();
+    }
+    destroySlots(slots);
+    for (auto &group : retiredSlots) {
+        destroySlots(group);
+    }
+}
+
+bool FrameReadback::acquire(uint64_t frameNumber) {
+    PROFILE_ZONE("readback acquire");
+    rethrow();
+    current = nullptr;
+    // slots are submitted round robin and come back roughly in that order, the next one is the oldest
+    Slot &slot = slots[nextSlot];
+    {
+        unique_lock<std::mutex> lock{mutex};
+        releaseRetired();
+        if (slot.state != SlotState::Free) {
+            if (config.dropWhenBusy) {
+                counters.framesDropped++;
+                return false;
+            }
+            auto start = readbackClock::now();
+            slotFreed.wait(lock, [&] { return slot.state == SlotState::Free || error; });
+            counters.stallMs += elapsedMs(start);
+        }
+        if (!error) {
+            slot.state = SlotState::Recording;
+        }
+    }
+    rethrow();
+    slot.frameNumber = frameNumber;
+    slot.copied = false;
+    nextSlot = (nextSlot + 1) % static_cast<uint32_t>(slots.size());
+    current = &slot;
+    return true;
+}
+
+void FrameReadback::copy(VkCommandBuffer commandBuffer, VkImage image) {
+    if (current == nullptr) {
+        return;
+    }
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {current->extent.width, current->extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, current->buffer, 1, &region);
+
+    // the fence wait alone does not make device writes visible to the host
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = current->buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    current->copied = true;
+}
+
+void FrameReadback::submit(VkQueue queue) {
+    if (current == nullptr) {
+        return;
+    }
+    Slot &slot = *current;
+    current = nullptr;
+    if (!slot.copied) {
+        lock_guard<std::mutex> lock{mutex};
+        slot.state = SlotState::Free;
+        return;
+    }
+    // signaled once everything submitted to queue before, the frame with the copy included, has finished
+    vkResetFences(device, 1, &slot.fence);
+    if (vkQueueSubmit(queue, 0, nullptr, slot.fence) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to submit the readback fence!"};
+    }
+    {
+        lock_guard<std::mutex> lock{mutex};
+        slot.state = SlotState::Submitted;
+        slot.sequence = submitted++;
+        pending.push_back(&slot);
+    }
+    work.notify_one();
+}
+
+void FrameReadback::flush() {
+    PROFILE_ZONE("readback flush");
+    {
+        unique_lock<std::mutex> lock{mutex};
+        slotFreed.wait(lock, [&] { return finished == submitted || error; });
+    }
+    rethrow();
+    if (file) {
+        file.flush();
+    }
+}
+
+void FrameReadback::rethrow() {
+    lock_guard<std::mutex> lock{mutex};
+    if (error) {
+        exception_ptr thrown = error;
+        error = nullptr;
+        rethrow_exception(thrown);
+    }
+}
+
+string FrameReadback::framePath(uint64_t frameNumber) const {
+    string number = to_string(frameNumber);
+    if (number.size() < numberWidth) {
+        number.insert(0, numberWidth - number.size(), '0');
+    }
+    return pathPrefix + number + pathSuffix;
+}
+
+void FrameReadback::encoderLoop() {
+    vkProfiler::setThreadName("frame encoder");
+    vector<uint8_t> bytes;
+    for (;;) {
+        Slot *next;
+        {
+            unique_lock<std::mutex> lock{mutex};
+            work.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            next = pending.front();
+            pending.pop_front();
+            next->state = SlotState::Encoding;
+        }
+        Slot &slot = *next;
+        {
+            PROFILE_ZONE("readback wait");
+            vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+
+        auto start = readbackClock::now();
+        bool encoded = false;
+        try {
+            PROFILE_ZONE("encode frame");
+            if (!slot.coherent) {
+                VkMappedMemoryRange range{};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = slot.allocation.memory;
+                range.offset = slot.allocation.offset;
+                range.size = alignUp(VkDeviceSize{slot.extent.width} * slot.extent.height * 4, atomSize);
+                vkInvalidateMappedMemoryRanges(device, 1, &range);
+            }
+            bytes.clear();
+            PixelView view{static_cast<const uint8_t *>(slot.allocation.mapped), slot.extent.width, slot.extent.height, slot.extent.width * 4,
+                           slot.bgra};
+            encode(config.format, view, bytes);
+            encoded = true;
+        } catch (...) {
+            lock_guard<std::mutex> lock{mutex};
+            error = current_exception();
+        }
+        double encodeMs = elapsedMs(start);
+        bool written = false;
+        try {
+            writeFrame(slot, encoded ? &bytes : nullptr);
+            written = encoded;
+        } catch (...) {
+            lock_guard<std::mutex> lock{mutex};
+            error = current_exception();
+        }
+
+        {
+            lock_guard<std::mutex> lock{mutex};
+            if (written) {
+                counters.framesWritten++;
+                counters.bytesWritten += bytes.size();
+            }
+            counters.encodeMs += encodeMs;
+            slot.state = SlotState::Free;
+            finished++;
+        }
+        slotFreed.notify_all();
+    }
+}
+
+void FrameReadback::writeFrame(const Slot &slot, const vector<uint8_t> *bytes) {
+    PROFILE_ZONE("write frame");
+    if (perFrameFiles) {
+        if (bytes == nullptr) {
+            return;
+        }
+        string path = framePath(slot.frameNumber);
+        ofstream out{path, ios::binary | ios::trunc};
+        out.write(reinterpret_cast<const char *>(bytes->data()), static_cast<streamsize>(bytes->size()));
+        if (!out) {
+            throw std::runtime_error{"failed to write frame " + path + "!"};
+        }
+        return;
+    }
+
+    unique_lock<std::mutex> lock{writeMutex};
+    writeTurn.wait(lock, [&] { return nextWrite == slot.sequence; });
+    // the next frame gets its turn however this one goes
+    struct PassTurn {
+        FrameReadback &readback;
+        ~PassTurn() {
+            readback.nextWrite++;
+            readback.writeTurn.notify_all();
+        }
+    } passTurn{*this};
+    if (bytes == nullptr) {
+        return;
+    }
+    if (streamFd >= 0) {
+        writeAll(streamFd, bytes->data(), bytes->size());
+    } else {
+        file.write(reinterpret_cast<const char *>(bytes->data()), static_cast<streamsize>(bytes->size()));
+        if (!file) {
+            throw std::runtime_error{"failed to write a frame to " + config.path + "!"};
+        }
+    }
+}
+
+ReadbackStats FrameReadback::stats() const {
+    lock_guard<std::mutex> lock{mutex};
+    return counters;
+}
+
+void FrameReadback::printStats(ostream &out) const {
+    ReadbackStats totals = stats();
+    out << "readback : " << totals.framesWritten << " frames written as " << formatName(config.format) << ", "
+        << totals.bytesWritten / (1024 * 1024) << " MiB, " << totals.framesDropped << " dropped, " << totals.stallMs
+        << " ms stalled, encode avg " << (totals.framesWritten == 0 ? 0.0 : totals.encodeMs / static_cast<double>(totals.framesWritten))
+        << " ms" << endl;
+}
+} // namespace vkOutput
@@ -0,0 +1,153 @@
+#include "headers/frameRing.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkMemory {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+FrameRing::FrameRing(VkDevice device, const DeviceCapabilities &capabilities, Allocator &allocator, const VkAllocationCallbacks *hostCallbacks,
+                     VkDeviceSize frameSize, uint32_t framesInFlight, const vector<uint32_t> &queueFamilies)
+    : device(device), allocator(allocator), hostCallbacks(hostCallbacks), frameCount(max(framesInFlight, 1u)) {
+    const auto &limits = capabilities.properties.limits;
+    minUniformAlignment = max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+    atomSize = max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+    // every region starts aligned for anything the ring hands out and for flushing
+    VkDeviceSize regionAlignment =
+        max({minUniformAlignment, atomSize, VkDeviceSize{limits.minStorageBufferOffsetAlignment}, VkDeviceSize{16}});
+    this->frameSize = alignUp(max<VkDeviceSize>(frameSize, 1), regionAlignment);
+    if (this->frameSize * frameCount > UINT32_MAX) {
+        throw std::runtime_error{"frame ring does not fit the 32 bit dynamic offsets!"};
+    }
+
+    vector<uint32_t> families = queueFamilies;
+    sort(families.begin(), families.end());
+    families.erase(unique(families.begin(), families.end()), families.end());
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = this->frameSize * frameCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    // written by the host only, so several families can read it without ownership transfers
+    if (families.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        bufferInfo.pQueueFamilyIndices = families.data();
+    } else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &ringBuffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create frame ring buffer!"};
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, ringBuffer, &requirements);
+    isCoherent = false;
+    const auto &memoryProperties = capabilities.memoryProperties;
+    VkMemoryPropertyFlags coherentFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & coherentFlags) == coherentFlags) {
+            isCoherent = true;
+            break;
+        }
+    }
+    // whole atoms on both ends, so flushed ranges never leave the allocation
+    if (!isCoherent) {
+        requirements.alignment = max(requirements.alignment, atomSize);
+        requirements.size = alignUp(requirements.size, atomSize);
+    }
+    VkMemoryPropertyFlags properties = isCoherent ? coherentFlags : VkMemoryPropertyFlags{VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT};
+    allocation = allocator.allocate(requirements, properties, ResourceKind::Buffer);
+    vkBindBufferMemory(device, ringBuffer, allocation.memory, allocation.offset);
+    if (allocation.mapped == nullptr) {
+        throw std::runtime_error{"frame ring memory is not mapped!"};
+    }
+}
+
+FrameRing::~FrameRing() {
+    vkDestroyBuffer(device, ringBuffer, hostCallbacks);
+    allocator.free(allocation);
+}
+
+void FrameRing::beginFrame(uint32_t frameIndex) {
+    peakBytes = max(peakBytes, head.load(memory_order_relaxed));
+    currentFrame = frameIndex % frameCount;
+    head.store(0, memory_order_relaxed);
+}
+
+RingSlice FrameRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    RingSlice slice;
+    if (!tryAllocate(size, alignment, slice)) {
+        throw std::runtime_error{"frame ring is out of its " + to_string(frameSize) + " bytes per frame!"};
+    }
+    return slice;
+}
+
+bool FrameRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, RingSlice &slice) {
+    alignment = alignment == 0 ? minUniformAlignment : alignment;
+    VkDeviceSize begin;
+    VkDeviceSize current = head.load(memory_order_relaxed);
+    do {
+        begin = alignUp(current, alignment);
+        if (begin + size > frameSize) {
+            failedAllocations.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+    } while (!head.compare_exchange_weak(current, begin + size, memory_order_relaxed));
+
+    slice.buffer = ringBuffer;
+    slice.offset = VkDeviceSize{currentFrame} * frameSize + begin;
+    slice.size = size;
+    slice.mapped = static_cast<char *>(allocation.mapped) + slice.offset;
+    return true;
+}
+
+VkMappedMemoryRange FrameRing::mappedRange(VkDeviceSize offset, VkDeviceSize size) const {
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize end = begin + size;
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin & ~(atomSize - 1);
+    range.size = alignUp(end, atomSize) - range.offset;
+    return range;
+}
+
+void FrameRing::flush(const RingSlice &slice) const {
+    if (isCoherent || slice.size == 0) {
+        return;
+    }
+    VkMappedMemoryRange range = mappedRange(slice.offset, slice.size);
+    vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void FrameRing::flushFrame() const {
+    VkDeviceSize used = head.load(memory_order_relaxed);
+    if (isCoherent || used == 0) {
+        return;
+    }
+    PROFILE_ZONE("flush frame ring");
+    VkMappedMemoryRange range = mappedRange(VkDeviceSize{currentFrame} * frameSize, used);
+    vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void FrameRing::printStats(ostream &out) const {
+    out << "frame ring : " << frameCount << " x " << frameSize / 1024 << " KiB, " << (isCoherent ? "coherent" : "flushed") << ", peak "
+        << max(peakBytes, head.load(memory_order_relaxed)) / 1024 << " KiB in a frame";
+    uint32_t failed = failedAllocations.load(memory_order_relaxed);
+    if (failed > 0) {
+        out << ", " << failed << " allocations did not fit";
+    }
+    out << endl;
+}
+} // namespace vkMemory
@@ -0,0 +1,594 @@
+#include "headers/gpuAllocator.hpp"
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkMemory {
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+float HeapStats::fragmentation() const {
+    VkDeviceSize freeBytes = blockBytes - usedBytes;
+    if (freeBytes == 0) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+}
+
+class Block {
+public:
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;
+    uint32_t memoryType;
+    ResourceKind kind;
+    Strategy strategy;
+    // only used by pools
+    VkDeviceSize slotSize;
+
+    Block(VkDeviceMemory memory, VkDeviceSize size, void *mapped, uint32_t memoryType, ResourceKind kind, Strategy strategy, VkDeviceSize slotSize)
+        : memory(memory), size(size), mapped(mapped), memoryType(memoryType), kind(kind), strategy(strategy), slotSize(slotSize) {
+    }
+    virtual ~Block() = default;
+
+    virtual optional<VkDeviceSize> allocate(VkDeviceSize allocationSize, VkDeviceSize alignment) = 0;
+    virtual void free(VkDeviceSize offset) = 0;
+    virtual VkDeviceSize usedBytes() const = 0;
+    virtual VkDeviceSize largestFreeRange() const = 0;
+    virtual uint32_t allocationCount() const = 0;
+
+    bool sameKind(const Block &other) const {
+        return memoryType == other.memoryType && kind == other.kind && strategy == other.strategy && slotSize == other.slotSize;
+    }
+};
+
+class BuddyBlock : public Block {
+public:
+    static constexpr VkDeviceSize minNodeSize = 256;
+
+    BuddyBlock(VkDeviceMemory memory, VkDeviceSize size, void *mapped, uint32_t memoryType, ResourceKind kind)
+        : Block(memory, size, mapped, memoryType, kind, Strategy::Buddy, 0) {
+        maxOrder = static_cast<uint32_t>(countr_zero(size / minNodeSize));
+        freeLists.resize(maxOrder + 1);
+        freeLists[maxOrder].insert(0);
+    }
+
+    optional<VkDeviceSize> allocate(VkDeviceSize allocationSize, VkDeviceSize alignment) override {
+        // nodes are aligned to their own size, so a node at least as large as the alignment is aligned
+        VkDeviceSize nodeSize = bit_ceil(max({allocationSize, alignment, minNodeSize}));
+        if (nodeSize > size) {
+            return nullopt;
+        }
+        uint32_t order = static_cast<uint32_t>(countr_zero(nodeSize / minNodeSize));
+
+        uint32_t available = order;
+        while (available <= maxOrder && freeLists[available].empty()) {
+            available++;
+        }
+        if (available > maxOrder) {
+            return nullopt;
+        }
+
+        // lowest address first keeps the block compact
+        VkDeviceSize offset = *freeLists[available].begin();
+        freeLists[available].erase(freeLists[available].begin());
+        while (available > order) {
+            available--;
+            freeLists[available].insert(offset + (minNodeSize << available));
+        }
+
+        allocations[offset] = {order, allocationSize};
+        used += nodeSize;
+        return offset;
+    }
+
+    void free(VkDeviceSize offset) override {
+        auto it = allocations.find(offset);
+        if (it == allocations.end()) {
+            throw std::runtime_error{"freeing an unknown buddy allocation!"};
+        }
+        uint32_t order = it->second.order;
+        allocations.erase(it);
+        used -= minNodeSize << order;
+
+        // merge with the buddy as long as it is free too
+        while (order < maxOrder) {
+            VkDeviceSize buddy = offset ^ (minNodeSize << order);
+            auto buddyIt = freeLists[order].find(buddy);
+            if (buddyIt == freeLists[order].end()) {
+                break;
+            }
+            freeLists[order].erase(buddyIt);
+            offset = min(offset, buddy);
+            order++;
+        }
+        freeLists[order].insert(offset);
+    }
+
+    VkDeviceSize usedBytes() const override {
+        return used;
+    }
+
+    VkDeviceSize largestFreeRange() const override {
+        for (uint32_t order = maxOrder + 1; order-- > 0;) {
+            if (!freeLists[order].empty()) {
+                return minNodeSize << order;
+            }
+        }
+        return 0;
+    }
+
+    uint32_t allocationCount() const override {
+        return static_cast<uint32_t>(allocations.size());
+    }
+
+    // offset -> requested size, used to plan defragmentation moves
+    vector<pair<VkDeviceSize, VkDeviceSize>> liveAllocations() const {
+        vector<pair<VkDeviceSize, VkDeviceSize>> result;
+        for (const auto &[offset, node] : allocations) {
+            result.emplace_back(offset, node.size);
+        }
+        return result;
+    }
+
+    VkDeviceSize alignmentOf(VkDeviceSize offset) const {
+        return minNodeSize << allocations.at(offset).order;
+    }
+
+private:
+    struct Node {
+        uint32_t order;
+        VkDeviceSize size;
+    };
+
+    uint32_t maxOrder;
+    vector<set<VkDeviceSize>> freeLists;
+    map<VkDeviceSize, Node> allocations;
+    VkDeviceSize used = 0;
+};
+
+class LinearBlock : public Block {
+public:
+    LinearBlock(VkDeviceMemory memory, VkDeviceSize size, void *mapped, uint32_t memoryType, ResourceKind kind)
+        : Block(memory, size, mapped, memoryType, kind, Strategy::Linear, 0) {
+    }
+
+    optional<VkDeviceSize> allocate(VkDeviceSize allocationSize, VkDeviceSize alignment) override {
+        optional<VkDeviceSize> offset;
+        if (entries.empty()) {
+            offset = fits(0, size, allocationSize, alignment);
+        } else {
+            VkDeviceSize tail = entries.front().offset;
+            VkDeviceSize head = entries.back().offset + entries.back().size;
+            if (head > tail) {
+                // not wrapped, try the end of the block first and wrap to the start after that
+                offset = fits(head, size, allocationSize, alignment);
+                if (!offset) {
+                    offset = fits(0, tail, allocationSize, alignment);
+                }
+            } else {
+                offset = fits(head, tail, allocationSize, alignment);
+            }
+        }
+
+        if (offset) {
+            entries.push_back({*offset, allocationSize, false});
+            used += allocationSize;
+        }
+        return offset;
+    }
+
+    void free(VkDeviceSize offset) override {
+        // frees usually come in allocation order, so the entry is normally at the front
+        auto it = find_if(entries.begin(), entries.end(), [offset](const Entry &e) { return e.offset == offset && !e.freed; });
+        if (it == entries.end()) {
+            throw std::runtime_error{"freeing an unknown linear allocation!"};
+        }
+        it->freed = true;
+        used -= it->size;
+        while (!entries.empty() && entries.front().freed) {
+            entries.pop_front();
+        }
+    }
+
+    VkDeviceSize usedBytes() const override {
+        return used;
+    }
+
+    VkDeviceSize largestFreeRange() const override {
+        if (entries.empty()) {
+            return size;
+        }
+        VkDeviceSize tail = entries.front().offset;
+        VkDeviceSize head = entries.back().offset + entries.back().size;
+        return head > tail ? max(size - head, tail) : tail - head;
+    }
+
+    uint32_t allocationCount() const override {
+        return static_cast<uint32_t>(count_if(entries.begin(), entries.end(), [](const Entry &e) { return !e.freed; }));
+    }
+
+private:
+    struct Entry {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        bool freed;
+    };
+
+    deque<Entry> entries;
+    VkDeviceSize used = 0;
+
+    static optional<VkDeviceSize> fits(VkDeviceSize begin, VkDeviceSize end, VkDeviceSize allocationSize, VkDeviceSize alignment) {
+        VkDeviceSize offset = alignUp(begin, alignment);
+        if (offset + allocationSize <= end) {
+            return offset;
+        }
+        return nullopt;
+    }
+};
+
+class PoolBlock : public Block {
+public:
+    PoolBlock(VkDeviceMemory memory, VkDeviceSize size, void *mapped, uint32_t memoryType, ResourceKind kind, VkDeviceSize slotSize)
+        : Block(memory, size, mapped, memoryType, kind, Strategy::Pool, slotSize) {
+        uint32_t slotCount = static_cast<uint32_t>(size / slotSize);
+        // hand out low slots first
+        for (uint32_t i = slotCount; i-- > 0;) {
+            freeSlots.push_back(i);
+        }
+        totalSlots = slotCount;
+    }
+
+    optional<VkDeviceSize> allocate(VkDeviceSize allocationSize, VkDeviceSize alignment) override {
+        if (freeSlots.empty() || allocationSize > slotSize || slotSize % alignment != 0) {
+            return nullopt;
+        }
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot * slotSize;
+    }
+
+    void free(VkDeviceSize offset) override {
+        freeSlots.push_back(static_cast<uint32_t>(offset / slotSize));
+    }
+
+    VkDeviceSize usedBytes() const override {
+        return (totalSlots - freeSlots.size()) * slotSize;
+    }
+
+    VkDeviceSize largestFreeRange() const override {
+        return freeSlots.empty() ? 0 : slotSize;
+    }
+
+    uint32_t allocationCount() const override {
+        return totalSlots - static_cast<uint32_t>(freeSlots.size());
+    }
+
+private:
+    vector<uint32_t> freeSlots;
+    uint32_t totalSlots;
+};
+
+Allocator::Allocator(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *hostCallbacks,
+                     VkDeviceSize preferredBlockSize)
+    : device(device), hostCallbacks(hostCallbacks), preferredBlockSize(bit_floor(preferredBlockSize)) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bufferImageGranularity = properties.limits.bufferImageGranularity;
+    maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+Allocator::~Allocator() {
+    for (auto &block : blocks) {
+        if (block->mapped != nullptr) {
+            vkUnmapMemory(device, block->memory);
+        }
+        vkFreeMemory(device, block->memory, hostCallbacks);
+    }
+    for (const auto &dedicated : dedicatedAllocations) {
+        vkFreeMemory(device, dedicated.memory, hostCallbacks);
+    }
+}
+
+uint32_t Allocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error{"failed to find suitable memory type!"};
+}
+
+VkDeviceSize Allocator::blockSizeFor(uint32_t memoryType) const {
+    // small heaps ( e.g. the 256MiB host visible device local window ) get smaller blocks
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return max<VkDeviceSize>(min(preferredBlockSize, bit_floor(heapSize / 8)), BuddyBlock::minNodeSize);
+}
+
+VkDeviceMemory Allocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void **mapped) {
+    if (driverAllocationCount >= maxAllocationCount) {
+        throw std::runtime_error{"maxMemoryAllocationCount reached!"};
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, hostCallbacks, &memory) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to allocate device memory!"};
+    }
+    driverAllocationCount++;
+
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+    }
+    return memory;
+}
+
+Block *Allocator::createBlock(uint32_t memoryType, ResourceKind kind, Strategy strategy, VkDeviceSize slotSize) {
+    VkDeviceSize size = blockSizeFor(memoryType);
+    void *mapped;
+    VkDeviceMemory memory = allocateDeviceMemory(size, memoryType, &mapped);
+
+    switch (strategy) {
+    case Strategy::Buddy:
+        blocks.push_back(make_unique<BuddyBlock>(memory, size, mapped, memoryType, kind));
+        break;
+    case Strategy::Linear:
+        blocks.push_back(make_unique<LinearBlock>(memory, size, mapped, memoryType, kind));
+        break;
+    case Strategy::Pool:
+        blocks.push_back(make_unique<PoolBlock>(memory, size, mapped, memoryType, kind, slotSize));
+        break;
+    }
+    return blocks.back().get();
+}
+
+void Allocator::destroyBlock(Block *block) {
+    if (block->mapped != nullptr) {
+        vkUnmapMemory(device, block->memory);
+    }
+    vkFreeMemory(device, block->memory, hostCallbacks);
+    driverAllocationCount--;
+    blocks.erase(find_if(blocks.begin(), blocks.end(), [block](const unique_ptr<Block> &b) { return b.get() == block; }));
+}
+
+void Allocator::releaseEmptyBlocks() {
+    // one empty block per kind is kept around so alternating alloc / free does not hit the driver
+    vector<const Block *> kept;
+    for (size_t i = blocks.size(); i-- > 0;) {
+        Block *block = blocks[i].get();
+        if (block->allocationCount() != 0) {
+            continue;
+        }
+        if (none_of(kept.begin(), kept.end(), [block](const Block *k) { return k->sameKind(*block); })) {
+            kept.push_back(block);
+            continue;
+        }
+        destroyBlock(block);
+    }
+}
+
+Allocation Allocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                               ResourceKind kind, Strategy strategy) {
+    lock_guard<std::mutex> lock{mutex};
+
+    Allocation allocation;
+    allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    allocation.size = requirements.size;
+
+    // with a granularity of 1 buffers and images can share blocks freely
+    if (bufferImageGranularity <= 1) {
+        kind = ResourceKind::Buffer;
+    }
+
+    VkDeviceSize blockSize = blockSizeFor(allocation.memoryType);
+    VkDeviceSize slotSize = 0;
+    if (strategy == Strategy::Pool) {
+        slotSize = bit_ceil(max(requirements.size, requirements.alignment));
+        // large slots waste too much of a block, those are better off in the buddy allocator
+        if (slotSize > blockSize / 16) {
+            strategy = Strategy::Buddy;
+            slotSize = 0;
+        }
+    }
+
+    // big resources get their own memory
+    if (requirements.size > blockSize / 2) {
+        void *mapped;
+        allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType, &mapped);
+        allocation.mapped = mapped;
+        dedicatedAllocations.push_back({allocation.memory, requirements.size, allocation.memoryType});
+        return allocation;
+    }
+
+    for (auto &block : blocks) {
+        if (block->memoryType != allocation.memoryType || block->kind != kind || block->strategy != strategy || block->slotSize != slotSize) {
+            continue;
+        }
+        if (auto offset = block->allocate(requirements.size, requirements.alignment)) {
+            allocation.block = block.get();
+            allocation.offset = *offset;
+            break;
+        }
+    }
+
+    if (allocation.block == nullptr) {
+        Block *block = createBlock(allocation.memoryType, kind, strategy, slotSize);
+        auto offset = block->allocate(requirements.size, requirements.alignment);
+        if (!offset) {
+            throw std::runtime_error{"allocation does not fit in a fresh memory block!"};
+        }
+        allocation.block = block;
+        allocation.offset = *offset;
+    }
+
+    allocation.memory = allocation.block->memory;
+    if (allocation.block->mapped != nullptr) {
+        allocation.mapped = static_cast<char *>(allocation.block->mapped) + allocation.offset;
+    }
+    return allocation;
+}
+
+Allocation Allocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Strategy strategy) {
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+    Allocation allocation = allocate(requirements, properties, ResourceKind::Buffer, strategy);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+Allocation Allocator::allocateImage(VkImage image, VkMemoryPropertyFlags properties, Strategy strategy) {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    Allocation allocation = allocate(requirements, properties, ResourceKind::Image, strategy);
+    vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+void Allocator::free(const Allocation &allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+    lock_guard<std::mutex> lock{mutex};
+
+    if (allocation.block == nullptr) {
+        auto it = find_if(dedicatedAllocations.begin(), dedicatedAllocations.end(),
+                          [&](const DedicatedAllocation &d) { return d.memory == allocation.memory; });
+        if (it == dedicatedAllocations.end()) {
+            throw std::runtime_error{"freeing an unknown dedicated allocation!"};
+        }
+        if (allocation.mapped != nullptr) {
+            vkUnmapMemory(device, allocation.memory);
+        }
+        vkFreeMemory(device, allocation.memory, hostCallbacks);
+        driverAllocationCount--;
+        dedicatedAllocations.erase(it);
+        return;
+    }
+
+    allocation.block->free(allocation.offset);
+    if (allocation.block->allocationCount() == 0) {
+        releaseEmptyBlocks();
+    }
+}
+
+vector<DefragmentationMove> Allocator::planDefragmentation(uint32_t maxMoves) {
+    lock_guard<std::mutex> lock{mutex};
+    vector<DefragmentationMove> moves;
+
+    // least used blocks are emptied into the most used ones of the same kind
+    vector<BuddyBlock *> buddyBlocks;
+    for (auto &block : blocks) {
+        if (block->strategy == Strategy::Buddy && block->allocationCount() > 0) {
+            buddyBlocks.push_back(static_cast<BuddyBlock *>(block.get()));
+        }
+    }
+    sort(buddyBlocks.begin(), buddyBlocks.end(), [](const BuddyBlock *a, const BuddyBlock *b) { return a->usedBytes() < b->usedBytes(); });
+
+    // a block that received moves is not emptied itself, that would move the same data twice
+    set<const Block *> destinations;
+    for (size_t src = 0; src < buddyBlocks.size() && moves.size() < maxMoves; src++) {
+        BuddyBlock *source = buddyBlocks[src];
+        if (destinations.count(source) != 0) {
+            continue;
+        }
+        for (auto [offset, size] : source->liveAllocations()) {
+            if (moves.size() >= maxMoves) {
+                break;
+            }
+            VkDeviceSize alignment = source->alignmentOf(offset);
+            for (size_t dst = buddyBlocks.size(); dst-- > src + 1;) {
+                BuddyBlock *destination = buddyBlocks[dst];
+                if (!destination->sameKind(*source)) {
+                    continue;
+                }
+                auto newOffset = destination->allocate(size, alignment);
+                if (!newOffset) {
+                    continue;
+                }
+
+                DefragmentationMove move;
+                move.src = {source->memory, offset, size, nullptr, source->memoryType, source};
+                move.dst = {destination->memory, *newOffset, size, nullptr, destination->memoryType, destination};
+                if (source->mapped != nullptr) {
+                    move.src.mapped = static_cast<char *>(source->mapped) + offset;
+                    move.dst.mapped = static_cast<char *>(destination->mapped) + *newOffset;
+                }
+                moves.push_back(move);
+                destinations.insert(destination);
+                break;
+            }
+        }
+    }
+    return moves;
+}
+
+void Allocator::commitDefragmentation(const vector<DefragmentationMove> &moves) {
+    lock_guard<std::mutex> lock{mutex};
+    for (const auto &move : moves) {
+        move.src.block->free(move.src.offset);
+    }
+    releaseEmptyBlocks();
+}
+
+void Allocator::cancelDefragmentation(const vector<DefragmentationMove> &moves) {
+    lock_guard<std::mutex> lock{mutex};
+    for (const auto &move : moves) {
+        move.dst.block->free(move.dst.offset);
+    }
+}
+
+vector<HeapStats> Allocator::getHeapStats() const {
+    lock_guard<std::mutex> lock{mutex};
+    vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        stats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+    }
+
+    for (const auto &block : blocks) {
+        auto &heap = stats[memoryProperties.memoryTypes[block->memoryType].heapIndex];
+        heap.blockBytes += block->size;
+        heap.usedBytes += block->usedBytes();
+        heap.largestFreeRange = max(heap.largestFreeRange, block->largestFreeRange());
+        heap.blockCount++;
+        heap.allocationCount += block->allocationCount();
+    }
+    for (const auto &dedicated : dedicatedAllocations) {
+        auto &heap = stats[memoryProperties.memoryTypes[dedicated.memoryType].heapIndex];
+        heap.blockBytes += dedicated.size;
+        heap.usedBytes += dedicated.size;
+        heap.dedicatedCount++;
+        heap.allocationCount++;
+    }
+    return stats;
+}
+
+void Allocator::printStats(std::ostream &out) const {
+    auto stats = getHeapStats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const auto &heap = stats[i];
+        out << "heap [" << i << "] " << heap.heapSize / (1024 * 1024) << " MiB : "
+            << heap.blockBytes / 1024 << " KiB allocated, " << heap.usedBytes / 1024 << " KiB used, "
+            << heap.blockCount << " blocks, " << heap.dedicatedCount << " dedicated, "
+            << heap.allocationCount << " allocations, fragmentation " << heap.fragmentation() << std::endl;
+    }
+}
+} // namespace vkMemory
@@ -0,0 +1,111 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "deviceCapabilities.hpp"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace vkDescriptors {
+
+constexpr uint32_t invalidSlot = ~0u;
+
+// hands out the indices of a fixed size descriptor array, freed indices are reused first
+class SlotAllocator {
+public:
+    explicit SlotAllocator(uint32_t capacity) : slotCapacity(capacity) {
+    }
+
+    // invalidSlot when every index is taken
+    uint32_t allocate();
+    void free(uint32_t slot);
+
+    uint32_t capacity() const {
+        return slotCapacity;
+    }
+    uint32_t used() const {
+        return nextSlot - static_cast<uint32_t>(freeSlots.size());
+    }
+
+private:
+    std::vector<uint32_t> freeSlots;
+    // slots at and above this were never handed out
+    uint32_t nextSlot = 0;
+    uint32_t slotCapacity;
+};
+
+// what a bindless draw pushes, everything else is fetched through the indices
+struct DrawConstants {
+    // storage buffer slot holding the per draw records ( transforms, texture slots, ... )
+    uint32_t drawDataBuffer;
+    // record of this draw in that buffer
+    uint32_t drawIndex;
+};
+
+// One descriptor set holding every texture and storage buffer of the engine in two large
+// update after bind arrays, bound once per command buffer. Shaders index the arrays with the
+// slots they read from their draw record ( see shaders/include/bindless.glsl ), so a draw only
+// pushes DrawConstants and never binds a set of its own.
+//
+// Slots are written once, right away: update after bind allows writing descriptors no pending
+// frame uses while the set is in use, but never rewriting one that may be read. A released slot
+// only goes back to the free list once every frame recorded so far has finished, so whatever
+// changes its view or buffer takes a new slot and releases the old one.
+class BindlessTable {
+public:
+    // destroys / recycles once every frame recorded so far has finished on the gpu
+    using RetireFunction = std::function<void(std::function<void()>)>;
+
+    static constexpr uint32_t textureBinding = 0;
+    static constexpr uint32_t bufferBinding = 1;
+
+    // the counts are clamped to the update after bind limits of the device, which has to support bindless
+    BindlessTable(VkDevice device, const DeviceCapabilities &capabilities, const VkAllocationCallbacks *hostCallbacks,
+                  RetireFunction retire, uint32_t textureCount = 16384, uint32_t bufferCount = 4096);
+    ~BindlessTable();
+    BindlessTable(const BindlessTable &) = delete;
+    BindlessTable &operator=(const BindlessTable &) = delete;
+
+    // the image has to be in SHADER_READ_ONLY_OPTIMAL, sampler null uses the default linear repeat one.
+    // invalidSlot when the table is full
+    uint32_t addTexture(VkImageView view, VkSampler sampler = VK_NULL_HANDLE);
+    void releaseTexture(uint32_t slot);
+    uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    void releaseBuffer(uint32_t slot);
+
+    // once per command buffer before the first draw / dispatch, pipelines have to use pipelineLayout()
+    void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const;
+    void pushDraw(VkCommandBuffer commandBuffer, const DrawConstants &constants) const;
+
+    VkDescriptorSetLayout setLayout() const {
+        return descriptorSetLayout;
+    }
+    // the set plus DrawConstants as push constants for every stage
+    VkPipelineLayout pipelineLayout() const {
+        return layout;
+    }
+    void printStats(std::ostream &out) const;
+
+private:
+    VkDevice device;
+    const VkAllocationCallbacks *hostCallbacks;
+    RetireFunction retire;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkSampler defaultSampler = VK_NULL_HANDLE;
+
+    // slot allocation and descriptor writes may come from any thread
+    mutable std::mutex mutex;
+    SlotAllocator textureSlots;
+    SlotAllocator bufferSlots;
+
+    void writeTexture(uint32_t slot, VkImageView view, VkSampler sampler);
+    void writeBuffer(uint32_t slot, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+};
+} // namespace vkDescriptors
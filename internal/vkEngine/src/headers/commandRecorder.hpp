@@ -0,0 +1,51 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "jobSystem.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vkCommand {
+
+using RecordTask = std::function<void(VkCommandBuffer)>;
+
+// Records tasks into secondary command buffers on the job system. Every worker has its own
+// command pool per frame in flight, so recording never locks and a whole frame worth of
+// buffers is recycled with one vkResetCommandPool per worker. The buffers continue subpass 0
+// of a render pass, the primary executes them between vkCmdBeginRenderPass with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS and vkCmdEndRenderPass.
+class ParallelRecorder {
+public:
+    ParallelRecorder(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, vkJobs::JobSystem &jobSystem,
+                     const VkAllocationCallbacks *hostCallbacks);
+    ~ParallelRecorder();
+    ParallelRecorder(const ParallelRecorder &) = delete;
+    ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+    // resets the pools of this frame slot, only once its fence has been waited on
+    void beginFrame(uint32_t frameIndex);
+    // the returned buffers are in task order, whichever thread recorded them. framebuffer is the one the
+    // primary begins renderPass with
+    const std::vector<VkCommandBuffer> &record(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer,
+                                               const std::vector<RecordTask> &tasks);
+
+private:
+    struct ThreadPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        // buffers handed out since the last reset
+        size_t used = 0;
+    };
+
+    VkDevice device;
+    const VkAllocationCallbacks *hostCallbacks;
+    vkJobs::JobSystem &jobSystem;
+    // [frame][worker]
+    std::vector<std::vector<ThreadPool>> pools;
+    std::vector<VkCommandBuffer> recorded;
+
+    VkCommandBuffer acquireBuffer(ThreadPool &threadPool);
+};
+} // namespace vkCommand
@@ -0,0 +1,62 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#include <span>
+#include <vector>
+
+namespace vkCulling {
+
+// one draw of the scene, laid out like the Instances buffer of shaders/cull.comp
+struct CullInstance {
+    // world space bounding sphere, xyz center and w radius
+    glm::vec4 sphere;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    // becomes firstInstance, so shaders find the per instance data through gl_InstanceIndex
+    uint32_t instanceIndex;
+};
+static_assert(sizeof(CullInstance) == 32, "CullInstance is read by cull.comp with std430 layout");
+
+// normalized planes pointing inwards, a sphere is outside when dot(plane.xyz, center) + plane.w < -radius
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // clip space of vulkan, depth 0 to 1
+    static Frustum fromViewProjection(const glm::mat4 &viewProjection);
+};
+
+VkDrawIndexedIndirectCommand drawCommand(const CullInstance &instance);
+
+// one sphere after the other, the reference the SIMD path is checked and benchmarked against
+uint32_t cullScalar(const Frustum &frustum, std::span<const CullInstance> instances, VkDrawIndexedIndirectCommand *out);
+
+// Frustum culling on the cpu, four spheres per test. The bounds are kept as structure of arrays
+// in blocks of four, so every plane is tested against a whole block with a few vector multiply
+// adds. Used on devices that can not drive the draws from the gpu.
+class CpuCuller {
+public:
+    void setInstances(std::span<const CullInstance> instances);
+    // writes the commands of the visible instances to out, which holds at least instanceCount() commands, in instance order.
+    // firstInstance has to be a multiple of 4, so ranges can be culled on different threads
+    uint32_t cull(const Frustum &frustum, VkDrawIndexedIndirectCommand *out, size_t firstInstance = 0, size_t count = SIZE_MAX) const;
+
+    size_t instanceCount() const {
+        return instances.size();
+    }
+
+private:
+    struct Block {
+        glm::aligned_vec4 x;
+        glm::aligned_vec4 y;
+        glm::aligned_vec4 z;
+        glm::aligned_vec4 radius;
+    };
+    std::vector<Block> blocks;
+    std::vector<CullInstance> instances;
+};
+} // namespace vkCulling
@@ -0,0 +1,52 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "vkWSIHelpers.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct QueueFamilyIndices {
+    std::optional<uint32_t> graphicsFamily;
+    std::optional<uint32_t> presentFamily;
+    // transfer only family, usually backed by dma engines
+    std::optional<uint32_t> transferFamily;
+    // compute family without graphics, runs next to the graphics queue
+    std::optional<uint32_t> computeFamily;
+    std::vector<uint32_t> queueCounts;
+
+    // without a surface there is nothing to present to
+    bool isComplete(bool needsPresent = true) const {
+        return graphicsFamily.has_value() && (presentFamily.has_value() || !needsPresent);
+    }
+};
+
+// Everything startup asks the driver about a physical device, queried once per device
+// and shared by device selection, device creation and the first swapchain.
+struct DeviceCapabilities {
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties{};
+    VkPhysicalDeviceFeatures features{};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+    QueueFamilyIndices queues;
+    // sorted, looked up with hasExtension
+    std::vector<std::string> extensions;
+    // VK_EXT_external_memory_host, 0 when host memory can not be imported
+    VkDeviceSize minImportedHostPointerAlignment = 0;
+    // VK_EXT_descriptor_indexing, left zeroed when the device does not have it
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexing{};
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties{};
+    // only queried with a surface, the capabilities go stale once the window is resized
+    vkWSIHelper::SwapChainSupportDetails swapChainSupport{};
+
+    bool hasExtension(const char *name) const;
+    bool hasExtensions(const std::vector<const char *> &names) const;
+    // the descriptor indexing features the bindless table is built on
+    bool supportsBindless() const;
+};
+
+// safe to call for different devices from different threads
+DeviceCapabilities queryDeviceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
@@ -0,0 +1,124 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "culling.hpp"
+#include "deviceCapabilities.hpp"
+#include "gpuAllocator.hpp"
+#include "pipelineCache.hpp"
+#include <functional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace vkCulling {
+
+enum class CullPath {
+    // shaders/cull.comp packs the visible draws to the front, drawn with vkCmdDrawIndexedIndirectCount
+    GpuCompacted,
+    // shaders/cull.comp zeroes the instance count of culled draws, drawn with one multi draw indirect
+    GpuInPlace,
+    // CpuCuller on the recording thread, only the visible draws reach the gpu
+    Cpu,
+};
+
+const char *pathName(CullPath path);
+
+// Culls the draws of the whole scene every frame and records them with as few calls as the device
+// allows. The gpu paths need multiDrawIndirect and drawIndirectFirstInstance, compaction needs
+// VK_KHR_draw_indirect_count on top and maxInstances within maxDrawIndirectCount. Everything else
+// culls on the cpu.
+//
+// The gpu paths write drawBuffer() and countBuffer() from a compute dispatch, the caller orders
+// that after the draws of the previous frame and the draws after the dispatch ( the frame graph does ).
+class DrawCuller {
+public:
+    // destroys once every frame recorded so far has finished on the gpu
+    using RetireFunction = std::function<void(std::function<void()>)>;
+
+    // cullShader null ( no shader archive or culling forced onto the cpu ) picks the cpu path. drawIndexedIndirectCount is
+    // vkCmdDrawIndexedIndirectCountKHR when the extension was enabled, the features have to be enabled when supported
+    DrawCuller(VkDevice device, const DeviceCapabilities &capabilities, vkMemory::Allocator &allocator,
+               const VkAllocationCallbacks *hostCallbacks, RetireFunction retire, vkPipeline::PipelineCache *pipelineCache,
+               VkShaderModule cullShader, PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount, uint32_t maxInstances,
+               uint32_t framesInFlight);
+    ~DrawCuller();
+    DrawCuller(const DrawCuller &) = delete;
+    DrawCuller &operator=(const DrawCuller &) = delete;
+
+    // replaces the scene, uploaded by the next cull
+    void setInstances(std::span<const CullInstance> instances);
+    void setViewProjection(const glm::mat4 &viewProjection);
+
+    // outside of a render pass, frameIndex picks the per frame buffers of the cpu path
+    void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    // inside the render pass, with the pipeline and the index buffer of the scene bound
+    void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+    CullPath path() const {
+        return cullPath;
+    }
+    VkBuffer drawBuffer() const {
+        return draws;
+    }
+    VkBuffer countBuffer() const {
+        return count;
+    }
+    uint32_t instanceCount() const {
+        return static_cast<uint32_t>(instances.size());
+    }
+    void printStats(std::ostream &out) const;
+
+private:
+    struct CullConstants {
+        glm::vec4 planes[6];
+        uint32_t instanceCount;
+        uint32_t compact;
+    };
+    // commands of the visible instances of one frame in flight
+    struct CpuFrame {
+        std::vector<VkDrawIndexedIndirectCommand> commands;
+        uint32_t drawCount = 0;
+        // host visible copy for multi draw indirect, null without it
+        VkBuffer buffer = VK_NULL_HANDLE;
+        vkMemory::Allocation allocation;
+    };
+
+    VkDevice device;
+    vkMemory::Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    RetireFunction retire;
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount;
+    CullPath cullPath;
+    bool multiDraw;
+    uint32_t maxInstances;
+    uint32_t maxDrawIndirectCount;
+
+    std::vector<CullInstance> instances;
+    Frustum frustum;
+
+    // gpu paths
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    vkMemory::Allocation instanceAllocation;
+    VkBuffer draws = VK_NULL_HANDLE;
+    vkMemory::Allocation drawAllocation;
+    VkBuffer count = VK_NULL_HANDLE;
+    vkMemory::Allocation countAllocation;
+    // instances written by setInstances, copied into instanceBuffer by the next cull
+    VkBuffer staging = VK_NULL_HANDLE;
+    vkMemory::Allocation stagingAllocation;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    // cpu path
+    CpuCuller cpuCuller;
+    std::vector<CpuFrame> cpuFrames;
+
+    VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, vkMemory::Allocation &allocation);
+    void createPipeline(vkPipeline::PipelineCache *pipelineCache, VkShaderModule cullShader);
+    void cullOnGpu(VkCommandBuffer commandBuffer);
+};
+} // namespace vkCulling
@@ -0,0 +1,156 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "gpuAllocator.hpp"
+#include "meshAsset.hpp"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace vkDraw {
+
+using PipelineId = uint16_t;
+using MaterialId = uint16_t;
+using MeshId = uint16_t;
+
+struct PipelineState {
+    VkPipeline pipeline;
+    // materials are bound through it
+    VkPipelineLayout layout;
+};
+
+struct MaterialState {
+    VkDescriptorSet set;
+    uint32_t setIndex = 0;
+};
+
+// one indexed draw, meshes sharing vertex and index buffers are drawn without rebinding them
+struct MeshState {
+    VkBuffer vertexBuffer;
+    VkDeviceSize vertexBufferOffset = 0;
+    VkBuffer indexBuffer;
+    VkDeviceSize indexBufferOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    uint32_t indexCount;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+};
+
+MeshState meshState(const vkAssets::GpuMesh &mesh);
+
+enum class PassOrder {
+    // grouped by pipeline, material and mesh, opaque geometry
+    ByState,
+    // far to near first, state second, blended geometry
+    BackToFront,
+};
+
+// a key and the index of what it sorts
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// least significant byte first, bytes every key shares are skipped. Stable, scratch is resized to match
+void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch);
+
+// counts of one frame, all passes together
+struct DrawStats {
+    uint32_t submitted = 0;
+    uint32_t drawCalls = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+};
+
+// Draw submission in front of command recording. Every draw becomes a 64 bit key
+//     ByState      pass 4 | pipeline 12 | material 16 | mesh 16 | depth 16
+//     BackToFront  pass 4 | inverted depth 16 | pipeline 12 | material 16 | mesh 16
+// and the keys are radix sorted once per frame. Runs of the same pipeline, material and mesh
+// become one instanced draw, and binds are only recorded where the state changes. So recording
+// costs O(unique states), not O(draws).
+//
+// The instance of every draw ( a transform node, say ) goes into a per frame vertex buffer bound
+// at binding instanceBinding with VK_VERTEX_INPUT_RATE_INSTANCE. Pipelines drawn through the queue
+// read it as a uint attribute.
+class DrawQueue {
+public:
+    static constexpr uint32_t instanceBinding = 1;
+    static constexpr uint32_t maxPasses = 16;
+
+    DrawQueue(VkDevice device, vkMemory::Allocator &allocator, const VkAllocationCallbacks *hostCallbacks, uint32_t maxDraws,
+              uint32_t framesInFlight);
+    ~DrawQueue();
+    DrawQueue(const DrawQueue &) = delete;
+    DrawQueue &operator=(const DrawQueue &) = delete;
+
+    // states live as long as the queue, ids are handed out in order
+    PipelineId addPipeline(const PipelineState &state);
+    MaterialId addMaterial(const MaterialState &state);
+    MeshId addMesh(const MeshState &state);
+    void setPassOrder(uint32_t pass, PassOrder order);
+
+    // depth is the view distance, only its order matters
+    void submit(uint32_t pass, PipelineId pipeline, MaterialId material, MeshId mesh, float depth, uint32_t instance);
+    // sorts and batches what was submitted since the last call, fills the instance buffer of frameIndex
+    void sort(uint32_t frameIndex);
+    // the batches of one pass as of the last sort, inside the render pass of that pass. Safe to call from several threads
+    void record(VkCommandBuffer commandBuffer, uint32_t pass) const;
+
+    const DrawStats &lastFrameStats() const {
+        return frameStats;
+    }
+    void printStats(std::ostream &out) const;
+
+private:
+    struct Draw {
+        PipelineId pipeline;
+        MaterialId material;
+        MeshId mesh;
+        uint32_t instance;
+    };
+    // one run of identical draws, with the binds it needs on top of the previous batch of its pass
+    struct Batch {
+        PipelineId pipeline;
+        MaterialId material;
+        MeshId mesh;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        bool bindPipeline;
+        bool bindMaterial;
+        bool bindVertexBuffer;
+        bool bindIndexBuffer;
+    };
+    struct FrameBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        vkMemory::Allocation allocation;
+    };
+
+    VkDevice device;
+    vkMemory::Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    uint32_t maxDraws;
+
+    std::vector<PipelineState> pipelines;
+    std::vector<MaterialState> materials;
+    std::vector<MeshState> meshes;
+    PassOrder passOrders[maxPasses] = {};
+
+    std::vector<Draw> draws;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    std::vector<Batch> batches;
+    // batches of pass p are [passStarts[p], passStarts[p + 1])
+    uint32_t passStarts[maxPasses + 1] = {};
+    std::vector<FrameBuffer> instanceBuffers;
+    // instance buffer of the frame last sorted
+    VkBuffer currentInstances = VK_NULL_HANDLE;
+    DrawStats frameStats;
+
+    uint64_t makeKey(uint32_t pass, const Draw &draw, float depth) const;
+    // batches of the sorted entries, instances written to out in batch order
+    void buildBatches(uint32_t *out);
+};
+} // namespace vkDraw
@@ -1,50 +1,362 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
+#include "bindlessTable.hpp"
+#include "commandRecorder.hpp"
+#include "deviceCapabilities.hpp"
+#include "drawCuller.hpp"
+#include "drawQueue.hpp"
+#include "engineContext.hpp"
+#include "frameReadback.hpp"
+#include "frameRing.hpp"
+#include "gpuAllocator.hpp"
+#include "hostAllocator.hpp"
+#include "jobSystem.hpp"
+#include "meshAsset.hpp"
+#include "pipelineCache.hpp"
+#include "profiler.hpp"
+#include "renderGraph.hpp"
+#include "shaderArchive.hpp"
+#include "textureStreamer.hpp"
+#include "transformStore.hpp"
+#include "vkWSIHelpers.hpp"
 #include <GLFW/glfw3.h>
 
+#include <chrono>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+struct EngineConfig {
+    // render into offscreen images, no window / surface / swapchain is created
+    bool headless = false;
+    // number of offscreen images to render into when headless
+    uint32_t offscreenImageCount = 2;
+    // number of frames the headless main loop renders before returning
+    uint32_t headlessFrameCount = 1;
+    // frames the windowed main loop renders before returning, 0 runs until the window is closed
+    uint32_t windowedFrameCount = 0;
+    // device index or name substring to use instead of the best scoring device,
+    // the PRAGMA_DEVICE environment variable overrides this. This and the other device wide settings below
+    // ( pipeline cache, shaders, workers, host import ) are ignored when the engine runs on a shared EngineContext
+    std::string preferredDevice;
+    // frames the cpu may record ahead of the gpu
+    uint32_t framesInFlight = 2;
+    vkWSIHelper::PresentPolicy presentPolicy = vkWSIHelper::PresentPolicy::VSync;
+    // pipeline cache file loaded at startup and written back on shutdown, empty to keep it in memory only
+    std::string pipelineCachePath = "pipeline_cache.bin";
+    // packed spir-v produced by the shaders target, next to the executable
+    std::string shaderArchivePath = "shaders.pak";
+    // job system threads including the main thread, 0 picks one per core
+    uint32_t workerThreads = 0;
+    // import file mappings as host memory and copy from them on the gpu when VK_EXT_external_memory_host
+    // is there, otherwise assets go through a staging buffer
+    bool importHostMemory = true;
+    // vram the texture streamer may keep resident, 0 derives it from VK_EXT_memory_budget or the heap size
+    uint32_t textureBudgetMiB = 0;
+    // chrome trace of the cpu and gpu zones written after shutdown, empty to skip
+    std::string tracePath;
+    // cull on the recording thread even when the device can cull with a compute dispatch
+    bool cpuCulling = false;
+    // instances the draw culler, nodes the transform store and draws per frame the draw queue hold, sizes their buffers
+    uint32_t maxDrawInstances = 65536;
+    // per frame dynamic data ( uniforms, instance data, small uploads ) the frame ring holds for each frame in flight
+    uint32_t frameRingKiB = 4096;
+    // every frame time is kept in FrameTiming::history as well, for percentiles after the run
+    bool keepFrameHistory = false;
+    // rendered frames copied back and written out by encoder threads, nothing is read back by default
+    vkOutput::OutputConfig output;
+};
+
+struct FrameTiming {
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    double totalMs = 0.0;
+    uint64_t samples = 0;
+    // one entry per sample when EngineConfig::keepFrameHistory is set
+    bool keepHistory = false;
+    std::vector<float> history;
+
+    void add(double ms);
+    double averageMs(uint64_t frames) const;
+};
+
+// frame pacing statistics, all times are cpu side except gpuFrame
+struct FrameStats {
+    uint64_t frameCount = 0;
+    // from run() until the first frame was submitted and presented
+    double timeToFirstFrameMs = 0.0;
+    // cpu blocked waiting for the frame slot ( or its image ) to be free again
+    FrameTiming fenceWait;
+    // time spent in vkAcquireNextImageKHR
+    FrameTiming acquire;
+    // whole drawFrame call
+    FrameTiming cpuFrame;
+    // timestamp queries around the frame command buffer, resolved frames in flight late
+    FrameTiming gpuFrame;
+};
+
+// one step of initVulkan, in the order they ran
+struct StartupStage {
+    const char *name;
+    double ms;
+};
+
+// the device wide part of config, what a standalone engine creates its EngineContext with
+ContextConfig contextConfigFor(const EngineConfig &config);
+
 class GEngine {
 public:
-    GEngine(uint32_t width, uint32_t height);
+    GEngine(uint32_t width, uint32_t height, EngineConfig config = {});
+    // a session of a shared context, only its targets and frame state are created
+    GEngine(std::shared_ptr<EngineContext> context, uint32_t width, uint32_t height, EngineConfig config = {});
 
+    // start, render until finished, stop
     void run();
+    // run() one step at a time, for a SessionServer driving several engines from one thread
+    void start();
+    // renders one frame, may block on the fence of the frame slot
+    void renderFrame();
+    // the window was closed or the frame count of the config was rendered
+    bool finished() const;
+    // the frame slot renderFrame() would use next is free, it would not block on its fence
+    bool frameReady() const;
+    // waits for the device, prints the stats and destroys everything but the context. The context, and with it
+    // the memory stats, pipeline cache and job system, stays until the engine is destroyed
+    void stop();
+
+    const FrameStats &getFrameStats() const;
+    // for the pipelines and descriptors of frame and record tasks
+    VkDevice getDevice() const;
+    // filled by run() before the first frame
+    const std::vector<StartupStage> &getStartupStages() const;
+
+    // Resources
+    vkMemory::Allocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                      VkBuffer &buffer, vkMemory::Strategy strategy = vkMemory::Strategy::Buddy);
+    void destroyBuffer(VkBuffer buffer, const vkMemory::Allocation &allocation);
+    std::vector<vkMemory::HeapStats> getMemoryStats() const;
+    // shared scheduler for startup work, asset decoding, culling and command recording
+    vkJobs::JobSystem &getJobSystem();
+    // writes the cpu and gpu zones recorded so far, see vkProfiler::exportChromeTrace
+    bool exportTrace(const std::string &path) const;
+    // all pipelines should be created through this so they land in the persistent cache
+    vkPipeline::PipelineCache &getPipelineCache();
+    // name is the shader path relative to the shaders directory, e.g. "fullscreen.vert"
+    VkShaderModule createShaderModule(std::string_view name);
+    void destroyShaderModule(VkShaderModule module);
+    // run on the main thread once per frame number, after the image was acquired and before transforms are updated
+    // and draws sorted. the place to move nodes and submit draws for the frame
+    void addFrameTask(std::function<void(uint64_t frameNumber)> task);
+    // recorded every frame into its own secondary command buffer, spread over the job system.
+    // tasks run after the clear inside getRenderPass() on the target image, in the order they were added.
+    // the viewport and scissor are theirs to set
+    void addRecordTask(vkCommand::RecordTask task);
+    // subpass 0 with the target as its only color attachment, what the pipelines of record tasks are created against.
+    // recreated only when a new swapchain changes the target format
+    VkRenderPass getRenderPass() const;
+    VkExtent2D getTargetExtent() const;
+    // copies data into dst on the transfer queue, the next frame waits for it before dstStage
+    void uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size,
+                      VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+    // records work on the async compute queue, the next frame waits for it before dstStage
+    // and takes ownership of the written buffers
+    void submitAsyncCompute(const std::function<void(VkCommandBuffer)> &record, const std::vector<VkBuffer> &writtenBuffers,
+                            VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+    // maps a .pmesh file and uploads its streams, the next frame waits for the upload
+    vkAssets::GpuMesh loadMesh(const std::string &path);
+    void destroyMesh(const vkAssets::GpuMesh &mesh);
+    // .ptex textures, streamed in by mip level while they are requested
+    vkAssets::TextureStreamer &getTextureStreamer();
+    bool hasBindless() const;
+    // every texture and storage buffer in one descriptor set, throws when the device lacks descriptor indexing
+    vkDescriptors::BindlessTable &getBindlessTable();
+    // culled every frame before the record tasks run, tasks call draw() with getFrameIndex() once their pipeline,
+    // vertex and index buffers are bound
+    vkCulling::DrawCuller &getDrawCuller();
+    // updated before every frame is recorded, world matrix of node n at index n of getInstanceBuffer()
+    vkScene::TransformStore &getTransformStore();
+    // storage buffer of the frame being recorded, for record tasks
+    VkBuffer getInstanceBuffer() const;
+    // frame in flight slot being prepared and recorded, for the per frame data of frame and record tasks
+    uint32_t getFrameIndex() const;
+    // sorted before every frame is recorded, record tasks replay a pass with record()
+    vkDraw::DrawQueue &getDrawQueue();
+    // rewound for every frame, for frame tasks and record tasks. Slices stay valid until the frame slot comes around again
+    vkMemory::FrameRing &getFrameRing();
 
 private:
     uint32_t width, height;
-    GLFWwindow *window;
-    VkInstance instance;
-    VkDebugUtilsMessengerEXT debugMessenger;
-    VkPhysicalDevice physicalDevice;
-    VkDevice device;
-    VkSurfaceKHR surface;
+    EngineConfig config;
+    GLFWwindow *window = nullptr;
+    // held until the engine is destroyed, the last engine of a context takes the device and instance with it
+    std::shared_ptr<EngineContext> context;
+    // the shared parts of the context, copied by adoptContext once it is ready
+    vkJobs::JobSystem *jobSystem;
+    vkMemory::HostAllocator &hostAllocator;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    // of the picked device, the swapchain support is the one of this engine's surface
+    DeviceCapabilities capabilities;
+    VkDevice device = VK_NULL_HANDLE;
+    vkMemory::Allocator *gpuAllocator = nullptr;
+    vkPipeline::PipelineCache *pipelineCache = nullptr;
+    // null without a shader archive
+    vkPipeline::ShaderArchive *shaderArchive = nullptr;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    std::unique_ptr<vkDescriptors::BindlessTable> bindlessTable;
+    std::unique_ptr<vkAssets::TextureStreamer> textureStreamer;
+    std::unique_ptr<vkCulling::DrawCuller> drawCuller;
+    std::unique_ptr<vkScene::TransformStore> transformStore;
+    std::unique_ptr<vkDraw::DrawQueue> drawQueue;
+    std::unique_ptr<vkMemory::FrameRing> frameRing;
+    // set when config.output is enabled
+    std::unique_ptr<vkOutput::FrameReadback> readback;
 
-    // Queues
-    VkQueue graphicQueue;
-    VkQueue presentQueue;
+    // Queues, of the context
+    VkQueue graphicQueue = VK_NULL_HANDLE;
+    VkQueue presentQueue = VK_NULL_HANDLE;
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t presentQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
+    uint32_t computeQueueFamily = 0;
+    std::vector<VkQueue> transferQueues;
+    std::vector<VkQueue> computeQueues;
 
     // SwapChain
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
+    bool framebufferResized = false;
+
+    // Offscreen targets ( headless )
+    std::vector<VkImage> offscreenImages;
+    std::vector<vkMemory::Allocation> offscreenImageMemory;
+
+    // record tasks draw into the target images through this
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    // one per target image view
+    std::vector<VkFramebuffer> framebuffers;
+    // signaled by the frame rendering into each swapchain image and waited on by its present. The presentation
+    // engine holds it until the image is acquired again, so it belongs to the image and not to the frame slot
+    std::vector<VkSemaphore> renderFinished;
+
+    // Frames in flight
+    struct FrameData {
+        VkCommandBuffer commandBuffer;
+        VkSemaphore imageAvailable;
+        VkFence inFlight;
+        // world matrices of the transform store, mapped
+        VkBuffer instanceBuffer;
+        vkMemory::Allocation instanceMemory;
+        uint64_t transformVersion = 0;
+    };
+    VkCommandPool commandPool;
+    std::vector<FrameData> frames;
+    // fence of the frame currently rendering into each target image
+    std::vector<VkFence> imagesInFlight;
+    uint32_t currentFrame = 0;
+    // target image of the frame being recorded
+    uint32_t currentImage = 0;
+    uint64_t frameNumber = 0;
+    std::chrono::steady_clock::time_point runStart;
+    FrameStats frameStats;
+    std::vector<StartupStage> startupStages;
+    std::unique_ptr<vkCommand::ParallelRecorder> recorder;
+    std::unique_ptr<vkProfiler::GpuProfiler> gpuProfiler;
+    std::vector<vkCommand::RecordTask> recordTasks;
+    std::vector<std::function<void(uint64_t)>> frameTasks;
+    // while the frame tasks run, uploads may stage through the frame ring
+    bool preparingFrame = false;
+    // passes of a frame, declared again whenever the target images change
+    std::unique_ptr<vkGraph::RenderGraph> frameGraph;
+    vkGraph::ResourceId targetResource = 0;
+
+    // destroyed once every frame submitted before retirement has finished
+    struct RetiredResource {
+        uint64_t retireFrame;
+        std::function<void()> destroy;
+    };
+    std::deque<RetiredResource> retiredResources;
+
+    // Cross queue work
+    struct BufferHandoff {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+    // transfer / compute submission the next graphics frame has to wait for
+    struct CrossQueueWork {
+        VkSemaphore semaphore;
+        VkPipelineStageFlags waitStage;
+        // acquire half of the queue family ownership transfers, empty when the families match
+        std::vector<VkBufferMemoryBarrier> acquireBarriers;
+        std::function<void()> destroy;
+    };
+    VkCommandPool transferCommandPool;
+    VkCommandPool computeCommandPool;
+    std::vector<CrossQueueWork> pendingCrossQueueWork;
 
     static int kek;
 
+    static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
+
     void initWindow();
     void initVulkan();
     void mainLoop();
+    void printStats() const;
     void cleanup();
 
-    void linkVulkan();
-    void setupDebugMessenger();
-    void pickPhysicalDevice();
-    void createLogicalDevice();
+    // copies the handles of a ready context
+    void adoptContext();
+    void createBindlessTable();
+    void createTextureStreamer();
+    void createDrawCuller();
     void createSurface();
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+    void recreateSwapChain(bool surfaceLost = false);
+    void createOffscreenTargets();
     void createImageViews();
-};
\ No newline at end of file
+    void createRenderPass();
+    void createFramebuffers();
+    // renderFinished of every swapchain image, none when headless
+    void createPresentSemaphores();
+    void createCommandPool();
+    void createQueueCommandPools();
+    void destroyQueueCommandPools();
+    void createFrames();
+    void destroyFrames();
+    void createFrameRing();
+    void createFrameGraph();
+    // sized to the current targets, a recreated target only resizes the slots of the one there is
+    void createReadback();
+    void createInstanceBuffers();
+    void destroyInstanceBuffers();
+    void createDrawQueue();
+    // frame tasks, transforms and draw sorting of the frame about to be recorded
+    void prepareScene(uint32_t frameIndex);
+    void retireAfterFrames(std::function<void()> destroy);
+    // for resources the frame being recorded uses as well
+    void retireAfterRecordedFrame(std::function<void()> destroy);
+    void destroyRetired(bool all = false);
+
+    const std::vector<VkImage> &targetImages() const;
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordCrossQueueAcquires(VkCommandBuffer commandBuffer);
+    // copies a range of a mapped file to dst through an imported host allocation, false when the mapping can not be imported
+    bool copyFromHostMapping(std::shared_ptr<const MappedFile> file, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset,
+                             VkDeviceSize size, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+    void submitCrossQueue(VkQueue queue, uint32_t queueFamily, VkCommandPool pool,
+                          const std::function<void(VkCommandBuffer)> &record, const std::vector<BufferHandoff> &handoffs,
+                          VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, std::function<void()> destroy);
+    void drawFrame();
+};
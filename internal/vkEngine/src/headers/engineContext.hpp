@@ -0,0 +1,108 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include "deviceCapabilities.hpp"
+#include "gpuAllocator.hpp"
+#include "hostAllocator.hpp"
+#include "jobSystem.hpp"
+#include "pipelineCache.hpp"
+#include "shaderArchive.hpp"
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct ContextConfig {
+    // sessions may open windows: glfw is initialized, the instance gets the surface extensions and the
+    // device the swapchain extension. Without it only headless sessions can be created
+    bool presentable = false;
+    // device index or name substring to use instead of the best scoring device,
+    // the PRAGMA_DEVICE environment variable overrides this
+    std::string preferredDevice;
+    // pipeline cache file loaded at startup and written back on shutdown, empty to keep it in memory only
+    std::string pipelineCachePath = "pipeline_cache.bin";
+    // packed spir-v produced by the shaders target, next to the executable
+    std::string shaderArchivePath = "shaders.pak";
+    // job system threads including the main thread, 0 picks one per core
+    uint32_t workerThreads = 0;
+    // import file mappings as host memory when VK_EXT_external_memory_host is there
+    bool importHostMemory = true;
+};
+
+// The part of the engine that does not depend on what is rendered: instance, device, queues, device memory,
+// pipeline cache, shaders and the job system. A GEngine creates its own, several sessions of a SessionServer
+// share one and only pay for their targets and frame state.
+//
+// The queues are not locked, every engine using the context has to be driven from the same thread.
+class EngineContext {
+public:
+    explicit EngineContext(ContextConfig config);
+    // saves the pipeline cache, every engine using the context must have been cleaned up before
+    ~EngineContext();
+    EngineContext(const EngineContext &) = delete;
+    EngineContext &operator=(const EngineContext &) = delete;
+
+    // every step below in order, without a surface to pick the device with
+    void init();
+    // the steps of init(), a standalone engine runs them one by one to create its window in between
+    void linkVulkan();
+    void setupDebugMessenger();
+    // the device has to present to surface when there is one, otherwise to any surface glfw can create
+    void pickPhysicalDevice(VkSurfaceKHR surface = VK_NULL_HANDLE);
+    void createLogicalDevice();
+    void createAllocator();
+    void createPipelineCache();
+    void loadShaderArchive();
+
+    bool ready() const;
+    const ContextConfig &getConfig() const;
+    VkInstance getInstance() const;
+    VkDevice getDevice() const;
+    vkJobs::JobSystem &getJobSystem();
+    vkMemory::HostAllocator &getHostAllocator();
+    vkMemory::Allocator &getAllocator();
+    // how long init() took, 0 when the steps were run one by one
+    double startupMs() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    friend class GEngine;
+
+    ContextConfig config;
+    bool initialized = false;
+    double initMs = 0.0;
+    std::unique_ptr<vkJobs::JobSystem> jobSystem;
+    // passed as pAllocator to every vkCreate / vkDestroy call, outlives the instance
+    vkMemory::HostAllocator hostAllocator;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    // snapshot of the picked device taken while picking it
+    DeviceCapabilities capabilities;
+    VkDevice device = VK_NULL_HANDLE;
+    // sub allocates all device memory of every engine using the context
+    std::unique_ptr<vkMemory::Allocator> gpuAllocator;
+    std::unique_ptr<vkPipeline::PipelineCache> pipelineCache;
+    std::unique_ptr<vkPipeline::ShaderArchive> shaderArchive;
+    bool pipelineCreationFeedback = false;
+    // set when VK_EXT_external_memory_host is enabled
+    PFN_vkGetMemoryHostPointerPropertiesEXT getMemoryHostPointerProperties = nullptr;
+    // VK_EXT_memory_budget, lets the texture budget follow what the os grants the process
+    bool memoryBudget = false;
+    // set when VK_KHR_draw_indirect_count is enabled
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+    // VK_EXT_descriptor_indexing with everything the bindless table needs
+    bool bindless = false;
+
+    // Queues
+    VkQueue graphicQueue = VK_NULL_HANDLE;
+    VkQueue presentQueue = VK_NULL_HANDLE;
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t presentQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
+    uint32_t computeQueueFamily = 0;
+    std::vector<VkQueue> transferQueues;
+    std::vector<VkQueue> computeQueues;
+};
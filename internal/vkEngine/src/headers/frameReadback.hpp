@@ -0,0 +1,161 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "deviceCapabilities.hpp"
+#include "gpuAllocator.hpp"
+#include "imageEncoder.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vkOutput {
+
+struct OutputConfig {
+    // a path with a %d ( or %05d ) gets one file per frame numbered by the frame, "-" streams to stdout,
+    // any other path gets every frame one after the other. Empty with fd -1 reads nothing back
+    std::string path;
+    // streams the frames to an open descriptor ( a pipe into an encoder, say ) instead of path, left open
+    int fd = -1;
+    ImageFormat format = ImageFormat::Ppm;
+    // host buffers frames are copied into, frames read back but not written yet
+    uint32_t slots = 4;
+    uint32_t encoderThreads = 2;
+    // skip frames while every slot is busy instead of waiting for the encoders
+    bool dropWhenBusy = false;
+
+    bool enabled() const {
+        return !path.empty() || fd >= 0;
+    }
+};
+
+struct ReadbackStats {
+    uint64_t framesWritten = 0;
+    uint64_t framesDropped = 0;
+    uint64_t bytesWritten = 0;
+    // render loop blocked on a free slot
+    double stallMs = 0.0;
+    // encoder threads, fence wait excluded
+    double encodeMs = 0.0;
+};
+
+// Copies rendered frames into a ring of host visible buffers and writes them out on encoder threads.
+//
+// The copy is recorded into the frame command buffer, right after it an empty submit signals the fence
+// of the slot, so the frame fences are left to the render loop. Encoder threads take the slots in submit
+// order, wait for their fence, encode and write, streamed output is written in frame order. The render
+// loop only waits when every slot is still in flight, with as many slots as frames in flight plus the
+// encoding ones readback never serializes rendering.
+//
+// acquire / copy / submit are called by the render loop for every frame, errors of the encoder threads
+// are thrown from there. The output is opened once, a new target size only replaces the slots.
+class FrameReadback {
+public:
+    // 8 bit rgba or bgra images of extent, the images need VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    FrameReadback(VkDevice device, const DeviceCapabilities &capabilities, vkMemory::Allocator &allocator,
+                  const VkAllocationCallbacks *hostCallbacks, VkFormat format, VkExtent2D extent, const OutputConfig &config);
+    // writes everything submitted so far
+    ~FrameReadback();
+    FrameReadback(const FrameReadback &) = delete;
+    FrameReadback &operator=(const FrameReadback &) = delete;
+
+    static bool supportsFormat(VkFormat format);
+
+    // images of a recreated target, between frames. Slots still being written out are freed once they are,
+    // the output and the encoder threads stay
+    void resize(VkFormat format, VkExtent2D extent);
+
+    // picks the slot of the frame about to be recorded, false when the frame is dropped
+    bool acquire(uint64_t frameNumber);
+    // image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, does nothing without an acquired slot
+    void copy(VkCommandBuffer commandBuffer, VkImage image);
+    // after the frame was submitted to queue
+    void submit(VkQueue queue);
+    // blocks until every submitted frame was written
+    void flush();
+
+    ReadbackStats stats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    enum class SlotState {
+        Free,
+        // acquired by the frame being recorded
+        Recording,
+        Submitted,
+        Encoding,
+    };
+    struct Slot {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        vkMemory::Allocation allocation;
+        VkFence fence = VK_NULL_HANDLE;
+        // of the target the slot was created for
+        VkExtent2D extent{};
+        bool bgra = false;
+        bool coherent = false;
+        SlotState state = SlotState::Free;
+        uint64_t frameNumber = 0;
+        // submit order, streamed frames are written in it
+        uint64_t sequence = 0;
+        bool copied = false;
+    };
+
+    VkDevice device;
+    vkMemory::Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    VkDeviceSize atomSize;
+    VkPhysicalDeviceMemoryProperties deviceMemory;
+    // of the slot memory, host cached when the device has it
+    VkMemoryPropertyFlags memoryProperties;
+    OutputConfig config;
+    // per frame files when set, the printf style number of path split around it
+    bool perFrameFiles = false;
+    std::string pathPrefix;
+    std::string pathSuffix;
+    uint32_t numberWidth = 0;
+    // the stream of frames when not per frame files
+    std::ofstream file;
+    int streamFd = -1;
+
+    std::vector<Slot> slots;
+    // slots of earlier targets, destroyed once none of them is in flight. Moving a vector keeps its slots in place
+    std::vector<std::vector<Slot>> retiredSlots;
+    // render loop only
+    Slot *current = nullptr;
+    uint32_t nextSlot = 0;
+    uint64_t submitted = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable slotFreed;
+    // submitted slots, oldest first
+    std::deque<Slot *> pending;
+    // streamed frames wait for their turn on it, so encoding overlaps but writes stay in order
+    std::mutex writeMutex;
+    std::condition_variable writeTurn;
+    // sequence of the next streamed frame
+    uint64_t nextWrite = 0;
+    uint64_t finished = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+    ReadbackStats counters;
+    std::vector<std::thread> encoders;
+
+    void createSlots(VkFormat format, VkExtent2D extent);
+    void destroySlots(std::vector<Slot> &group);
+    // destroys the retired slots nothing uses anymore, with the mutex held
+    void releaseRetired();
+    void encoderLoop();
+    // bytes null when encoding failed, the turn of the frame is passed on all the same
+    void writeFrame(const Slot &slot, const std::vector<uint8_t> *bytes);
+    void rethrow();
+    std::string framePath(uint64_t frameNumber) const;
+};
+} // namespace vkOutput
@@ -0,0 +1,101 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "deviceCapabilities.hpp"
+#include "gpuAllocator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+namespace vkMemory {
+
+// a piece of the ring, valid until the frame it was allocated in comes around again
+struct RingSlice {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    // from the start of buffer, the bind / copy offset or the dynamic offset of a descriptor set
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+
+    uint32_t dynamicOffset() const {
+        return static_cast<uint32_t>(offset);
+    }
+};
+
+// Per frame dynamic data ( uniforms, instance data, small uploads ) in one persistently mapped buffer
+// split into a region per frame in flight. Allocating bumps a head within the region of the frame
+// being recorded and beginFrame rewinds it once the fence of that frame slot was waited on, so nothing
+// is allocated, mapped or freed per frame. With a single buffer one descriptor set with a
+// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding serves every frame, the frame is in the dynamic offset.
+//
+// Host coherent memory is used when the device has it, otherwise flushFrame writes back everything
+// allocated in the frame with one vkFlushMappedMemoryRanges before the frame is submitted.
+// allocate is safe to call from several threads, the rest only from the thread driving the frames.
+class FrameRing {
+public:
+    // queueFamilies that read the ring, it is shared concurrently when there is more than one
+    FrameRing(VkDevice device, const DeviceCapabilities &capabilities, Allocator &allocator, const VkAllocationCallbacks *hostCallbacks,
+              VkDeviceSize frameSize, uint32_t framesInFlight, const std::vector<uint32_t> &queueFamilies);
+    ~FrameRing();
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    // the fence of frameIndex has been waited on, what was allocated in it the last time around is free again.
+    // Always rewinds, a frame given up before its submit had nothing read from its slices
+    void beginFrame(uint32_t frameIndex);
+    // alignment 0 is minUniformBufferOffsetAlignment, other alignments have to be powers of two. Throws when the frame is full
+    RingSlice allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+    // false when the frame is full
+    bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, RingSlice &slice);
+    // a copy of value aligned for a uniform buffer
+    template <typename T> RingSlice push(const T &value) {
+        RingSlice slice = allocate(sizeof(T));
+        memcpy(slice.mapped, &value, sizeof(T));
+        return slice;
+    }
+    // makes the writes to slice visible to the device now, for slices read before the frame is submitted
+    void flush(const RingSlice &slice) const;
+    // makes everything allocated in the current frame visible to the device, before it is submitted
+    void flushFrame() const;
+
+    VkBuffer buffer() const {
+        return ringBuffer;
+    }
+    // range bytes from the start of the buffer, for the descriptor set of a dynamic uniform binding
+    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const {
+        return {ringBuffer, 0, range};
+    }
+    VkDeviceSize uniformAlignment() const {
+        return minUniformAlignment;
+    }
+    bool coherent() const {
+        return isCoherent;
+    }
+    void printStats(std::ostream &out) const;
+
+private:
+    VkDevice device;
+    Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    VkDeviceSize frameSize;
+    VkDeviceSize minUniformAlignment;
+    VkDeviceSize atomSize;
+    bool isCoherent;
+
+    VkBuffer ringBuffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    uint32_t frameCount;
+    uint32_t currentFrame = 0;
+    // bytes allocated in the region of currentFrame
+    std::atomic<VkDeviceSize> head{0};
+
+    VkDeviceSize peakBytes = 0;
+    std::atomic<uint32_t> failedAllocations{0};
+
+    // a range of the buffer widened to whole atoms
+    VkMappedMemoryRange mappedRange(VkDeviceSize offset, VkDeviceSize size) const;
+};
+} // namespace vkMemory
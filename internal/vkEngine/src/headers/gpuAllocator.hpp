@@ -0,0 +1,111 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace vkMemory {
+
+enum class Strategy {
+    // power of two sub blocks, any allocation / free order
+    Buddy,
+    // ring over a block, for transient data freed roughly in allocation order ( staging, per frame data )
+    Linear,
+    // fixed size slots, for many equally sized small resources
+    Pool,
+};
+
+// buffers and linear images may not share a bufferImageGranularity page with optimal tiling images
+enum class ResourceKind {
+    Buffer,
+    Image,
+};
+
+class Block;
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // host visible blocks stay mapped, points at offset
+    void *mapped = nullptr;
+    uint32_t memoryType = 0;
+    // null for dedicated allocations
+    Block *block = nullptr;
+};
+
+struct HeapStats {
+    VkDeviceSize heapSize = 0;
+    // memory allocated from the driver
+    VkDeviceSize blockBytes = 0;
+    // memory handed out to resources
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize largestFreeRange = 0;
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+
+    // 0 when all free memory is one range, close to 1 when it is scattered
+    float fragmentation() const;
+};
+
+// the caller copies src to dst, rebinds its resources and then commits the move
+struct DefragmentationMove {
+    Allocation src;
+    Allocation dst;
+};
+
+class Allocator {
+public:
+    Allocator(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *hostCallbacks = nullptr,
+              VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+    ~Allocator();
+    Allocator(const Allocator &) = delete;
+    Allocator &operator=(const Allocator &) = delete;
+
+    Allocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                        ResourceKind kind, Strategy strategy = Strategy::Buddy);
+    // allocate and bind
+    Allocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Strategy strategy = Strategy::Buddy);
+    Allocation allocateImage(VkImage image, VkMemoryPropertyFlags properties, Strategy strategy = Strategy::Buddy);
+    void free(const Allocation &allocation);
+
+    // moves allocations out of the least used buddy blocks so those blocks can be released
+    std::vector<DefragmentationMove> planDefragmentation(uint32_t maxMoves = 64);
+    void commitDefragmentation(const std::vector<DefragmentationMove> &moves);
+    void cancelDefragmentation(const std::vector<DefragmentationMove> &moves);
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    std::vector<HeapStats> getHeapStats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    struct DedicatedAllocation {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint32_t memoryType;
+    };
+
+    VkDevice device;
+    const VkAllocationCallbacks *hostCallbacks;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize bufferImageGranularity;
+    uint32_t maxAllocationCount;
+    VkDeviceSize preferredBlockSize;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::vector<DedicatedAllocation> dedicatedAllocations;
+    uint32_t driverAllocationCount = 0;
+
+    VkDeviceSize blockSizeFor(uint32_t memoryType) const;
+    VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void **mapped);
+    Block *createBlock(uint32_t memoryType, ResourceKind kind, Strategy strategy, VkDeviceSize slotSize);
+    void releaseEmptyBlocks();
+    void destroyBlock(Block *block);
+};
+} // namespace vkMemory
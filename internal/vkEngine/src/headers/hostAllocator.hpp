@@ -0,0 +1,81 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace vkMemory {
+
+struct HostScopeStats {
+    uint64_t allocations = 0;
+    uint64_t reallocations = 0;
+    uint64_t frees = 0;
+    uint64_t totalBytes = 0;
+    uint64_t liveAllocations = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakBytes = 0;
+    // served from the size class pools instead of the system heap
+    uint64_t pooledAllocations = 0;
+    // allocations the driver made itself and only reported to us
+    uint64_t internalAllocations = 0;
+    uint64_t internalBytes = 0;
+};
+
+// VkAllocationCallbacks backed by size class pools, one set of pools per VkSystemAllocationScope.
+// Small allocations are carved out of arena pages and recycled through free lists, larger or
+// over aligned ones fall back to the system heap. Everything is counted per scope.
+class HostAllocator {
+public:
+    static constexpr uint32_t scopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    HostAllocator();
+    ~HostAllocator();
+    HostAllocator(const HostAllocator &) = delete;
+    HostAllocator &operator=(const HostAllocator &) = delete;
+
+    const VkAllocationCallbacks *callbacks() const {
+        return &vkCallbacks;
+    }
+
+    HostScopeStats getScopeStats(VkSystemAllocationScope scope) const;
+    void printStats(std::ostream &out) const;
+
+private:
+    // 16 .. 4096 bytes, the header is included in the class size
+    static constexpr uint32_t sizeClassCount = 9;
+    static constexpr size_t minClassSize = 16;
+    static constexpr size_t arenaPageSize = 64 * 1024;
+
+    struct FreeSlot {
+        FreeSlot *next;
+    };
+
+    struct ScopePool {
+        mutable std::mutex mutex;
+        std::array<FreeSlot *, sizeClassCount> freeLists{};
+        std::vector<void *> pages;
+        // bump pointer into the newest page
+        char *pageCursor = nullptr;
+        char *pageEnd = nullptr;
+        HostScopeStats stats;
+    };
+
+    VkAllocationCallbacks vkCallbacks;
+    std::array<ScopePool, scopeCount> pools;
+
+    void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void *reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void free(void *memory);
+
+    static void *VKAPI_CALL allocationCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void *VKAPI_CALL reallocationCallback(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void VKAPI_CALL freeCallback(void *userData, void *memory);
+    static void VKAPI_CALL internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static void VKAPI_CALL internalFreeCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+};
+} // namespace vkMemory
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkOutput {
+
+enum class ImageFormat {
+    // rgba8 rows without a header, what ffmpeg reads with -f rawvideo -pix_fmt rgba -s WxH
+    Raw,
+    // binary P6, rgb
+    Ppm,
+    // rgb, zlib stored blocks so encoding is a copy and needs no compression library
+    Png,
+};
+
+const char *formatName(ImageFormat format);
+// "raw", "ppm" or "png", false for anything else
+bool parseFormat(const std::string &name, ImageFormat &format);
+
+// 8 bit four channel pixels as copied out of an image
+struct PixelView {
+    const uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    // bytes from one row to the next
+    uint32_t rowPitch;
+    // B8G8R8A8 targets ( most swapchains ), swizzled while encoding
+    bool bgra = false;
+};
+
+// appends the encoded image to out
+void encode(ImageFormat format, const PixelView &view, std::vector<uint8_t> &out);
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+uint32_t adler32(const uint8_t *data, size_t size, uint32_t adler = 1);
+} // namespace vkOutput
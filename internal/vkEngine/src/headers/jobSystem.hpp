@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkJobs {
+
+using Job = std::function<void()>;
+
+// counts the unfinished jobs of a group, jobs can be chained to run once it reaches zero
+class Counter {
+public:
+    Counter() = default;
+    Counter(const Counter &) = delete;
+    Counter &operator=(const Counter &) = delete;
+
+    bool done() const {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    // only changed with the mutex held, so a waiter that saw zero can safely destroy the counter
+    std::atomic<uint32_t> pending{0};
+    std::mutex mutex;
+    std::vector<std::function<void()>> continuations;
+    // first exception thrown by a job of the group, rethrown by wait
+    std::exception_ptr failure;
+};
+
+// Work stealing scheduler. Every worker owns a deque, it pushes and pops at the back and idle
+// workers steal from the front of the others. Waiting on a counter runs other jobs instead of
+// blocking, so jobs may wait on jobs without deadlocking the pool.
+//
+// Besides the workers only the thread that created the system may run and wait on jobs, it owns
+// queue 0. Other threads throw, they would share that queue unsynchronized with the owner's waits.
+class JobSystem {
+public:
+    // threadCount includes the thread that waits on jobs, 0 picks one per core
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    uint32_t workerCount() const {
+        return static_cast<uint32_t>(queues.size());
+    }
+    // 1 .. workerCount - 1 on worker threads, 0 on the thread that created the system
+    static uint32_t workerIndex();
+
+    // a job run without a counter that throws is logged and counted, nobody waits on it to be told
+    void run(Job job, Counter *counter = nullptr);
+    // job is queued once dependency reaches zero, counter is raised right away
+    void runAfter(Counter &dependency, Job job, Counter *counter = nullptr);
+    // runs queued jobs until the counter reaches zero, rethrows the first failure of the group
+    void wait(Counter &counter);
+    // splits [0, count) into chunks of grain and waits for all of them
+    void parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)> &body);
+
+    uint64_t executedJobs() const {
+        return executed.load(std::memory_order_relaxed);
+    }
+    uint64_t stolenJobs() const {
+        return stolen.load(std::memory_order_relaxed);
+    }
+    // jobs run without a counter that threw
+    uint64_t failedJobs() const {
+        return failed.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Task {
+        Job job;
+        Counter *counter;
+    };
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // [0] is the one of owner
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::thread::id owner;
+
+    std::atomic<uint32_t> queued{0};
+    std::atomic<uint32_t> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleep;
+    bool stopping = false;
+
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> stolen{0};
+    std::atomic<uint64_t> failed{0};
+
+    // throws on a thread that is neither a worker nor the owner
+    void checkThread() const;
+    void push(Task task);
+    bool pop(uint32_t self, Task &task);
+    bool tryRunOne(uint32_t self);
+    void execute(Task &task);
+    void finish(Counter *counter);
+    void workerLoop(uint32_t index);
+};
+} // namespace vkJobs
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// read only memory mapping of a whole file, pages are loaded on first touch by the os
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const std::byte *data() const {
+        return static_cast<const std::byte *>(mapping);
+    }
+    size_t size() const {
+        return fileSize;
+    }
+    bool isOpen() const {
+        return mapping != nullptr;
+    }
+
+private:
+    void *mapping = nullptr;
+    size_t fileSize = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    void close();
+};
@@ -0,0 +1,50 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "gpuAllocator.hpp"
+#include "mappedFile.hpp"
+#include "meshFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vkAssets {
+
+// a .pmesh file mapped into memory, the streams are read straight out of the mapping
+class MeshFile {
+public:
+    // validates the header and every stream range, throws on a truncated or foreign file
+    explicit MeshFile(const std::string &path);
+
+    const meshFormat::MeshHeader &header() const {
+        return *meshHeader;
+    }
+    const std::byte *stream(meshFormat::Stream stream) const {
+        return file.data() + meshHeader->streams[stream].offset;
+    }
+    // every stream, in file order, uploaded as one range
+    const std::byte *payload() const {
+        return file.data() + meshHeader->payloadOffset;
+    }
+    const MappedFile &mapping() const {
+        return file;
+    }
+
+private:
+    MappedFile file;
+    const meshFormat::MeshHeader *meshHeader;
+};
+
+// all streams of a mesh in one device local buffer, usable as vertex, index and storage buffer
+struct GpuMesh {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    vkMemory::Allocation allocation;
+    // offsets are inside buffer, not the file
+    meshFormat::StreamRange streams[meshFormat::StreamCount] = {};
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t meshletCount = 0;
+    meshFormat::Bounds bounds{};
+};
+} // namespace vkAssets
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+
+// on disk layout of .pmesh files, shared by the meshConverter tool and the runtime loader
+//
+// MeshHeader | streams, each at a multiple of streamAlignment | padding up to fileAlignment
+//
+// the streams after the header are uploaded as one range, so stream offsets minus payloadOffset
+// are also the offsets inside the gpu buffer
+namespace meshFormat {
+
+constexpr uint32_t magic = 0x48534D50; // "PMSH"
+constexpr uint32_t version = 1;
+// covers minStorageBufferOffsetAlignment and index buffer alignment on every device
+constexpr uint64_t streamAlignment = 256;
+// files are padded to whole pages so the mapping can be imported as host memory without reading past the end
+constexpr uint64_t fileAlignment = 4096;
+
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+
+enum Stream : uint32_t {
+    // Vertex[vertexCount]
+    Vertices,
+    // uint32_t[indexCount], three per triangle
+    Indices,
+    // Meshlet[meshletCount]
+    Meshlets,
+    // uint32_t indices into Vertices, meshlets reference ranges of it
+    MeshletVertices,
+    // uint8_t triples indexing into the vertex range of their meshlet
+    MeshletTriangles,
+    StreamCount,
+};
+
+struct Vertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+struct Bounds {
+    float center[3];
+    float radius;
+    float min[3];
+    float pad0;
+    float max[3];
+    float pad1;
+};
+
+struct Meshlet {
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    // in triangles, into MeshletTriangles
+    uint32_t triangleOffset;
+    uint32_t triangleCount;
+    float center[3];
+    float radius;
+    // average triangle normal, the meshlet faces away from the viewer when
+    // dot(normalize(center - eye), coneAxis) >= coneCutoff. The cutoff is the sine of the
+    // normal spread, above 1 the meshlet is never culled by its cone
+    float coneAxis[3];
+    float coneCutoff;
+};
+
+struct StreamRange {
+    // from the start of the file
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct MeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t meshletCount;
+    uint32_t reserved;
+    // first byte of the first stream
+    uint64_t payloadOffset;
+    uint64_t payloadSize;
+    Bounds bounds;
+    StreamRange streams[StreamCount];
+};
+
+static_assert(sizeof(Vertex) == 32);
+static_assert(sizeof(Bounds) == 48);
+static_assert(sizeof(Meshlet) == 48);
+static_assert(sizeof(MeshHeader) == 168);
+} // namespace meshFormat
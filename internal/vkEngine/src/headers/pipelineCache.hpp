@@ -0,0 +1,70 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace vkPipeline {
+
+struct CacheStats {
+    // counted from VK_EXT_pipeline_creation_feedback, pipelines created without it are unclassified
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t unclassified = 0;
+    double hitMs = 0.0;
+    double missMs = 0.0;
+    double unclassifiedMs = 0.0;
+    size_t loadedBytes = 0;
+    // average miss cost recorded by the run that wrote the file, prices hits in fully warm runs
+    double baselineMissMs = 0.0;
+    // why the file on disk was not used, empty when it was loaded or did not exist
+    std::string rejectReason;
+
+    // hits priced at the average miss of this run, or of the previous run when everything hit
+    double timeSavedMs() const;
+};
+
+// VkPipelineCache persisted between runs. The file is only used when it was written by the same
+// device ( vendor, device id, pipelineCacheUUID ) and driver version, anything else starts cold.
+class PipelineCache {
+public:
+    // an empty path keeps the cache in memory only
+    PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *hostCallbacks,
+                  std::string path, bool creationFeedback);
+    ~PipelineCache();
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    VkPipelineCache handle() const {
+        return cache;
+    }
+
+    VkPipeline createGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo);
+    VkPipeline createComputePipeline(const VkComputePipelineCreateInfo &createInfo);
+
+    // writes to a temporary file and renames it over the old one, a crash never leaves a torn cache
+    void save() const;
+
+    CacheStats getStats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    VkDevice device;
+    const VkAllocationCallbacks *hostCallbacks;
+    std::string path;
+    bool creationFeedback;
+    VkPhysicalDeviceProperties properties;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+
+    mutable std::mutex statsMutex;
+    CacheStats stats;
+
+    std::string readCacheFile(std::string &data);
+    // chains creation feedback into pNext, creates the pipeline and records hit / miss
+    template <typename CreateInfo, typename CreateFunction>
+    VkPipeline createPipeline(CreateInfo createInfo, CreateFunction create);
+};
+} // namespace vkPipeline
@@ -0,0 +1,107 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// cpu zones go to a ring buffer owned by the recording thread, nothing is locked on the hot path.
+// names must outlive the profiler, string literals are the intended use
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) vkProfiler::ScopedZone PROFILE_CONCAT(profileZone, __LINE__){name}
+// gpu zone covering the rest of the scope
+#define PROFILE_GPU_ZONE(profiler, commandBuffer, name) \
+    vkProfiler::ScopedGpuZone PROFILE_CONCAT(profileGpuZone, __LINE__){profiler, commandBuffer, name}
+
+namespace vkProfiler {
+
+uint64_t nowNs();
+// shown as the track name in the trace
+void setThreadName(const std::string &name);
+
+class ScopedZone {
+public:
+    explicit ScopedZone(const char *name) : name(name), start(nowNs()) {
+    }
+    ~ScopedZone();
+    ScopedZone(const ScopedZone &) = delete;
+    ScopedZone &operator=(const ScopedZone &) = delete;
+
+private:
+    const char *name;
+    uint64_t start;
+};
+
+// writes every zone still held in the rings, and the resolved gpu zones, as chrome trace json.
+// open it in chrome://tracing or ui.perfetto.dev. Zones recorded while exporting may come out torn.
+bool exportChromeTrace(const std::string &path);
+
+// Timestamp queries around command buffer regions. Every frame in flight has its own query pool,
+// results are read when the slot comes around again, so nothing ever waits on the gpu.
+class GpuProfiler {
+public:
+    GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+                const VkAllocationCallbacks *hostCallbacks, uint32_t maxZones = 64);
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    bool enabled() const {
+        return supported;
+    }
+    // resolves what this slot recorded last time and resets its queries, call after the frame fence
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    // returns a zone id for endZone, zones past maxZones are dropped
+    uint32_t beginZone(VkCommandBuffer commandBuffer, const char *name);
+    void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+    // gpu time of the outermost zone of the last resolved frame
+    double lastFrameMs() const {
+        return lastResolvedMs;
+    }
+
+private:
+    struct Zone {
+        const char *name;
+        uint32_t depth;
+    };
+    struct FrameQueries {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<Zone> zones;
+        // gpu timestamps are placed on the cpu timeline relative to when the frame was recorded
+        uint64_t cpuStartNs = 0;
+    };
+
+    VkDevice device;
+    const VkAllocationCallbacks *hostCallbacks;
+    bool supported = false;
+    double nsPerTick = 1.0;
+    uint64_t timestampMask = ~0ull;
+    uint32_t maxZones;
+    std::vector<FrameQueries> frames;
+    uint32_t currentFrame = 0;
+    uint32_t openZones = 0;
+    double lastResolvedMs = 0.0;
+
+    void resolve(FrameQueries &frame);
+};
+
+class ScopedGpuZone {
+public:
+    ScopedGpuZone(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name)
+        : profiler(profiler), commandBuffer(commandBuffer), zone(profiler.beginZone(commandBuffer, name)) {
+    }
+    ~ScopedGpuZone() {
+        profiler.endZone(commandBuffer, zone);
+    }
+    ScopedGpuZone(const ScopedGpuZone &) = delete;
+    ScopedGpuZone &operator=(const ScopedGpuZone &) = delete;
+
+private:
+    GpuProfiler &profiler;
+    VkCommandBuffer commandBuffer;
+    uint32_t zone;
+};
+} // namespace vkProfiler
@@ -0,0 +1,204 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "gpuAllocator.hpp"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace vkGraph {
+
+using ResourceId = uint32_t;
+
+// how a pass uses a resource, each maps to the stages, access mask, layout and usage flags it needs
+enum class Access {
+    ColorAttachmentWrite,
+    DepthAttachmentWrite,
+    DepthAttachmentRead,
+    FragmentSampled,
+    ComputeSampled,
+    ComputeStorageRead,
+    ComputeStorageWrite,
+    TransferRead,
+    TransferWrite,
+    VertexBufferRead,
+    IndexBufferRead,
+    IndirectRead,
+};
+
+struct ImageInfo {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent{};
+    uint32_t mipLevels = 1;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+// what an imported resource is in when the frame starts, and has to be left in when it ends
+struct ResourceState {
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags access = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+struct GraphStats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    // vkCmdPipelineBarrier calls per execute and the barriers in them
+    uint32_t barrierBatches = 0;
+    uint32_t imageBarriers = 0;
+    uint32_t bufferBarriers = 0;
+    // transient memory without and with aliasing
+    VkDeviceSize transientBytes = 0;
+    VkDeviceSize aliasedBytes = 0;
+};
+
+// Frame graph: passes declare the resources they read and write, compile derives the barriers and
+// layout transitions between them and execute records the passes with those barriers batched into
+// one vkCmdPipelineBarrier per pass.
+//
+// Passes run in declaration order. Passes whose writes nobody reads are culled, only imported
+// resources and passes marked keepAlive count as outputs. Transient resources are created by
+// compile and live for the whole graph, those whose pass ranges do not overlap share memory.
+// The graph is compiled once and executed every frame, imported handles are set before execute.
+// Consecutive frames on the same queue are ordered by the barriers of the first uses, which wait
+// for the last uses of the previous frame.
+class RenderGraph {
+public:
+    using RetireFunction = std::function<void(std::function<void()>)>;
+    using PassFunction = std::function<void(VkCommandBuffer)>;
+
+    class PassBuilder {
+    public:
+        void read(ResourceId resource, Access access);
+        void write(ResourceId resource, Access access);
+        // for passes with side effects outside the graph
+        void keepAlive();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, uint32_t pass) : graph(graph), pass(pass) {
+        }
+        RenderGraph &graph;
+        uint32_t pass;
+    };
+
+    // retire destroys the transient resources of a previous compile once the frames using them finished
+    RenderGraph(VkDevice device, vkMemory::Allocator &allocator, const VkAllocationCallbacks *hostCallbacks, RetireFunction retire);
+    ~RenderGraph();
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    ResourceId createImage(const std::string &name, const ImageInfo &info);
+    ResourceId createBuffer(const std::string &name, VkDeviceSize size);
+    ResourceId importImage(const std::string &name, const ImageInfo &info, const ResourceState &initial, const ResourceState &final);
+    // the layout of the states is ignored
+    ResourceId importBuffer(const std::string &name, const ResourceState &initial, const ResourceState &final);
+    // setup declares the accesses right away, execute runs in every execute() unless the pass is culled
+    void addPass(const std::string &name, const std::function<void(PassBuilder &)> &setup, PassFunction execute);
+
+    // culls passes, creates and aliases the transient resources and plans the barriers
+    void compile();
+    // drops every declaration, a new graph can be declared and compiled afterwards
+    void clear();
+
+    void setImage(ResourceId resource, VkImage image, VkImageView view = VK_NULL_HANDLE);
+    void setBuffer(ResourceId resource, VkBuffer buffer);
+    void execute(VkCommandBuffer commandBuffer) const;
+
+    VkImage image(ResourceId resource) const;
+    // transient images get a view of every level, imported ones the view passed to setImage
+    VkImageView view(ResourceId resource) const;
+    VkBuffer buffer(ResourceId resource) const;
+    const GraphStats &stats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    struct Resource {
+        std::string name;
+        bool isImage;
+        bool imported;
+        ImageInfo imageInfo;
+        VkDeviceSize bufferSize = 0;
+        ResourceState initial;
+        ResourceState final;
+        // union over every access, for creating transient resources
+        VkImageUsageFlags imageUsage = 0;
+        VkBufferUsageFlags bufferUsage = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements{};
+        uint32_t memoryType = 0;
+        // first and last alive pass using it, transient resources only
+        uint32_t firstPass = ~0u;
+        uint32_t lastPass = 0;
+        // memory slot shared with other transient resources, ~0u for imported ones
+        uint32_t slot = ~0u;
+        // every stage and write access of the frame, what the next occupant of the slot waits for
+        VkPipelineStageFlags usedStages = 0;
+        VkAccessFlags writtenAccess = 0;
+    };
+    struct PassAccess {
+        ResourceId resource;
+        Access access;
+    };
+    struct Pass {
+        std::string name;
+        std::vector<PassAccess> accesses;
+        PassFunction execute;
+        bool keepAlive = false;
+        bool alive = false;
+    };
+    // memory shared by transient resources with disjoint pass ranges
+    struct Slot {
+        vkMemory::ResourceKind kind;
+        uint32_t memoryType;
+        VkMemoryRequirements requirements;
+        vkMemory::Allocation allocation;
+        // by first pass
+        std::vector<ResourceId> occupants;
+    };
+    // barriers recorded before a pass, the handles are filled in by execute
+    struct Batch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<std::pair<ResourceId, VkImageMemoryBarrier>> images;
+        std::vector<std::pair<ResourceId, VkBufferMemoryBarrier>> buffers;
+    };
+    // state of a resource while walking the passes
+    struct Tracked {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        // stages that read since the last write, the next write waits for them
+        VkPipelineStageFlags readStages = 0;
+        // stages the last write has been made visible to
+        VkPipelineStageFlags visibleStages = 0;
+    };
+
+    VkDevice device;
+    vkMemory::Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    RetireFunction retire;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Slot> slots;
+    // batches[i] runs before the i-th alive pass, the last one after all of them
+    std::vector<Batch> batches;
+    std::vector<uint32_t> alivePasses;
+    GraphStats graphStats;
+    bool compiled = false;
+
+    void cull();
+    void createTransients();
+    void planBarriers();
+    // adds the barrier taking the resource from its tracked state to the access to the batch, if one is needed
+    void transition(Batch &batch, ResourceId resource, Tracked &state, VkPipelineStageFlags stages, VkAccessFlags access,
+                    VkImageLayout layout, bool write) const;
+    void destroyTransients();
+};
+} // namespace vkGraph
@@ -0,0 +1,65 @@
+#pragma once
+#include "engine.hpp"
+#include "engineContext.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+struct SessionStats {
+    uint32_t id = 0;
+    uint32_t weight = 1;
+    uint64_t frames = 0;
+    // GEngine::start of the session, the context was up already
+    double startMs = 0.0;
+    // what the session was charged for its frames, before the weight
+    double chargedMs = 0.0;
+};
+
+// Renders many GEngine sessions on one EngineContext, from the thread calling run().
+//
+// One session renders one frame at a time. A frame is charged what it cost, the cpu time of renderFrame without
+// the fence wait or the gpu time of the frame, whichever is larger, divided by the weight of the session, and
+// the session charged the least so far renders next. Sessions whose frame slot is still busy are passed over while
+// another one can render without waiting, so one slow gpu frame does not hold the others back.
+class SessionServer {
+public:
+    // the context is brought up right away, without a surface to pick the device with
+    explicit SessionServer(ContextConfig config);
+    // stops the sessions still running
+    ~SessionServer();
+    SessionServer(const SessionServer &) = delete;
+    SessionServer &operator=(const SessionServer &) = delete;
+
+    // started by run(), or before the next frame when run() is going already ( from a frame task, say ).
+    // frame and record tasks can be added to the engine until then
+    GEngine &addSession(uint32_t width, uint32_t height, EngineConfig config = {}, uint32_t weight = 1);
+    // renders until every session finished, each one is stopped and destroyed as soon as it is
+    void run();
+
+    EngineContext &getContext();
+    // of the sessions that finished, in the order they did
+    const std::vector<SessionStats> &getStats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    struct Session {
+        std::unique_ptr<GEngine> engine;
+        bool started = false;
+        // charged time over weight, the session with the least goes next
+        double virtualMs = 0.0;
+        SessionStats stats;
+    };
+
+    std::shared_ptr<EngineContext> context;
+    std::vector<Session> sessions;
+    std::vector<SessionStats> finishedStats;
+    uint32_t nextId = 0;
+
+    void startPending();
+    // index of the session to render next
+    size_t pick() const;
+    void renderOne(size_t index);
+    void retire(size_t index);
+};
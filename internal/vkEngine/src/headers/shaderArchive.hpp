@@ -0,0 +1,32 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "mappedFile.hpp"
+#include "shaderArchiveFormat.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace vkPipeline {
+
+// shaders.pak mapped into memory, modules are created straight from the mapping without copying
+class ShaderArchive {
+public:
+    explicit ShaderArchive(const std::string &path);
+
+    uint32_t shaderCount() const {
+        return header->entryCount;
+    }
+    bool contains(std::string_view name) const;
+    // throws when the archive has no shader with that name
+    VkShaderModule createShaderModule(VkDevice device, std::string_view name, const VkAllocationCallbacks *hostCallbacks) const;
+
+private:
+    MappedFile file;
+    const shaderArchive::ArchiveHeader *header;
+    const shaderArchive::ArchiveEntry *entries;
+
+    const shaderArchive::ArchiveEntry *find(std::string_view name) const;
+};
+} // namespace vkPipeline
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+// on disk layout of shaders.pak, shared by the shaderPacker tool and the runtime loader
+//
+// ArchiveHeader | ArchiveEntry[entryCount] | spir-v blobs, each aligned to blobAlignment
+namespace shaderArchive {
+
+constexpr uint32_t magic = 0x41485350; // "PSHA"
+constexpr uint32_t version = 1;
+// spir-v is read as uint32_t words straight out of the mapping
+constexpr uint64_t blobAlignment = 16;
+constexpr uint32_t maxNameLength = 56;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct ArchiveEntry {
+    // null terminated path relative to the shaders directory, e.g. "fullscreen.vert"
+    char name[maxNameLength];
+    // from the start of the file
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(ArchiveHeader) == 16);
+static_assert(sizeof(ArchiveEntry) == 72);
+} // namespace shaderArchive
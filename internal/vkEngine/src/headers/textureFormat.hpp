@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+// on disk layout of .ptex files, shared by the textureConverter tool and the texture streamer
+//
+// TextureHeader | mip levels, smallest first, each at a multiple of mipAlignment | padding up to fileAlignment
+//
+// the small mips that stay resident all the time are at the front of the file, next to each other
+namespace textureFormat {
+
+constexpr uint32_t magic = 0x58455450; // "PTEX"
+constexpr uint32_t version = 1;
+// vkCmdCopyBufferToImage wants offsets that are a multiple of 4 and of the texel block size
+constexpr uint64_t mipAlignment = 16;
+constexpr uint64_t fileAlignment = 4096;
+constexpr uint32_t maxMipCount = 16;
+
+// the format field holds a VkFormat, the converter writes this one
+constexpr uint32_t formatRgba8Srgb = 43; // VK_FORMAT_R8G8B8A8_SRGB
+
+struct MipLevel {
+    // from the start of the file, tightly packed rows
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct TextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t reserved[2];
+    // indexed by mip level, level 0 is the full resolution
+    MipLevel mips[maxMipCount];
+};
+
+static_assert(sizeof(MipLevel) == 24);
+static_assert(sizeof(TextureHeader) == 32 + maxMipCount * sizeof(MipLevel));
+} // namespace textureFormat
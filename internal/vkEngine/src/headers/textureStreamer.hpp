@@ -0,0 +1,193 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "bindlessTable.hpp"
+#include "gpuAllocator.hpp"
+#include "mappedFile.hpp"
+#include "textureFormat.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vkAssets {
+
+// a .ptex file mapped into memory, mips are copied to staging straight out of the mapping
+class TextureFile {
+public:
+    // validates the header and every mip range, throws on a truncated or foreign file
+    explicit TextureFile(const std::string &path);
+
+    const textureFormat::TextureHeader &header() const {
+        return *textureHeader;
+    }
+    const std::byte *mip(uint32_t level) const {
+        return file.data() + textureHeader->mips[level].offset;
+    }
+
+private:
+    MappedFile file;
+    const textureFormat::TextureHeader *textureHeader;
+};
+
+using TextureHandle = uint32_t;
+constexpr TextureHandle invalidTexture = ~0u;
+
+struct StreamerStats {
+    uint32_t textureCount = 0;
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+    // mip levels resident over mip levels of every loaded texture
+    uint64_t residentMips = 0;
+    uint64_t totalMips = 0;
+    // written to staging memory by the loader thread
+    uint64_t uploadedBytes = 0;
+    double uploadSeconds = 0.0;
+    // mip levels dropped to stay inside the budget
+    uint64_t evictedMips = 0;
+    // upgrades skipped because nothing could be evicted for them
+    uint64_t deniedUpgrades = 0;
+    // loads the loader thread could not stage, and textures that stopped streaming after too many of them
+    uint64_t failedLoads = 0;
+    uint32_t failedTextures = 0;
+
+    double uploadMiBPerSecond() const;
+};
+
+// Streams mip levels of .ptex textures under a vram budget. The small tail mips of every
+// texture stay resident, finer levels are loaded one at a time while a texture is requested
+// and the least recently requested textures give their finest level back when over budget.
+//
+// Files are read into staging memory on a loader thread. Changing the resident range recreates
+// the image with the new level count and copies the levels both images share on the gpu, so a
+// texture never has memory for levels it does not hold. These copies are recorded into the
+// command buffer passed to update, on the graphics queue, so images never change queue family.
+class TextureStreamer {
+public:
+    // destroys a resource once every frame recorded so far has finished on the gpu
+    using RetireFunction = std::function<void(std::function<void()>)>;
+
+    // memoryBudget enables VK_EXT_memory_budget queries, fixedBudget overrides the budget when not 0.
+    // with a bindless table every resident texture has a slot in it
+    TextureStreamer(VkPhysicalDevice physicalDevice, VkDevice device, vkMemory::Allocator &allocator,
+                    const VkAllocationCallbacks *hostCallbacks, RetireFunction retire, bool memoryBudget, VkDeviceSize fixedBudget = 0,
+                    vkDescriptors::BindlessTable *bindless = nullptr);
+    // the device has to be idle
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // maps the file and queues its resident tail, view() stays null until that arrived
+    TextureHandle load(const std::string &path);
+    void unload(TextureHandle texture);
+    // the finest mip wanted this frame, textures not requested for a frame stop streaming in
+    void request(TextureHandle texture, uint32_t mip);
+    // once per frame after its fence, records finished loads and evictions into commandBuffer
+    // and queues the next loads. A failed load is logged and retried a few frames later, backing off,
+    // after maxLoadAttempts failures in a row the texture keeps what it has and stops streaming
+    void update(VkCommandBuffer commandBuffer, uint64_t frameNumber);
+
+    // in SHADER_READ_ONLY_OPTIMAL, the view changes whenever the resident range does
+    VkImageView view(TextureHandle texture) const;
+    // changes with the view, vkDescriptors::invalidSlot until the tail is resident or without a bindless table
+    uint32_t bindlessSlot(TextureHandle texture) const;
+    // finest resident level, the mip count while nothing is resident
+    uint32_t residentMip(TextureHandle texture) const;
+    StreamerStats stats() const;
+    void printStats(std::ostream &out) const;
+
+private:
+    struct Texture {
+        std::shared_ptr<const TextureFile> file;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        vkMemory::Allocation allocation;
+        uint32_t bindlessSlot = vkDescriptors::invalidSlot;
+        uint32_t residentMip = 0;
+        // first level of the always resident tail
+        uint32_t tailMip = 0;
+        uint32_t wantedMip = 0;
+        uint64_t lastUsedFrame = 0;
+        uint64_t evictedFrame = ~0ull;
+        // loads of an unloaded texture are dropped when they arrive
+        uint32_t generation = 0;
+        bool live = false;
+        bool loading = false;
+        // failures in a row, no load is queued before retryFrame
+        uint32_t failedLoads = 0;
+        uint64_t retryFrame = 0;
+        bool failed = false;
+    };
+    // levels [firstMip, endMip) of a texture
+    struct LoadRequest {
+        TextureHandle texture;
+        uint32_t generation;
+        std::shared_ptr<const TextureFile> file;
+        uint32_t firstMip;
+        uint32_t endMip;
+        VkDeviceSize bytes;
+    };
+    struct StagedLoad {
+        LoadRequest request;
+        VkBuffer staging = VK_NULL_HANDLE;
+        vkMemory::Allocation allocation;
+        // mip levels of the file, rebased onto the image when recorded
+        std::vector<VkBufferImageCopy> regions;
+        // reported by update on the main thread
+        std::exception_ptr error;
+    };
+
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    vkMemory::Allocator &allocator;
+    const VkAllocationCallbacks *hostCallbacks;
+    RetireFunction retire;
+    bool memoryBudget;
+    VkDeviceSize fixedBudget;
+    vkDescriptors::BindlessTable *bindless;
+
+    // main thread only
+    std::deque<Texture> textures;
+    std::vector<TextureHandle> freeHandles;
+    VkDeviceSize residentBytes = 0;
+    // requested from the loader and not applied yet
+    VkDeviceSize pendingBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+    uint64_t budgetFrame = 0;
+    uint64_t currentFrame = 0;
+    uint64_t evictedMips = 0;
+    uint64_t deniedUpgrades = 0;
+    uint64_t failedLoads = 0;
+
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<LoadRequest> requests;
+    std::vector<StagedLoad> staged;
+    bool stopping = false;
+    std::atomic<uint64_t> uploadedBytes{0};
+    std::atomic<uint64_t> uploadNanoseconds{0};
+
+    void loaderLoop();
+    StagedLoad stage(const LoadRequest &request);
+    void queueLoad(TextureHandle handle, uint32_t firstMip, uint32_t endMip);
+    void releaseStaging(StagedLoad &load);
+    // clears loading and schedules the retry, or gives the texture up
+    void loadFailed(TextureHandle handle, const StagedLoad &load);
+    // recreates the image holding levels [firstMip, mipCount), upload fills the levels the old image lacks
+    void resize(VkCommandBuffer commandBuffer, Texture &texture, uint32_t firstMip, const StagedLoad *upload);
+    void retireImage(Texture &texture);
+    // drops the finest level of the least recently used texture not used last frame
+    bool evictOne(VkCommandBuffer commandBuffer, uint64_t frameNumber);
+    void refreshBudget();
+};
+} // namespace vkAssets
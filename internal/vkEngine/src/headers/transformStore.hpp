@@ -0,0 +1,103 @@
+#pragma once
+#include "jobSystem.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#include <ostream>
+#include <vector>
+
+namespace vkScene {
+
+// stable for the lifetime of the node, doubles as its slot in the instance buffer
+using NodeId = uint32_t;
+constexpr NodeId noParent = UINT32_MAX;
+
+struct Transform {
+    glm::vec3 position{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+// Transform hierarchy stored as structure of arrays, sorted by depth so every parent comes before
+// its children and a whole level can be updated at once. Local transforms live in blocks of four
+// nodes and are turned into matrices four at a time with vector math, world matrices are only
+// recomputed for nodes whose local transform or any ancestor changed since the last update.
+//
+// create / destroy only append or mark nodes, the store is compacted and re sorted by the next
+// update. Not thread safe, update spreads its own work over the job system.
+class TransformStore {
+public:
+    // capacity bounds the node ids, instance buffers written by writeChanged hold capacity matrices
+    explicit TransformStore(uint32_t capacity);
+
+    NodeId create(NodeId parent = noParent, const Transform &local = {});
+    // destroys the node and its whole subtree, linear in the node count
+    void destroy(NodeId node);
+    bool alive(NodeId node) const;
+
+    void setLocal(NodeId node, const Transform &local);
+    Transform getLocal(NodeId node) const;
+    // as of the last update
+    glm::mat4 getWorld(NodeId node) const;
+
+    // recomputes the dirty world matrices, level by level on the job system when one is given.
+    // returns the number of recomputed matrices
+    uint32_t update(vkJobs::JobSystem *jobs = nullptr);
+    // copies the world matrices that changed since writtenVersion to out[node], out holds capacity() matrices.
+    // every target keeps its own version, so each buffer of the frames in flight catches up on what it missed
+    uint32_t writeChanged(glm::mat4 *out, uint64_t &writtenVersion) const;
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(nodeIds.size()) - deadCount;
+    }
+    uint32_t capacity() const {
+        return maxNodes;
+    }
+    void printStats(std::ostream &out) const;
+
+private:
+    // local transforms of four consecutive nodes, one lane each
+    struct Block {
+        glm::aligned_vec4 positionX, positionY, positionZ;
+        glm::aligned_vec4 rotationX, rotationY, rotationZ, rotationW;
+        glm::aligned_vec4 scaleX, scaleY, scaleZ;
+    };
+    static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+    uint32_t maxNodes;
+    // node id to position in the arrays below, invalidIndex when free
+    std::vector<uint32_t> indices;
+    std::vector<NodeId> freeIds;
+
+    // by position, sorted by depth once ordered is set
+    std::vector<Block> blocks;
+    std::vector<glm::aligned_mat4> local;
+    std::vector<glm::aligned_mat4> world;
+    // position of the parent, noParent for roots
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    // noParent once destroyed, until the next compaction
+    std::vector<NodeId> nodeIds;
+    // local transform set since the last update
+    std::vector<uint8_t> localDirty;
+    // version of the update that last recomputed the world matrix
+    std::vector<uint64_t> changedVersions;
+    // first position of every depth, plus the end
+    std::vector<uint32_t> levelStarts;
+
+    bool ordered = true;
+    uint32_t deadCount = 0;
+    uint64_t version = 0;
+    uint32_t lastRecomputed = 0;
+
+    static Block emptyBlock();
+    static void copyLane(Block &dst, uint32_t dstLane, const Block &src, uint32_t srcLane);
+    void writeLanes(uint32_t position, const Transform &transform);
+    // local matrices of the four nodes of a block
+    void composeBlock(uint32_t block);
+    uint32_t updateRange(uint32_t begin, uint32_t end);
+    // drops destroyed nodes and sorts by depth, keeping the order within a level
+    void reorder();
+};
+} // namespace vkScene
@@ -9,6 +9,15 @@
 
 namespace vkWSIHelper {
 
+enum class PresentPolicy {
+    // FIFO, always available
+    VSync,
+    // MAILBOX, falls back to IMMEDIATE and then FIFO
+    LowLatency,
+    // FIFO_RELAXED, falls back to FIFO
+    Throughput,
+};
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -17,6 +26,6 @@ struct SwapChainSupportDetails {
 
 SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, const VkSurfaceKHR &surface);
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes, PresentPolicy policy);
 VkExtent2D chooseSwapExtent(GLFWwindow *window, const VkSurfaceCapabilitiesKHR &capabilities);
 } // namespace vkWSIHelper
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "headers/hostAllocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace vkMemory {
+
+namespace {
+// sits right in front of every pointer handed to the driver
+struct Header {
+    uint64_t size;
+    uint16_t sizeClass;
+    uint8_t scope;
+    uint8_t padding;
+    // distance from the start of the system allocation, only used by large allocations
+    uint32_t offset;
+};
+static_assert(sizeof(Header) == 16);
+
+constexpr uint16_t largeClass = 0xFFFF;
+constexpr size_t headerSize = sizeof(Header);
+
+const char *scopeName(uint32_t scope) {
+    switch (scope) {
+    case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+        return "command";
+    case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+        return "object";
+    case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+        return "cache";
+    case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+        return "device";
+    case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+        return "instance";
+    default:
+        return "unknown";
+    }
+}
+
+Header *headerOf(void *memory) {
+    return reinterpret_cast<Header *>(static_cast<char *>(memory) - headerSize);
+}
+} // namespace
+
+HostAllocator::HostAllocator() {
+    vkCallbacks.pUserData = this;
+    vkCallbacks.pfnAllocation = allocationCallback;
+    vkCallbacks.pfnReallocation = reallocationCallback;
+    vkCallbacks.pfnFree = freeCallback;
+    vkCallbacks.pfnInternalAllocation = internalAllocationCallback;
+    vkCallbacks.pfnInternalFree = internalFreeCallback;
+}
+
+HostAllocator::~HostAllocator() {
+    for (auto &pool : pools) {
+        for (void *page : pool.pages) {
+            ::operator delete(page, align_val_t{64});
+        }
+    }
+}
+
+void *HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (size == 0) {
+        return nullptr;
+    }
+    ScopePool &pool = pools[min<uint32_t>(scope, scopeCount - 1)];
+
+    Header header{};
+    header.size = size;
+    header.scope = static_cast<uint8_t>(scope);
+
+    void *memory = nullptr;
+    size_t classSize = minClassSize;
+    uint16_t sizeClass = 0;
+    while (sizeClass < sizeClassCount && classSize < size + headerSize) {
+        classSize <<= 1;
+        sizeClass++;
+    }
+
+    lock_guard<mutex> lock{pool.mutex};
+    // slots are 16 byte aligned, anything stricter goes to the system heap
+    if (sizeClass < sizeClassCount && alignment <= headerSize) {
+        char *slot;
+        if (pool.freeLists[sizeClass] != nullptr) {
+            slot = reinterpret_cast<char *>(pool.freeLists[sizeClass]);
+            pool.freeLists[sizeClass] = pool.freeLists[sizeClass]->next;
+        } else {
+            if (pool.pageCursor == nullptr || pool.pageCursor + classSize > pool.pageEnd) {
+                void *page = ::operator new(arenaPageSize, align_val_t{64}, nothrow);
+                if (page == nullptr) {
+                    return nullptr;
+                }
+                pool.pages.push_back(page);
+                pool.pageCursor = static_cast<char *>(page);
+                pool.pageEnd = pool.pageCursor + arenaPageSize;
+            }
+            slot = pool.pageCursor;
+            pool.pageCursor += classSize;
+        }
+        header.sizeClass = sizeClass;
+        memory = slot + headerSize;
+        pool.stats.pooledAllocations++;
+    } else {
+        size_t offset = max(alignment, headerSize);
+        char *base = static_cast<char *>(::operator new(offset + size, align_val_t{offset}, nothrow));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        header.sizeClass = largeClass;
+        header.offset = static_cast<uint32_t>(offset);
+        memory = base + offset;
+    }
+    memcpy(headerOf(memory), &header, headerSize);
+
+    pool.stats.allocations++;
+    pool.stats.totalBytes += size;
+    pool.stats.liveAllocations++;
+    pool.stats.liveBytes += size;
+    pool.stats.peakBytes = max(pool.stats.peakBytes, pool.stats.liveBytes);
+    return memory;
+}
+
+void HostAllocator::free(void *memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    Header *header = headerOf(memory);
+    ScopePool &pool = pools[min<uint32_t>(header->scope, scopeCount - 1)];
+
+    lock_guard<mutex> lock{pool.mutex};
+    pool.stats.frees++;
+    pool.stats.liveAllocations--;
+    pool.stats.liveBytes -= header->size;
+
+    if (header->sizeClass == largeClass) {
+        size_t offset = header->offset;
+        ::operator delete(static_cast<char *>(memory) - offset, align_val_t{offset});
+        return;
+    }
+    auto *slot = reinterpret_cast<FreeSlot *>(header);
+    slot->next = pool.freeLists[header->sizeClass];
+    pool.freeLists[header->sizeClass] = slot;
+}
+
+void *HostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (original == nullptr) {
+        return allocate(size, alignment, scope);
+    }
+    if (size == 0) {
+        free(original);
+        return nullptr;
+    }
+
+    Header *header = headerOf(original);
+    ScopePool &pool = pools[min<uint32_t>(header->scope, scopeCount - 1)];
+    // shrinking or growing inside the slot keeps the pointer
+    if (header->sizeClass != largeClass && alignment <= headerSize &&
+        size + headerSize <= (minClassSize << header->sizeClass)) {
+        lock_guard<mutex> lock{pool.mutex};
+        pool.stats.reallocations++;
+        pool.stats.liveBytes = pool.stats.liveBytes - header->size + size;
+        pool.stats.peakBytes = max(pool.stats.peakBytes, pool.stats.liveBytes);
+        header->size = size;
+        return original;
+    }
+
+    void *memory = allocate(size, alignment, scope);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    memcpy(memory, original, min<size_t>(size, header->size));
+    free(original);
+    {
+        ScopePool &target = pools[min<uint32_t>(scope, scopeCount - 1)];
+        lock_guard<mutex> lock{target.mutex};
+        target.stats.reallocations++;
+    }
+    return memory;
+}
+
+HostScopeStats HostAllocator::getScopeStats(VkSystemAllocationScope scope) const {
+    const ScopePool &pool = pools[min<uint32_t>(scope, scopeCount - 1)];
+    lock_guard<mutex> lock{pool.mutex};
+    return pool.stats;
+}
+
+void HostAllocator::printStats(ostream &out) const {
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+        HostScopeStats stats = getScopeStats(static_cast<VkSystemAllocationScope>(scope));
+        out << "host scope " << scopeName(scope) << " : " << stats.allocations << " allocations ( "
+            << stats.pooledAllocations << " pooled ), " << stats.reallocations << " reallocations, "
+            << stats.frees << " frees, " << stats.totalBytes << " bytes total, " << stats.liveAllocations
+            << " live ( " << stats.liveBytes << " bytes ), peak " << stats.peakBytes << " bytes, "
+            << stats.internalAllocations << " internal ( " << stats.internalBytes << " bytes )" << endl;
+    }
+}
+
+void *VKAPI_CALL HostAllocator::allocationCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator *>(userData)->allocate(size, alignment, scope);
+}
+
+void *VKAPI_CALL HostAllocator::reallocationCallback(void *userData, void *original, size_t size, size_t alignment,
+                                                     VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator *>(userData)->reallocate(original, size, alignment, scope);
+}
+
+void VKAPI_CALL HostAllocator::freeCallback(void *userData, void *memory) {
+    static_cast<HostAllocator *>(userData)->free(memory);
+}
+
+void VKAPI_CALL HostAllocator::internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType,
+                                                          VkSystemAllocationScope scope) {
+    ScopePool &pool = static_cast<HostAllocator *>(userData)->pools[min<uint32_t>(scope, scopeCount - 1)];
+    lock_guard<mutex> lock{pool.mutex};
+    pool.stats.internalAllocations++;
+    pool.stats.internalBytes += size;
+}
+
+void VKAPI_CALL HostAllocator::internalFreeCallback(void *userData, size_t size, VkInternalAllocationType,
+                                                    VkSystemAllocationScope scope) {
+    ScopePool &pool = static_cast<HostAllocator *>(userData)->pools[min<uint32_t>(scope, scopeCount - 1)];
+    lock_guard<mutex> lock{pool.mutex};
+    pool.stats.internalBytes -= size;
+}
+} // namespace vkMemory
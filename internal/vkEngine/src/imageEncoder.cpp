@@ -0,0 +1,181 @@
+#include "headers/imageEncoder.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+namespace vkOutput {
+
+namespace {
+
+// a stored deflate block holds at most this many bytes
+constexpr size_t maxStoredBlock = 65535;
+
+const array<uint32_t, 256> &crcTable() {
+    static const array<uint32_t, 256> table = [] {
+        array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+void putBigEndian(vector<uint8_t> &out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// one row as rgb or rgba in memory order
+void copyRow(const PixelView &view, uint32_t y, bool alpha, uint8_t *out) {
+    const uint8_t *row = view.pixels + size_t{y} * view.rowPitch;
+    uint32_t red = view.bgra ? 2 : 0, blue = view.bgra ? 0 : 2;
+    if (alpha && !view.bgra) {
+        memcpy(out, row, size_t{view.width} * 4);
+        return;
+    }
+    for (uint32_t x = 0; x < view.width; x++, row += 4) {
+        *out++ = row[red];
+        *out++ = row[1];
+        *out++ = row[blue];
+        if (alpha) {
+            *out++ = row[3];
+        }
+    }
+}
+
+// length, type, data and the crc of type and data
+void writeChunk(vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size) {
+    putBigEndian(out, static_cast<uint32_t>(size));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    putBigEndian(out, crc32(out.data() + typeStart, size + 4));
+}
+
+void encodePng(const PixelView &view, vector<uint8_t> &out) {
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.insert(out.end(), begin(signature), end(signature));
+
+    vector<uint8_t> header;
+    putBigEndian(header, view.width);
+    putBigEndian(header, view.height);
+    // 8 bit rgb, deflate, adaptive filtering, no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    writeChunk(out, "IHDR", header.data(), header.size());
+
+    // filter type 0 in front of every row
+    size_t rowBytes = size_t{view.width} * 3 + 1;
+    vector<uint8_t> filtered(rowBytes * view.height);
+    for (uint32_t y = 0; y < view.height; y++) {
+        filtered[y * rowBytes] = 0;
+        copyRow(view, y, false, &filtered[y * rowBytes + 1]);
+    }
+
+    vector<uint8_t> zlib;
+    zlib.reserve(filtered.size() + filtered.size() / maxStoredBlock * 5 + 16);
+    // deflate, 32k window, fastest level, check bits
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do {
+        size_t blockSize = min(maxStoredBlock, filtered.size() - offset);
+        bool last = offset + blockSize == filtered.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        zlib.insert(zlib.end(), filtered.begin() + offset, filtered.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < filtered.size());
+    putBigEndian(zlib, adler32(filtered.data(), filtered.size()));
+    writeChunk(out, "IDAT", zlib.data(), zlib.size());
+    writeChunk(out, "IEND", nullptr, 0);
+}
+} // namespace
+
+const char *formatName(ImageFormat format) {
+    switch (format) {
+    case ImageFormat::Raw:
+        return "raw";
+    case ImageFormat::Ppm:
+        return "ppm";
+    case ImageFormat::Png:
+        return "png";
+    }
+    return "unknown";
+}
+
+bool parseFormat(const string &name, ImageFormat &format) {
+    for (ImageFormat candidate : {ImageFormat::Raw, ImageFormat::Ppm, ImageFormat::Png}) {
+        if (name == formatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void encode(ImageFormat format, const PixelView &view, vector<uint8_t> &out) {
+    switch (format) {
+    case ImageFormat::Raw: {
+        size_t start = out.size();
+        size_t rowBytes = size_t{view.width} * 4;
+        out.resize(start + rowBytes * view.height);
+        for (uint32_t y = 0; y < view.height; y++) {
+            copyRow(view, y, true, &out[start + y * rowBytes]);
+        }
+        break;
+    }
+    case ImageFormat::Ppm: {
+        string header = "P6\n" + to_string(view.width) + " " + to_string(view.height) + "\n255\n";
+        out.insert(out.end(), header.begin(), header.end());
+        size_t start = out.size();
+        size_t rowBytes = size_t{view.width} * 3;
+        out.resize(start + rowBytes * view.height);
+        for (uint32_t y = 0; y < view.height; y++) {
+            copyRow(view, y, false, &out[start + y * rowBytes]);
+        }
+        break;
+    }
+    case ImageFormat::Png:
+        encodePng(view, out);
+        break;
+    }
+}
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc) {
+    const auto &table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t *data, size_t size, uint32_t adler) {
+    uint32_t a = adler & 0xffff, b = adler >> 16;
+    while (size > 0) {
+        // the largest run that can not overflow b before the modulo
+        size_t run = min<size_t>(size, 5552);
+        size -= run;
+        for (size_t i = 0; i < run; i++) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+} // namespace vkOutput
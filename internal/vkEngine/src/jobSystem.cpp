@@ -0,0 +1,232 @@
+#include "headers/jobSystem.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkJobs {
+
+namespace {
+thread_local uint32_t currentWorker = 0;
+// spins before a worker goes to sleep, jobs usually come in bursts
+constexpr uint32_t idleSpins = 64;
+
+string describe(const exception_ptr &failure) {
+    try {
+        rethrow_exception(failure);
+    } catch (const std::exception &e) {
+        return e.what();
+    } catch (...) {
+        return "unknown exception";
+    }
+}
+} // namespace
+
+JobSystem::JobSystem(uint32_t threadCount) : owner(this_thread::get_id()) {
+    if (threadCount == 0) {
+        threadCount = max(thread::hardware_concurrency(), 1u);
+    }
+    for (uint32_t i = 0; i < threadCount; i++) {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (uint32_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        lock_guard<mutex> lock{sleepMutex};
+        stopping = true;
+    }
+    sleep.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+uint32_t JobSystem::workerIndex() {
+    return currentWorker;
+}
+
+void JobSystem::checkThread() const {
+    if (currentWorker == 0 && this_thread::get_id() != owner) {
+        throw std::runtime_error{"jobs may only be run and waited on by workers and the thread that created the job system!"};
+    }
+}
+
+void JobSystem::run(Job job, Counter *counter) {
+    checkThread();
+    if (counter != nullptr) {
+        lock_guard<mutex> lock{counter->mutex};
+        counter->pending.fetch_add(1, memory_order_relaxed);
+    }
+    push({std::move(job), counter});
+}
+
+void JobSystem::runAfter(Counter &dependency, Job job, Counter *counter) {
+    checkThread();
+    if (counter != nullptr) {
+        lock_guard<mutex> lock{counter->mutex};
+        counter->pending.fetch_add(1, memory_order_relaxed);
+    }
+    {
+        lock_guard<mutex> lock{dependency.mutex};
+        if (dependency.pending.load(memory_order_relaxed) != 0) {
+            dependency.continuations.push_back([this, job = std::move(job), counter]() mutable { push({std::move(job), counter}); });
+            return;
+        }
+    }
+    push({std::move(job), counter});
+}
+
+void JobSystem::push(Task task) {
+    WorkerQueue &queue = *queues[min<uint32_t>(currentWorker, workerCount() - 1)];
+    // raised before the task is visible so it never drops below the real count
+    queued.fetch_add(1);
+    {
+        lock_guard<mutex> lock{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    // sequentially consistent with the sleeper count of workerLoop, one of the two sides sees the other
+    if (sleepers.load() > 0) {
+        // taking the lock orders this with a worker about to sleep, so the wake up is not lost
+        { lock_guard<mutex> lock{sleepMutex}; }
+        sleep.notify_one();
+    }
+}
+
+bool JobSystem::pop(uint32_t self, Task &task) {
+    if (queued.load(memory_order_acquire) == 0) {
+        return false;
+    }
+    // own work newest first, it is still warm in the cache
+    {
+        WorkerQueue &queue = *queues[self];
+        lock_guard<mutex> lock{queue.mutex};
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            queued.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    // steal the oldest work of the others, starting next to us so thieves spread out
+    uint32_t count = workerCount();
+    for (uint32_t offset = 1; offset < count; offset++) {
+        WorkerQueue &victim = *queues[(self + offset) % count];
+        unique_lock<mutex> lock{victim.mutex, try_to_lock};
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1, memory_order_relaxed);
+        stolen.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::tryRunOne(uint32_t self) {
+    Task task;
+    if (!pop(self, task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(Task &task) {
+    try {
+        task.job();
+    } catch (...) {
+        if (task.counter != nullptr) {
+            lock_guard<mutex> lock{task.counter->mutex};
+            if (!task.counter->failure) {
+                task.counter->failure = current_exception();
+            }
+        } else {
+            // a later wait belongs to another group, blaming it would point at the wrong call site
+            failed.fetch_add(1, memory_order_relaxed);
+            cerr << "job failed : " << describe(current_exception()) << endl;
+        }
+    }
+    executed.fetch_add(1, memory_order_relaxed);
+    finish(task.counter);
+}
+
+void JobSystem::finish(Counter *counter) {
+    if (counter == nullptr) {
+        return;
+    }
+    vector<function<void()>> ready;
+    {
+        lock_guard<mutex> lock{counter->mutex};
+        if (counter->pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+            ready.swap(counter->continuations);
+        }
+    }
+    for (auto &continuation : ready) {
+        continuation();
+    }
+}
+
+void JobSystem::wait(Counter &counter) {
+    checkThread();
+    uint32_t self = min<uint32_t>(currentWorker, workerCount() - 1);
+    while (!counter.done()) {
+        if (!tryRunOne(self)) {
+            // the last jobs of the group are running elsewhere
+            this_thread::yield();
+        }
+    }
+    // finish releases the mutex after the last decrement, after this the counter may be destroyed
+    exception_ptr failure;
+    {
+        lock_guard<mutex> lock{counter.mutex};
+        swap(failure, counter.failure);
+    }
+    if (failure) {
+        rethrow_exception(failure);
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const function<void(uint32_t begin, uint32_t end)> &body) {
+    grain = max(grain, 1u);
+    Counter counter;
+    for (uint32_t begin = 0; begin < count; begin += grain) {
+        uint32_t end = min(count, begin + grain);
+        run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    wait(counter);
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    currentWorker = index;
+    vkProfiler::setThreadName("worker " + to_string(index));
+    uint32_t spins = 0;
+    while (true) {
+        if (tryRunOne(index)) {
+            spins = 0;
+            continue;
+        }
+        if (++spins < idleSpins) {
+            this_thread::yield();
+            continue;
+        }
+        spins = 0;
+
+        unique_lock<mutex> lock{sleepMutex};
+        sleepers.fetch_add(1);
+        sleep.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        sleepers.fetch_sub(1);
+        if (stopping) {
+            return;
+        }
+    }
+}
+} // namespace vkJobs
@@ -0,0 +1,39 @@
+#include "headers/meshAsset.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkAssets {
+
+MeshFile::MeshFile(const string &path) : file(path) {
+    if (file.size() < sizeof(meshFormat::MeshHeader)) {
+        throw std::runtime_error{"mesh " + path + " is truncated!"};
+    }
+    meshHeader = reinterpret_cast<const meshFormat::MeshHeader *>(file.data());
+    if (meshHeader->magic != meshFormat::magic || meshHeader->version != meshFormat::version) {
+        throw std::runtime_error{"mesh " + path + " has an unknown format!"};
+    }
+
+    const auto &header = *meshHeader;
+    uint64_t payloadEnd = header.payloadOffset + header.payloadSize;
+    if (header.payloadOffset < sizeof(meshFormat::MeshHeader) || header.payloadSize > file.size() ||
+        header.payloadOffset > file.size() - header.payloadSize) {
+        throw std::runtime_error{"mesh " + path + " payload is out of range!"};
+    }
+    for (uint32_t s = 0; s < meshFormat::StreamCount; s++) {
+        const auto &range = header.streams[s];
+        if (range.offset % meshFormat::streamAlignment != 0 || range.offset < header.payloadOffset || range.size > payloadEnd ||
+            range.offset > payloadEnd - range.size) {
+            throw std::runtime_error{"mesh " + path + " has a corrupted stream!"};
+        }
+    }
+
+    // the counts are trusted by whoever draws the mesh, so they have to fit their streams
+    if (header.streams[meshFormat::Vertices].size != uint64_t{header.vertexCount} * sizeof(meshFormat::Vertex) ||
+        header.streams[meshFormat::Indices].size != uint64_t{header.indexCount} * sizeof(uint32_t) ||
+        header.streams[meshFormat::Meshlets].size != uint64_t{header.meshletCount} * sizeof(meshFormat::Meshlet) ||
+        header.indexCount % 3 != 0) {
+        throw std::runtime_error{"mesh " + path + " stream sizes do not match its counts!"};
+    }
+}
+} // namespace vkAssets
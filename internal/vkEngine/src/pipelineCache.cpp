@@ -0,0 +1,247 @@
+#include "headers/pipelineCache.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkPipeline {
+
+namespace {
+constexpr uint32_t fileMagic = 0x43505650; // "PVPC"
+constexpr uint32_t fileVersion = 1;
+
+// prepended to the driver blob, the blob header alone does not carry the driver version
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    // fnv-1a over the blob, catches truncated or corrupted files
+    uint64_t checksum;
+    double averageMissMs;
+};
+
+uint64_t fnv1a(const char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+} // namespace
+
+double CacheStats::timeSavedMs() const {
+    double averageMiss = misses > 0 ? missMs / misses : baselineMissMs;
+    return max(0.0, averageMiss * hits - hitMs);
+}
+
+PipelineCache::PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *hostCallbacks,
+                             string path, bool creationFeedback)
+    : device(device), hostCallbacks(hostCallbacks), path(std::move(path)), creationFeedback(creationFeedback) {
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    string data;
+    if (!this->path.empty()) {
+        stats.rejectReason = readCacheFile(data);
+        if (!stats.rejectReason.empty()) {
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(device, &createInfo, hostCallbacks, &cache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // the driver may still refuse data that passed our checks, start cold instead
+        stats.rejectReason = "rejected by the driver";
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(device, &createInfo, hostCallbacks, &cache);
+        data.clear();
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create pipeline cache!"};
+    }
+    stats.loadedBytes = data.size();
+
+    if (!stats.rejectReason.empty()) {
+        cout << "pipeline cache " << this->path << " ignored : " << stats.rejectReason << endl;
+    } else if (!data.empty()) {
+        cout << "loaded pipeline cache " << this->path << " (" << data.size() << " bytes)" << endl;
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    vkDestroyPipelineCache(device, cache, hostCallbacks);
+}
+
+string PipelineCache::readCacheFile(string &data) {
+    ifstream file{path, ios::binary};
+    if (!file.is_open()) {
+        // first run, nothing to reject
+        return "";
+    }
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return "truncated header";
+    }
+    if (header.magic != fileMagic || header.version != fileVersion) {
+        return "unknown file format";
+    }
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID ||
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return "written by another device";
+    }
+    if (header.driverVersion != properties.driverVersion) {
+        return "written by another driver version";
+    }
+
+    // the size is checked against the file before anything is allocated for it
+    auto dataStart = file.tellg();
+    file.seekg(0, ios::end);
+    auto remaining = static_cast<uint64_t>(file.tellg() - dataStart);
+    if (!file || header.dataSize != remaining) {
+        return "truncated or corrupted data";
+    }
+    file.seekg(dataStart);
+    data.resize(header.dataSize);
+    if (!file.read(data.data(), static_cast<streamsize>(data.size())) || fnv1a(data.data(), data.size()) != header.checksum) {
+        return "truncated or corrupted data";
+    }
+
+    // the blob carries its own header, check it too in case the driver changed its format
+    VkPipelineCacheHeaderVersionOne blobHeader;
+    if (data.size() < sizeof(blobHeader)) {
+        return "truncated driver header";
+    }
+    memcpy(&blobHeader, data.data(), sizeof(blobHeader));
+    if (blobHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || blobHeader.headerSize < sizeof(blobHeader) ||
+        blobHeader.vendorID != properties.vendorID || blobHeader.deviceID != properties.deviceID ||
+        memcmp(blobHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return "driver header does not match the device";
+    }
+    stats.baselineMissMs = header.averageMissMs;
+    return "";
+}
+
+void PipelineCache::save() const {
+    if (path.empty()) {
+        return;
+    }
+
+    size_t size = 0;
+    vkGetPipelineCacheData(device, cache, &size, nullptr);
+    string data(size, '\0');
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+        cerr << "failed to read back the pipeline cache" << endl;
+        return;
+    }
+    data.resize(size);
+
+    FileHeader header{};
+    header.magic = fileMagic;
+    header.version = fileVersion;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = fnv1a(data.data(), data.size());
+    {
+        lock_guard<mutex> lock{statsMutex};
+        header.averageMissMs = stats.misses > 0 ? stats.missMs / stats.misses : stats.baselineMissMs;
+    }
+
+    string tmpPath = path + ".tmp";
+    {
+        ofstream file{tmpPath, ios::binary | ios::trunc};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), static_cast<streamsize>(data.size()));
+        file.flush();
+        if (!file.good()) {
+            cerr << "failed to write pipeline cache " << tmpPath << endl;
+            return;
+        }
+    }
+
+    error_code error;
+    filesystem::rename(tmpPath, path, error);
+    if (error) {
+        cerr << "failed to replace pipeline cache " << path << " : " << error.message() << endl;
+        filesystem::remove(tmpPath, error);
+        return;
+    }
+    cout << "saved pipeline cache " << path << " (" << data.size() << " bytes)" << endl;
+}
+
+template <typename CreateInfo, typename CreateFunction>
+VkPipeline PipelineCache::createPipeline(CreateInfo createInfo, CreateFunction create) {
+    VkPipelineCreationFeedbackEXT feedback{};
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+    if (creationFeedback) {
+        feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedbackInfo.pNext = createInfo.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        createInfo.pNext = &feedbackInfo;
+    }
+
+    VkPipeline pipeline;
+    auto start = chrono::steady_clock::now();
+    if (create(createInfo, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create pipeline!"};
+    }
+    double cpuMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    lock_guard<mutex> lock{statsMutex};
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) {
+        double ms = static_cast<double>(feedback.duration) / 1e6;
+        if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+            stats.hits++;
+            stats.hitMs += ms;
+        } else {
+            stats.misses++;
+            stats.missMs += ms;
+        }
+    } else {
+        stats.unclassified++;
+        stats.unclassifiedMs += cpuMs;
+    }
+    return pipeline;
+}
+
+VkPipeline PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo) {
+    return createPipeline(createInfo, [this](const VkGraphicsPipelineCreateInfo &info, VkPipeline *pipeline) {
+        return vkCreateGraphicsPipelines(device, cache, 1, &info, hostCallbacks, pipeline);
+    });
+}
+
+VkPipeline PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo &createInfo) {
+    return createPipeline(createInfo, [this](const VkComputePipelineCreateInfo &info, VkPipeline *pipeline) {
+        return vkCreateComputePipelines(device, cache, 1, &info, hostCallbacks, pipeline);
+    });
+}
+
+CacheStats PipelineCache::getStats() const {
+    lock_guard<mutex> lock{statsMutex};
+    return stats;
+}
+
+void PipelineCache::printStats(ostream &out) const {
+    CacheStats current = getStats();
+    out << "pipeline cache : " << current.hits << " hits (" << current.hitMs << " ms), " << current.misses << " misses ("
+        << current.missMs << " ms), " << current.unclassified << " unclassified (" << current.unclassifiedMs
+        << " ms), ~" << current.timeSavedMs() << " ms saved" << endl;
+}
+} // namespace vkPipeline
@@ -0,0 +1,244 @@
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkProfiler {
+
+namespace {
+constexpr uint64_t ringCapacity = 1 << 14;
+constexpr uint32_t droppedZone = ~0u;
+
+struct CpuEvent {
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+struct ThreadRing {
+    uint32_t threadId;
+    string name;
+    array<CpuEvent, ringCapacity> events;
+    // only the owning thread writes, the exporter reads up to head
+    atomic<uint64_t> head{0};
+};
+
+struct GpuEvent {
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// rings are kept after their thread exits so its zones still make it into the trace
+mutex registryMutex;
+vector<shared_ptr<ThreadRing>> rings;
+vector<GpuEvent> gpuEvents;
+constexpr size_t maxGpuEvents = 1 << 16;
+const uint64_t startupNs = nowNs();
+
+ThreadRing &threadRing() {
+    thread_local shared_ptr<ThreadRing> ring = []() {
+        auto created = make_shared<ThreadRing>();
+        lock_guard<mutex> lock{registryMutex};
+        created->threadId = static_cast<uint32_t>(rings.size());
+        created->name = "thread " + to_string(created->threadId);
+        rings.push_back(created);
+        return created;
+    }();
+    return *ring;
+}
+
+void writeJsonString(ofstream &out, const string &text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+} // namespace
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void setThreadName(const string &name) {
+    ThreadRing &ring = threadRing();
+    lock_guard<mutex> lock{registryMutex};
+    ring.name = name;
+}
+
+ScopedZone::~ScopedZone() {
+    ThreadRing &ring = threadRing();
+    uint64_t head = ring.head.load(memory_order_relaxed);
+    ring.events[head % ringCapacity] = {name, start, nowNs()};
+    ring.head.store(head + 1, memory_order_release);
+}
+
+bool exportChromeTrace(const string &path) {
+    ofstream out{path, ios::trunc};
+    if (!out.is_open()) {
+        return false;
+    }
+
+    lock_guard<mutex> lock{registryMutex};
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+    };
+    // trace timestamps are microseconds since the profiler started
+    auto micros = [](uint64_t ns) { return static_cast<double>(ns - min(ns, startupNs)) / 1000.0; };
+
+    out.precision(3);
+    out << fixed;
+    for (const auto &ring : rings) {
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+        writeJsonString(out, ring->name);
+        out << "}}";
+
+        uint64_t head = ring->head.load(memory_order_acquire);
+        for (uint64_t i = head - min(head, ringCapacity); i < head; i++) {
+            const CpuEvent &event = ring->events[i % ringCapacity];
+            separator();
+            out << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->threadId << ",\"ts\":" << micros(event.startNs)
+                << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000.0 << "}";
+        }
+    }
+
+    separator();
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"gpu\"}}";
+    for (const auto &event : gpuEvents) {
+        separator();
+        out << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << micros(event.startNs)
+            << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000.0 << "}";
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+GpuProfiler::GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+                         const VkAllocationCallbacks *hostCallbacks, uint32_t maxZones)
+    : device(device), hostCallbacks(hostCallbacks), maxZones(maxZones) {
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t validBits = families[queueFamily].timestampValidBits;
+    supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    if (!supported) {
+        return;
+    }
+    nsPerTick = properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = maxZones * 2;
+
+    frames.resize(framesInFlight);
+    for (auto &frame : frames) {
+        if (vkCreateQueryPool(device, &poolInfo, hostCallbacks, &frame.pool) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create timestamp query pool!"};
+        }
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (auto &frame : frames) {
+        vkDestroyQueryPool(device, frame.pool, hostCallbacks);
+    }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!supported) {
+        return;
+    }
+    currentFrame = frameIndex;
+    openZones = 0;
+    FrameQueries &frame = frames[frameIndex];
+    resolve(frame);
+
+    frame.zones.clear();
+    frame.cpuStartNs = nowNs();
+    vkCmdResetQueryPool(commandBuffer, frame.pool, 0, maxZones * 2);
+}
+
+uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char *name) {
+    if (!supported) {
+        return droppedZone;
+    }
+    FrameQueries &frame = frames[currentFrame];
+    if (frame.zones.size() >= maxZones) {
+        return droppedZone;
+    }
+    uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+    frame.zones.push_back({name, openZones++});
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, zone * 2);
+    return zone;
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone) {
+    if (zone == droppedZone) {
+        return;
+    }
+    openZones--;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].pool, zone * 2 + 1);
+}
+
+void GpuProfiler::resolve(FrameQueries &frame) {
+    if (frame.zones.empty()) {
+        return;
+    }
+    // value + availability per query, a frame that was never submitted simply has nothing available
+    vector<uint64_t> results(frame.zones.size() * 4);
+    vkGetQueryPoolResults(device, frame.pool, 0, static_cast<uint32_t>(frame.zones.size() * 2), results.size() * sizeof(uint64_t),
+                          results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    uint64_t firstTick = results[0] & timestampMask;
+    lock_guard<mutex> lock{registryMutex};
+    for (size_t zone = 0; zone < frame.zones.size(); zone++) {
+        const uint64_t *begin = &results[zone * 4];
+        const uint64_t *end = &results[zone * 4 + 2];
+        if (begin[1] == 0 || end[1] == 0) {
+            continue;
+        }
+        uint64_t beginTick = begin[0] & timestampMask;
+        uint64_t endTick = end[0] & timestampMask;
+        if (endTick < beginTick || beginTick < firstTick) {
+            // counter wrapped inside the frame
+            continue;
+        }
+        uint64_t startNs = frame.cpuStartNs + static_cast<uint64_t>(static_cast<double>(beginTick - firstTick) * nsPerTick);
+        uint64_t durationNs = static_cast<uint64_t>(static_cast<double>(endTick - beginTick) * nsPerTick);
+        if (frame.zones[zone].depth == 0) {
+            lastResolvedMs = static_cast<double>(durationNs) / 1e6;
+        }
+        if (gpuEvents.size() < maxGpuEvents) {
+            gpuEvents.push_back({frame.zones[zone].name, startNs, startNs + durationNs});
+        }
+    }
+}
+} // namespace vkProfiler
@@ -0,0 +1,609 @@
+#include "headers/renderGraph.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkGraph {
+
+namespace {
+
+enum class Target {
+    Image,
+    Buffer,
+    Both,
+};
+
+struct AccessInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+    VkBufferUsageFlags bufferUsage;
+    bool write;
+    Target target;
+};
+
+AccessInfo accessInfo(Access access) {
+    constexpr VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    switch (access) {
+    case Access::ColorAttachmentWrite:
+        // blending reads the attachment as well
+        return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0, true, Target::Image};
+    case Access::DepthAttachmentWrite:
+        return {depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, true, Target::Image};
+    case Access::DepthAttachmentRead:
+        return {depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, false, Target::Image};
+    case Access::FragmentSampled:
+        return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT, 0, false, Target::Image};
+    case Access::ComputeSampled:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT, 0, false, Target::Image};
+    case Access::ComputeStorageRead:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, Target::Both};
+    case Access::ComputeStorageWrite:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true, Target::Both};
+    case Access::TransferRead:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, false, Target::Both};
+    case Access::TransferWrite:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true, Target::Both};
+    case Access::VertexBufferRead:
+        return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, false, Target::Buffer};
+    case Access::IndexBufferRead:
+        return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                false, Target::Buffer};
+    case Access::IndirectRead:
+        return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false, Target::Buffer};
+    }
+    throw std::runtime_error{"unknown render graph access!"};
+}
+
+constexpr VkAccessFlags writeAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                          VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// every access of a resource within one pass, merged into a single transition
+struct Merged {
+    VkPipelineStageFlags stages = 0;
+    VkAccessFlags access = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool write = false;
+};
+
+double toMiB(uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+} // namespace
+
+void RenderGraph::PassBuilder::read(ResourceId resource, Access access) {
+    if (accessInfo(access).write) {
+        throw std::runtime_error{"render graph pass " + graph.passes[pass].name + " reads with a write access!"};
+    }
+    graph.passes[pass].accesses.push_back({resource, access});
+}
+
+void RenderGraph::PassBuilder::write(ResourceId resource, Access access) {
+    if (!accessInfo(access).write) {
+        throw std::runtime_error{"render graph pass " + graph.passes[pass].name + " writes with a read access!"};
+    }
+    graph.passes[pass].accesses.push_back({resource, access});
+}
+
+void RenderGraph::PassBuilder::keepAlive() {
+    graph.passes[pass].keepAlive = true;
+}
+
+RenderGraph::RenderGraph(VkDevice device, vkMemory::Allocator &allocator, const VkAllocationCallbacks *hostCallbacks,
+                         RetireFunction retire)
+    : device(device), allocator(allocator), hostCallbacks(hostCallbacks), retire(std::move(retire)) {
+}
+
+RenderGraph::~RenderGraph() {
+    // the device is idle by now, nothing is left to wait for
+    for (auto &resource : resources) {
+        if (resource.imported) {
+            continue;
+        }
+        vkDestroyImageView(device, resource.view, hostCallbacks);
+        vkDestroyImage(device, resource.image, hostCallbacks);
+        vkDestroyBuffer(device, resource.buffer, hostCallbacks);
+    }
+    for (auto &slot : slots) {
+        allocator.free(slot.allocation);
+    }
+}
+
+ResourceId RenderGraph::createImage(const string &name, const ImageInfo &info) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = true;
+    resource.imported = false;
+    resource.imageInfo = info;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+ResourceId RenderGraph::createBuffer(const string &name, VkDeviceSize size) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = false;
+    resource.bufferSize = size;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+ResourceId RenderGraph::importImage(const string &name, const ImageInfo &info, const ResourceState &initial, const ResourceState &final) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = true;
+    resource.imported = true;
+    resource.imageInfo = info;
+    resource.initial = initial;
+    resource.final = final;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+ResourceId RenderGraph::importBuffer(const string &name, const ResourceState &initial, const ResourceState &final) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = true;
+    resource.initial = initial;
+    resource.final = final;
+    resource.initial.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.final.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void RenderGraph::addPass(const string &name, const function<void(PassBuilder &)> &setup, PassFunction execute) {
+    if (compiled) {
+        throw std::runtime_error{"render graph is already compiled, clear it before adding passes!"};
+    }
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    PassBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+    setup(builder);
+    for (auto &[resource, access] : passes.back().accesses) {
+        if (resource >= resources.size()) {
+            throw std::runtime_error{"render graph pass " + name + " uses an unknown resource!"};
+        }
+        AccessInfo info = accessInfo(access);
+        bool isImage = resources[resource].isImage;
+        if ((info.target == Target::Image && !isImage) || (info.target == Target::Buffer && isImage)) {
+            throw std::runtime_error{"render graph pass " + name + " uses " + resources[resource].name + " with a wrong access!"};
+        }
+        resources[resource].imageUsage |= info.imageUsage;
+        resources[resource].bufferUsage |= info.bufferUsage;
+    }
+}
+
+void RenderGraph::compile() {
+    PROFILE_ZONE("compile render graph");
+    if (compiled) {
+        throw std::runtime_error{"render graph is already compiled!"};
+    }
+    cull();
+    createTransients();
+    planBarriers();
+    compiled = true;
+}
+
+void RenderGraph::clear() {
+    destroyTransients();
+    resources.clear();
+    passes.clear();
+    batches.clear();
+    alivePasses.clear();
+    graphStats = {};
+    compiled = false;
+}
+
+void RenderGraph::setImage(ResourceId resource, VkImage image, VkImageView view) {
+    auto &target = resources.at(resource);
+    if (!target.imported || !target.isImage) {
+        throw std::runtime_error{"render graph resource " + target.name + " is not an imported image!"};
+    }
+    target.image = image;
+    target.view = view;
+}
+
+void RenderGraph::setBuffer(ResourceId resource, VkBuffer buffer) {
+    auto &target = resources.at(resource);
+    if (!target.imported || target.isImage) {
+        throw std::runtime_error{"render graph resource " + target.name + " is not an imported buffer!"};
+    }
+    target.buffer = buffer;
+}
+
+VkImage RenderGraph::image(ResourceId resource) const {
+    return resources.at(resource).image;
+}
+
+VkImageView RenderGraph::view(ResourceId resource) const {
+    return resources.at(resource).view;
+}
+
+VkBuffer RenderGraph::buffer(ResourceId resource) const {
+    return resources.at(resource).buffer;
+}
+
+const GraphStats &RenderGraph::stats() const {
+    return graphStats;
+}
+
+void RenderGraph::cull() {
+    // walking backwards, a pass is needed when it writes something a later needed pass reads. writes are
+    // not assumed to overwrite the whole resource, so they never end the need for earlier writers
+    vector<bool> needed(resources.size());
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].imported;
+    }
+    for (size_t i = passes.size(); i-- > 0;) {
+        auto &pass = passes[i];
+        pass.alive = pass.keepAlive;
+        for (auto &[resource, access] : pass.accesses) {
+            pass.alive = pass.alive || (accessInfo(access).write && needed[resource]);
+        }
+        if (!pass.alive) {
+            continue;
+        }
+        for (auto &[resource, access] : pass.accesses) {
+            needed[resource] = needed[resource] || !accessInfo(access).write;
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        if (!passes[i].alive) {
+            continue;
+        }
+        uint32_t position = static_cast<uint32_t>(alivePasses.size());
+        alivePasses.push_back(i);
+        for (auto &[resource, access] : passes[i].accesses) {
+            AccessInfo info = accessInfo(access);
+            auto &target = resources[resource];
+            target.firstPass = min(target.firstPass, position);
+            target.lastPass = max(target.lastPass, position);
+            target.usedStages |= info.stages;
+            target.writtenAccess |= info.write ? info.access & writeAccessMask : 0;
+        }
+    }
+    graphStats.passes = static_cast<uint32_t>(alivePasses.size());
+    graphStats.culledPasses = static_cast<uint32_t>(passes.size() - alivePasses.size());
+}
+
+void RenderGraph::createTransients() {
+    vector<ResourceId> transients;
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        auto &resource = resources[id];
+        if (resource.imported || resource.firstPass == ~0u) {
+            continue;
+        }
+        if (resource.isImage) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = resource.imageInfo.format;
+            imageInfo.extent = {resource.imageInfo.extent.width, resource.imageInfo.extent.height, 1};
+            imageInfo.mipLevels = resource.imageInfo.mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = resource.imageUsage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(device, &imageInfo, hostCallbacks, &resource.image) != VK_SUCCESS) {
+                throw std::runtime_error{"failed to create render graph image " + resource.name + "!"};
+            }
+            vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+        } else {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = resource.bufferSize;
+            bufferInfo.usage = resource.bufferUsage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &resource.buffer) != VK_SUCCESS) {
+                throw std::runtime_error{"failed to create render graph buffer " + resource.name + "!"};
+            }
+            vkGetBufferMemoryRequirements(device, resource.buffer, &resource.requirements);
+        }
+        resource.memoryType = allocator.findMemoryType(resource.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        graphStats.transientBytes += resource.requirements.size;
+        transients.push_back(id);
+    }
+
+    // largest first, smaller resources then fill the slots of the big ones where their passes do not overlap
+    sort(transients.begin(), transients.end(),
+         [&](ResourceId a, ResourceId b) { return resources[a].requirements.size > resources[b].requirements.size; });
+    for (ResourceId id : transients) {
+        auto &resource = resources[id];
+        vkMemory::ResourceKind kind = resource.isImage ? vkMemory::ResourceKind::Image : vkMemory::ResourceKind::Buffer;
+        auto fits = [&](const Slot &slot) {
+            if (slot.kind != kind || slot.memoryType != resource.memoryType) {
+                return false;
+            }
+            return all_of(slot.occupants.begin(), slot.occupants.end(), [&](ResourceId other) {
+                return resources[other].lastPass < resource.firstPass || resource.lastPass < resources[other].firstPass;
+            });
+        };
+        auto slot = find_if(slots.begin(), slots.end(), fits);
+        if (slot == slots.end()) {
+            slots.push_back({kind, resource.memoryType, {0, 0, 1u << resource.memoryType}, {}, {}});
+            slot = slots.end() - 1;
+        }
+        slot->requirements.size = max(slot->requirements.size, resource.requirements.size);
+        slot->requirements.alignment = max(slot->requirements.alignment, resource.requirements.alignment);
+        slot->occupants.push_back(id);
+        resource.slot = static_cast<uint32_t>(slot - slots.begin());
+    }
+
+    for (auto &slot : slots) {
+        slot.allocation = allocator.allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, slot.kind);
+        graphStats.aliasedBytes += slot.requirements.size;
+        sort(slot.occupants.begin(), slot.occupants.end(),
+             [&](ResourceId a, ResourceId b) { return resources[a].firstPass < resources[b].firstPass; });
+        for (ResourceId id : slot.occupants) {
+            auto &resource = resources[id];
+            if (resource.isImage) {
+                vkBindImageMemory(device, resource.image, slot.allocation.memory, slot.allocation.offset);
+            } else {
+                vkBindBufferMemory(device, resource.buffer, slot.allocation.memory, slot.allocation.offset);
+            }
+        }
+    }
+
+    for (ResourceId id : transients) {
+        auto &resource = resources[id];
+        if (!resource.isImage) {
+            continue;
+        }
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.imageInfo.format;
+        viewInfo.subresourceRange = {resource.imageInfo.aspect, 0, resource.imageInfo.mipLevels, 0, 1};
+        if (vkCreateImageView(device, &viewInfo, hostCallbacks, &resource.view) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create render graph image view " + resource.name + "!"};
+        }
+    }
+}
+
+void RenderGraph::planBarriers() {
+    vector<Tracked> states(resources.size());
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        const auto &resource = resources[id];
+        auto &state = states[id];
+        if (resource.imported) {
+            // whoever used it before the graph counts as a writer when it wrote, as a reader otherwise
+            state.layout = resource.initial.layout;
+            if ((resource.initial.access & writeAccessMask) != 0) {
+                state.writeStages = resource.initial.stages;
+                state.writeAccess = resource.initial.access;
+            } else {
+                state.readStages = resource.initial.stages;
+            }
+        } else if (resource.slot != ~0u) {
+            // the memory was last used by the previous occupant of the slot, for the first one that is the
+            // last occupant in the previous frame. its contents are discarded, only its accesses are waited for
+            const auto &occupants = slots[resource.slot].occupants;
+            size_t index = find(occupants.begin(), occupants.end(), id) - occupants.begin();
+            const auto &previous = resources[occupants[(index + occupants.size() - 1) % occupants.size()]];
+            state.writeStages = previous.usedStages;
+            state.writeAccess = previous.writtenAccess;
+        }
+    }
+
+    batches.resize(alivePasses.size() + 1);
+    for (size_t position = 0; position < alivePasses.size(); position++) {
+        // a resource used several ways in one pass gets one transition covering all of them
+        vector<pair<ResourceId, Merged>> merged;
+        for (auto &[resource, access] : passes[alivePasses[position]].accesses) {
+            AccessInfo info = accessInfo(access);
+            auto entry = find_if(merged.begin(), merged.end(), [&](const auto &other) { return other.first == resource; });
+            if (entry == merged.end()) {
+                merged.push_back({resource, {info.stages, info.access, info.layout, info.write}});
+                continue;
+            }
+            auto &current = entry->second;
+            if (current.layout != info.layout) {
+                // depth tests and sampling can share the read only depth layout
+                bool depthRead = (current.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL &&
+                                  info.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) ||
+                                 (current.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+                                  info.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+                if (!depthRead) {
+                    throw std::runtime_error{"render graph pass " + passes[alivePasses[position]].name + " uses " +
+                                             resources[resource].name + " in two layouts!"};
+                }
+                current.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            }
+            current.stages |= info.stages;
+            current.access |= info.access;
+            current.write = current.write || info.write;
+        }
+        for (auto &[resource, use] : merged) {
+            transition(batches[position], resource, states[resource], use.stages, use.access, use.layout, use.write);
+        }
+    }
+    // imported resources are handed back in the state the next user expects
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        const auto &resource = resources[id];
+        if (resource.imported) {
+            bool write = (resource.final.access & writeAccessMask) != 0;
+            transition(batches.back(), id, states[id], resource.final.stages, resource.final.access, resource.final.layout, write);
+        }
+    }
+
+    for (auto &batch : batches) {
+        if (!batch.images.empty() || !batch.buffers.empty()) {
+            graphStats.barrierBatches++;
+            graphStats.imageBarriers += static_cast<uint32_t>(batch.images.size());
+            graphStats.bufferBarriers += static_cast<uint32_t>(batch.buffers.size());
+        }
+    }
+}
+
+void RenderGraph::transition(Batch &batch, ResourceId resource, Tracked &state, VkPipelineStageFlags stages, VkAccessFlags access,
+                             VkImageLayout layout, bool write) const {
+    const auto &target = resources[resource];
+    VkImageLayout oldLayout = state.layout;
+    bool layoutChange = target.isImage && oldLayout != layout;
+    VkPipelineStageFlags srcStages = 0;
+    VkAccessFlags srcAccess = 0;
+    bool needed;
+    if (write || layoutChange) {
+        // writes and layout transitions wait for the last write and every read since, reads need no flush
+        srcStages = state.writeStages | state.readStages;
+        srcAccess = state.writeAccess;
+        needed = layoutChange || srcStages != 0;
+        // a layout transition counts as a write, made visible to the stages of this access
+        state.writeStages = stages;
+        state.writeAccess = write ? access & writeAccessMask : 0;
+        state.readStages = write ? 0 : stages;
+        state.visibleStages = write ? 0 : stages;
+        state.layout = layout;
+    } else {
+        // reads only wait for a write that was not made visible to their stages yet
+        srcStages = state.writeStages;
+        srcAccess = state.writeAccess;
+        needed = state.writeStages != 0 && (stages & ~state.visibleStages) != 0;
+        state.visibleStages |= needed ? stages : 0;
+        state.readStages |= stages;
+    }
+    if (!needed) {
+        return;
+    }
+
+    batch.srcStages |= srcStages != 0 ? srcStages : VkPipelineStageFlags{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+    batch.dstStages |= stages;
+    if (target.isImage) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = access;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange = {target.imageInfo.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+        batch.images.push_back({resource, barrier});
+    } else {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.size = VK_WHOLE_SIZE;
+        batch.buffers.push_back({resource, barrier});
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) const {
+    if (!compiled) {
+        throw std::runtime_error{"render graph is not compiled!"};
+    }
+    vector<VkImageMemoryBarrier> imageBarriers;
+    vector<VkBufferMemoryBarrier> bufferBarriers;
+    auto recordBatch = [&](const Batch &batch) {
+        if (batch.images.empty() && batch.buffers.empty()) {
+            return;
+        }
+        imageBarriers.clear();
+        bufferBarriers.clear();
+        for (auto [resource, barrier] : batch.images) {
+            barrier.image = resources[resource].image;
+            if (barrier.image == VK_NULL_HANDLE) {
+                throw std::runtime_error{"render graph image " + resources[resource].name + " was not set!"};
+            }
+            imageBarriers.push_back(barrier);
+        }
+        for (auto [resource, barrier] : batch.buffers) {
+            barrier.buffer = resources[resource].buffer;
+            if (barrier.buffer == VK_NULL_HANDLE) {
+                throw std::runtime_error{"render graph buffer " + resources[resource].name + " was not set!"};
+            }
+            bufferBarriers.push_back(barrier);
+        }
+        vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr, static_cast<uint32_t>(bufferBarriers.size()),
+                             bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    };
+
+    for (size_t position = 0; position < alivePasses.size(); position++) {
+        recordBatch(batches[position]);
+        const auto &pass = passes[alivePasses[position]];
+        if (pass.execute) {
+            pass.execute(commandBuffer);
+        }
+    }
+    recordBatch(batches.back());
+}
+
+void RenderGraph::printStats(ostream &out) const {
+    out << "render graph : " << graphStats.passes << " passes, " << graphStats.culledPasses << " culled, " << graphStats.barrierBatches
+        << " barrier batches ( " << graphStats.imageBarriers << " image, " << graphStats.bufferBarriers << " buffer ), transient "
+        << fixed << setprecision(1) << toMiB(graphStats.transientBytes) << " MiB aliased into " << toMiB(graphStats.aliasedBytes) << " MiB"
+        << defaultfloat << endl;
+}
+
+void RenderGraph::destroyTransients() {
+    vector<VkImageView> views;
+    vector<VkImage> images;
+    vector<VkBuffer> buffers;
+    vector<vkMemory::Allocation> allocations;
+    for (auto &resource : resources) {
+        if (resource.imported) {
+            continue;
+        }
+        if (resource.view != VK_NULL_HANDLE) {
+            views.push_back(resource.view);
+        }
+        if (resource.image != VK_NULL_HANDLE) {
+            images.push_back(resource.image);
+        }
+        if (resource.buffer != VK_NULL_HANDLE) {
+            buffers.push_back(resource.buffer);
+        }
+    }
+    for (auto &slot : slots) {
+        allocations.push_back(slot.allocation);
+    }
+    slots.clear();
+    if (views.empty() && images.empty() && buffers.empty() && allocations.empty()) {
+        return;
+    }
+    // frames recorded with the old graph may still use them
+    retire([device = device, callbacks = hostCallbacks, &allocator = allocator, views = std::move(views), images = std::move(images),
+            buffers = std::move(buffers), allocations = std::move(allocations)]() {
+        for (VkImageView view : views) {
+            vkDestroyImageView(device, view, callbacks);
+        }
+        for (VkImage image : images) {
+            vkDestroyImage(device, image, callbacks);
+        }
+        for (VkBuffer buffer : buffers) {
+            vkDestroyBuffer(device, buffer, callbacks);
+        }
+        for (const auto &allocation : allocations) {
+            allocator.free(allocation);
+        }
+    });
+}
+} // namespace vkGraph
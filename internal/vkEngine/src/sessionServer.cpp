@@ -0,0 +1,154 @@
+#include "headers/sessionServer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+using serverClock = chrono::steady_clock;
+
+double elapsedMs(serverClock::time_point since) {
+    return chrono::duration<double, milli>(serverClock::now() - since).count();
+}
+} // namespace
+
+SessionServer::SessionServer(ContextConfig config) : context(make_shared<EngineContext>(std::move(config))) {
+    context->init();
+    cout << "session server context ready in " << context->startupMs() << " ms" << endl;
+}
+
+SessionServer::~SessionServer() {
+    // only reached with sessions left when run() threw, that error is the one passed on
+    for (auto &session : sessions) {
+        if (session.started) {
+            try {
+                session.engine->stop();
+            } catch (const std::exception &e) {
+                cerr << "failed to stop session " << session.stats.id << " : " << e.what() << endl;
+            }
+        }
+    }
+    sessions.clear();
+}
+
+GEngine &SessionServer::addSession(uint32_t width, uint32_t height, EngineConfig config, uint32_t weight) {
+    Session session;
+    session.engine = make_unique<GEngine>(context, width, height, config);
+    session.stats.id = nextId++;
+    session.stats.weight = max(weight, 1u);
+    sessions.push_back(std::move(session));
+    return *sessions.back().engine;
+}
+
+void SessionServer::run() {
+    PROFILE_ZONE("SessionServer::run");
+    startPending();
+    while (!sessions.empty()) {
+        if (context->getConfig().presentable) {
+            glfwPollEvents();
+        }
+        // a closed window should not render another frame
+        for (size_t i = sessions.size(); i-- > 0;) {
+            if (sessions[i].engine->finished()) {
+                retire(i);
+            }
+        }
+        if (sessions.empty()) {
+            break;
+        }
+        renderOne(pick());
+        startPending();
+    }
+}
+
+void SessionServer::startPending() {
+    // late sessions start level with the others instead of owing them everything rendered so far
+    double floor = 0.0;
+    bool any = false;
+    for (const auto &session : sessions) {
+        if (session.started) {
+            floor = any ? min(floor, session.virtualMs) : session.virtualMs;
+            any = true;
+        }
+    }
+    for (size_t i = 0; i < sessions.size(); i++) {
+        if (sessions[i].started) {
+            continue;
+        }
+        auto start = serverClock::now();
+        Session &session = sessions[i];
+        session.engine->start();
+        session.stats.startMs = elapsedMs(start);
+        session.started = true;
+        session.virtualMs = floor;
+        cout << "started session " << session.stats.id << " in " << session.stats.startMs << " ms" << endl;
+    }
+}
+
+size_t SessionServer::pick() const {
+    size_t best = sessions.size();
+    bool bestReady = false;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        bool ready = sessions[i].engine->frameReady();
+        if (best == sessions.size() || (ready && !bestReady) || (ready == bestReady && sessions[i].virtualMs < sessions[best].virtualMs)) {
+            best = i;
+            bestReady = ready;
+        }
+    }
+    return best;
+}
+
+void SessionServer::renderOne(size_t index) {
+    GEngine &engine = *sessions[index].engine;
+    const FrameStats &stats = engine.getFrameStats();
+    uint64_t framesBefore = stats.frameCount;
+    auto start = serverClock::now();
+    engine.renderFrame();
+    double costMs = elapsedMs(start);
+    // a frame skipped for a swapchain recreation is charged the recreation
+    if (stats.frameCount > framesBefore) {
+        costMs = max(costMs - stats.fenceWait.lastMs, stats.gpuFrame.lastMs);
+    }
+    // frame tasks may have added sessions
+    Session &session = sessions[index];
+    session.stats.frames = stats.frameCount;
+    session.stats.chargedMs += costMs;
+    session.virtualMs += costMs / session.stats.weight;
+}
+
+void SessionServer::retire(size_t index) {
+    Session &session = sessions[index];
+    if (session.started) {
+        session.engine->stop();
+        session.stats.frames = session.engine->getFrameStats().frameCount;
+    }
+    finishedStats.push_back(session.stats);
+    // gives its targets and frame state back to the context right away
+    sessions.erase(sessions.begin() + static_cast<ptrdiff_t>(index));
+}
+
+EngineContext &SessionServer::getContext() {
+    return *context;
+}
+
+const vector<SessionStats> &SessionServer::getStats() const {
+    return finishedStats;
+}
+
+void SessionServer::printStats(ostream &out) const {
+    double startTotal = 0.0, chargedTotal = 0.0;
+    for (const auto &stats : finishedStats) {
+        startTotal += stats.startMs;
+        chargedTotal += stats.chargedMs;
+    }
+    size_t count = finishedStats.size();
+    out << "sessions : " << count << " on one context started in " << context->startupMs() << " ms, session start avg "
+        << (count == 0 ? 0.0 : startTotal / static_cast<double>(count)) << " ms" << endl;
+    for (const auto &stats : finishedStats) {
+        out << "\tsession " << stats.id << " : " << stats.frames << " frames, weight " << stats.weight << ", "
+            << (chargedTotal == 0.0 ? 0.0 : 100.0 * stats.chargedMs / chargedTotal) << " % of the charged time" << endl;
+    }
+    context->printStats(out);
+}
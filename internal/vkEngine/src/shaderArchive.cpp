@@ -0,0 +1,66 @@
+#include "headers/shaderArchive.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkPipeline {
+
+ShaderArchive::ShaderArchive(const string &path) : file(path) {
+    if (file.size() < sizeof(shaderArchive::ArchiveHeader)) {
+        throw std::runtime_error{"shader archive " + path + " is truncated!"};
+    }
+    header = reinterpret_cast<const shaderArchive::ArchiveHeader *>(file.data());
+    if (header->magic != shaderArchive::magic || header->version != shaderArchive::version) {
+        throw std::runtime_error{"shader archive " + path + " has an unknown format!"};
+    }
+    entries = reinterpret_cast<const shaderArchive::ArchiveEntry *>(file.data() + sizeof(shaderArchive::ArchiveHeader));
+
+    // validate the index once so lookups can trust it
+    uint64_t indexEnd = sizeof(shaderArchive::ArchiveHeader) + uint64_t{header->entryCount} * sizeof(shaderArchive::ArchiveEntry);
+    if (indexEnd > file.size()) {
+        throw std::runtime_error{"shader archive " + path + " index is truncated!"};
+    }
+    for (uint32_t i = 0; i < header->entryCount; i++) {
+        const auto &entry = entries[i];
+        if (entry.offset % shaderArchive::blobAlignment != 0 || entry.offset < indexEnd || entry.size > file.size() ||
+            entry.offset > file.size() - entry.size || entry.name[shaderArchive::maxNameLength - 1] != '\0') {
+            throw std::runtime_error{"shader archive " + path + " has a corrupted entry!"};
+        }
+    }
+}
+
+const shaderArchive::ArchiveEntry *ShaderArchive::find(string_view name) const {
+    // the packer sorts entries by name
+    const auto *end = entries + header->entryCount;
+    const auto *it = lower_bound(entries, end, name, [](const shaderArchive::ArchiveEntry &entry, string_view value) {
+        return string_view{entry.name} < value;
+    });
+    if (it == end || string_view{it->name} != name) {
+        return nullptr;
+    }
+    return it;
+}
+
+bool ShaderArchive::contains(string_view name) const {
+    return find(name) != nullptr;
+}
+
+VkShaderModule ShaderArchive::createShaderModule(VkDevice device, string_view name, const VkAllocationCallbacks *hostCallbacks) const {
+    const auto *entry = find(name);
+    if (entry == nullptr) {
+        throw std::runtime_error{"shader " + string{name} + " is not in the shader archive!"};
+    }
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = entry->size;
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(file.data() + entry->offset);
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &createInfo, hostCallbacks, &module) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create shader module " + string{name} + "!"};
+    }
+    return module;
+}
+} // namespace vkPipeline
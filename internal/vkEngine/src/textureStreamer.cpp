@@ -0,0 +1,539 @@
+#include "headers/textureStreamer.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace vkAssets {
+
+namespace {
+
+// levels up to this size are the tail that never leaves vram
+constexpr uint32_t tailSize = 128;
+// the budget query is not free, memory usage does not change from one frame to the next
+constexpr uint64_t budgetRefreshFrames = 30;
+// share of the memory left by the rest of the process, resizing briefly holds two copies of a texture
+constexpr double budgetFraction = 0.8;
+// without VK_EXT_memory_budget the usage of everything else is unknown
+constexpr double fallbackFraction = 0.5;
+// staging memory in flight, more would only queue behind the loader thread
+constexpr VkDeviceSize maxPendingBytes = 64ull * 1024 * 1024;
+// a failed load is retried after this many frames, doubled with every failure in a row
+constexpr uint64_t retryBackoffFrames = 8;
+constexpr uint32_t maxLoadAttempts = 4;
+
+constexpr VkPipelineStageFlags samplingStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+double toMiB(uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+} // namespace
+
+TextureFile::TextureFile(const string &path) : file(path) {
+    if (file.size() < sizeof(textureFormat::TextureHeader)) {
+        throw std::runtime_error{"texture " + path + " is truncated!"};
+    }
+    textureHeader = reinterpret_cast<const textureFormat::TextureHeader *>(file.data());
+    const auto &header = *textureHeader;
+    if (header.magic != textureFormat::magic || header.version != textureFormat::version) {
+        throw std::runtime_error{"texture " + path + " has an unknown format!"};
+    }
+    // only what the converter writes, the mip sizes below assume 4 byte texels
+    if (header.format != textureFormat::formatRgba8Srgb || header.mipCount == 0 || header.mipCount > textureFormat::maxMipCount ||
+        header.width == 0 || header.height == 0) {
+        throw std::runtime_error{"texture " + path + " has an unsupported layout!"};
+    }
+    for (uint32_t level = 0; level < header.mipCount; level++) {
+        const auto &mip = header.mips[level];
+        if (mip.width != max(header.width >> level, 1u) || mip.height != max(header.height >> level, 1u) ||
+            mip.size != uint64_t{mip.width} * mip.height * 4 || mip.offset % textureFormat::mipAlignment != 0 ||
+            mip.offset < sizeof(textureFormat::TextureHeader) || mip.size > file.size() || mip.offset > file.size() - mip.size) {
+            throw std::runtime_error{"texture " + path + " has a corrupted mip level!"};
+        }
+    }
+}
+
+double StreamerStats::uploadMiBPerSecond() const {
+    return uploadSeconds > 0.0 ? toMiB(uploadedBytes) / uploadSeconds : 0.0;
+}
+
+TextureStreamer::TextureStreamer(VkPhysicalDevice physicalDevice, VkDevice device, vkMemory::Allocator &allocator,
+                                 const VkAllocationCallbacks *hostCallbacks, RetireFunction retire, bool memoryBudget,
+                                 VkDeviceSize fixedBudget, vkDescriptors::BindlessTable *bindless)
+    : physicalDevice(physicalDevice), device(device), allocator(allocator), hostCallbacks(hostCallbacks), retire(std::move(retire)),
+      memoryBudget(memoryBudget), fixedBudget(fixedBudget), bindless(bindless) {
+    refreshBudget();
+    loader = thread{&TextureStreamer::loaderLoop, this};
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        lock_guard lock{mutex};
+        stopping = true;
+    }
+    wake.notify_all();
+    loader.join();
+
+    for (auto &load : staged) {
+        if (load.staging != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, load.staging, hostCallbacks);
+            allocator.free(load.allocation);
+        }
+    }
+    for (auto &texture : textures) {
+        if (texture.image != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, texture.view, hostCallbacks);
+            vkDestroyImage(device, texture.image, hostCallbacks);
+            allocator.free(texture.allocation);
+        }
+    }
+}
+
+TextureHandle TextureStreamer::load(const string &path) {
+    PROFILE_ZONE("load texture");
+    auto file = make_shared<const TextureFile>(path);
+    const auto &header = file->header();
+
+    TextureHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<TextureHandle>(textures.size());
+        textures.emplace_back();
+    }
+    Texture &texture = textures[handle];
+    uint32_t generation = texture.generation;
+    texture = Texture{};
+    texture.generation = generation;
+    texture.file = std::move(file);
+    texture.live = true;
+    texture.residentMip = header.mipCount;
+    texture.tailMip = header.mipCount - 1;
+    while (texture.tailMip > 0 && max(header.mips[texture.tailMip - 1].width, header.mips[texture.tailMip - 1].height) <= tailSize) {
+        texture.tailMip--;
+    }
+    texture.wantedMip = texture.tailMip;
+    texture.lastUsedFrame = currentFrame;
+
+    // the tail is loaded whatever the budget says, a texture has to show something
+    queueLoad(handle, texture.tailMip, header.mipCount);
+    return handle;
+}
+
+void TextureStreamer::unload(TextureHandle handle) {
+    Texture &texture = textures.at(handle);
+    retireImage(texture);
+    texture.file.reset();
+    texture.live = false;
+    texture.loading = false;
+    texture.generation++;
+    freeHandles.push_back(handle);
+}
+
+void TextureStreamer::request(TextureHandle handle, uint32_t mip) {
+    Texture &texture = textures.at(handle);
+    texture.wantedMip = min(mip, texture.file->header().mipCount - 1);
+    texture.lastUsedFrame = currentFrame;
+}
+
+VkImageView TextureStreamer::view(TextureHandle handle) const {
+    return textures.at(handle).view;
+}
+
+uint32_t TextureStreamer::bindlessSlot(TextureHandle handle) const {
+    return textures.at(handle).bindlessSlot;
+}
+
+uint32_t TextureStreamer::residentMip(TextureHandle handle) const {
+    return textures.at(handle).residentMip;
+}
+
+void TextureStreamer::update(VkCommandBuffer commandBuffer, uint64_t frameNumber) {
+    PROFILE_ZONE("texture streaming");
+    currentFrame = frameNumber;
+    if (frameNumber - budgetFrame >= budgetRefreshFrames) {
+        refreshBudget();
+        budgetFrame = frameNumber;
+    }
+
+    vector<StagedLoad> finished;
+    {
+        lock_guard lock{mutex};
+        finished.swap(staged);
+    }
+    for (auto &load : finished) {
+        pendingBytes -= load.request.bytes;
+        Texture &texture = textures[load.request.texture];
+        if (load.error) {
+            failedLoads++;
+            // a load of an unloaded texture failing does not matter anymore
+            if (texture.live && texture.generation == load.request.generation) {
+                loadFailed(load.request.texture, load);
+            }
+        } else if (texture.live && texture.generation == load.request.generation) {
+            resize(commandBuffer, texture, load.request.firstMip, &load);
+            texture.loading = false;
+            texture.failedLoads = 0;
+        }
+        releaseStaging(load);
+    }
+
+    // textures used last frame keep their levels, the budget may run over until they are not
+    while (residentBytes + pendingBytes > budgetBytes && evictOne(commandBuffer, frameNumber)) {
+    }
+
+    // one level at a time, a texture that stops being requested stops growing
+    for (TextureHandle handle = 0; handle < textures.size() && pendingBytes < maxPendingBytes; handle++) {
+        Texture &texture = textures[handle];
+        if (!texture.live || texture.loading || texture.failed || texture.retryFrame > frameNumber) {
+            continue;
+        }
+        // the tail failed to load, it is retried whatever the budget says like in load
+        if (texture.residentMip == texture.file->header().mipCount) {
+            queueLoad(handle, texture.tailMip, texture.residentMip);
+            continue;
+        }
+        if (texture.wantedMip >= texture.residentMip || texture.lastUsedFrame + 1 < frameNumber) {
+            continue;
+        }
+        uint32_t level = texture.residentMip - 1;
+        VkDeviceSize bytes = texture.file->header().mips[level].size;
+        while (residentBytes + pendingBytes + bytes > budgetBytes && evictOne(commandBuffer, frameNumber)) {
+        }
+        if (residentBytes + pendingBytes + bytes > budgetBytes) {
+            deniedUpgrades++;
+            continue;
+        }
+        queueLoad(handle, level, texture.residentMip);
+    }
+}
+
+void TextureStreamer::queueLoad(TextureHandle handle, uint32_t firstMip, uint32_t endMip) {
+    Texture &texture = textures[handle];
+    const auto &header = texture.file->header();
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = firstMip; level < endMip; level++) {
+        bytes = alignUp(bytes, textureFormat::mipAlignment) + header.mips[level].size;
+    }
+    texture.loading = true;
+    pendingBytes += bytes;
+    {
+        lock_guard lock{mutex};
+        requests.push_back({handle, texture.generation, texture.file, firstMip, endMip, bytes});
+    }
+    wake.notify_one();
+}
+
+void TextureStreamer::loadFailed(TextureHandle handle, const StagedLoad &load) {
+    Texture &texture = textures[handle];
+    texture.loading = false;
+    texture.failedLoads++;
+    string reason;
+    try {
+        rethrow_exception(load.error);
+    } catch (const std::exception &e) {
+        reason = e.what();
+    } catch (...) {
+        reason = "unknown exception";
+    }
+    cerr << "failed to stream mips " << load.request.firstMip << " to " << load.request.endMip - 1 << " of texture " << handle << " : "
+         << reason << endl;
+    if (texture.failedLoads >= maxLoadAttempts) {
+        texture.failed = true;
+        cerr << "texture " << handle << " stops streaming after " << texture.failedLoads << " failed loads" << endl;
+        return;
+    }
+    texture.retryFrame = currentFrame + (retryBackoffFrames << (texture.failedLoads - 1));
+}
+
+void TextureStreamer::loaderLoop() {
+    vkProfiler::setThreadName("texture loader");
+    while (true) {
+        LoadRequest request;
+        {
+            unique_lock lock{mutex};
+            wake.wait(lock, [&] { return stopping || !requests.empty(); });
+            if (stopping) {
+                return;
+            }
+            request = std::move(requests.front());
+            requests.pop_front();
+        }
+        StagedLoad load;
+        try {
+            load = stage(request);
+        } catch (...) {
+            // handed to the main thread, which reports it from update
+            load.request = std::move(request);
+            load.error = current_exception();
+        }
+        lock_guard lock{mutex};
+        staged.push_back(std::move(load));
+    }
+}
+
+TextureStreamer::StagedLoad TextureStreamer::stage(const LoadRequest &request) {
+    PROFILE_ZONE("stage texture");
+    auto start = chrono::steady_clock::now();
+    StagedLoad load;
+    load.request = request;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = request.bytes;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferInfo, hostCallbacks, &load.staging) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create texture staging buffer!"};
+    }
+    try {
+        load.allocation = allocator.allocateBuffer(load.staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                   vkMemory::Strategy::Linear);
+    } catch (...) {
+        vkDestroyBuffer(device, load.staging, hostCallbacks);
+        throw;
+    }
+
+    // the mapping faults the pages in here, off the main thread
+    const auto &header = request.file->header();
+    auto *dst = static_cast<std::byte *>(load.allocation.mapped);
+    VkDeviceSize offset = 0;
+    for (uint32_t level = request.firstMip; level < request.endMip; level++) {
+        const auto &mip = header.mips[level];
+        offset = alignUp(offset, textureFormat::mipAlignment);
+        memcpy(dst + offset, request.file->mip(level), mip.size);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        region.imageExtent = {mip.width, mip.height, 1};
+        load.regions.push_back(region);
+        offset += mip.size;
+    }
+
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+    uploadedBytes.fetch_add(request.bytes, memory_order_relaxed);
+    uploadNanoseconds.fetch_add(static_cast<uint64_t>(elapsed.count()), memory_order_relaxed);
+    return load;
+}
+
+void TextureStreamer::releaseStaging(StagedLoad &load) {
+    if (load.staging == VK_NULL_HANDLE) {
+        return;
+    }
+    retire([device = device, callbacks = hostCallbacks, &allocator = allocator, staging = load.staging, allocation = load.allocation]() {
+        vkDestroyBuffer(device, staging, callbacks);
+        allocator.free(allocation);
+    });
+    load.staging = VK_NULL_HANDLE;
+}
+
+void TextureStreamer::resize(VkCommandBuffer commandBuffer, Texture &texture, uint32_t firstMip, const StagedLoad *upload) {
+    const auto &header = texture.file->header();
+    uint32_t levelCount = header.mipCount - firstMip;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = static_cast<VkFormat>(header.format);
+    imageInfo.extent = {header.mips[firstMip].width, header.mips[firstMip].height, 1};
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // source of the next resize
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImage image;
+    if (vkCreateImage(device, &imageInfo, hostCallbacks, &image) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create texture image!"};
+    }
+    vkMemory::Allocation allocation = allocator.allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageMemoryBarrier barriers[2]{};
+    for (auto &barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+    }
+    barriers[0].image = image;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    // earlier frames may still sample the old image, reads need no access mask
+    barriers[1].image = texture.image;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    uint32_t barrierCount = texture.image != VK_NULL_HANDLE ? 2 : 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | samplingStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                         0, nullptr, barrierCount, barriers);
+
+    // levels both images hold move on the gpu, the staging buffer only has the missing ones
+    if (texture.image != VK_NULL_HANDLE) {
+        vector<VkImageCopy> copies;
+        for (uint32_t level = max(firstMip, texture.residentMip); level < header.mipCount; level++) {
+            VkImageCopy copy{};
+            copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.residentMip, 0, 1};
+            copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - firstMip, 0, 1};
+            copy.extent = {header.mips[level].width, header.mips[level].height, 1};
+            copies.push_back(copy);
+        }
+        vkCmdCopyImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(copies.size()), copies.data());
+    }
+    if (upload != nullptr) {
+        vector<VkBufferImageCopy> regions = upload->regions;
+        for (auto &region : regions) {
+            region.imageSubresource.mipLevel -= firstMip;
+        }
+        vkCmdCopyBufferToImage(commandBuffer, upload->staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, samplingStages, 0, 0, nullptr, 0, nullptr, 1, barriers);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, hostCallbacks, &view) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create texture image view!"};
+    }
+
+    retireImage(texture);
+    texture.image = image;
+    texture.view = view;
+    texture.allocation = allocation;
+    texture.residentMip = firstMip;
+    residentBytes += allocation.size;
+    if (bindless != nullptr) {
+        texture.bindlessSlot = bindless->addTexture(view);
+    }
+}
+
+void TextureStreamer::retireImage(Texture &texture) {
+    if (texture.image == VK_NULL_HANDLE) {
+        return;
+    }
+    residentBytes -= texture.allocation.size;
+    // frames in flight may read the old view through the old slot, the table recycles it after them
+    if (bindless != nullptr && texture.bindlessSlot != vkDescriptors::invalidSlot) {
+        bindless->releaseTexture(texture.bindlessSlot);
+        texture.bindlessSlot = vkDescriptors::invalidSlot;
+    }
+    retire([device = device, callbacks = hostCallbacks, &allocator = allocator, image = texture.image, view = texture.view,
+            allocation = texture.allocation]() {
+        vkDestroyImageView(device, view, callbacks);
+        vkDestroyImage(device, image, callbacks);
+        allocator.free(allocation);
+    });
+    texture.image = VK_NULL_HANDLE;
+    texture.view = VK_NULL_HANDLE;
+    texture.allocation = {};
+}
+
+bool TextureStreamer::evictOne(VkCommandBuffer commandBuffer, uint64_t frameNumber) {
+    // least recently used first, a texture gives up at most one level per frame
+    Texture *victim = nullptr;
+    for (auto &texture : textures) {
+        if (!texture.live || texture.loading || texture.residentMip >= texture.tailMip || texture.lastUsedFrame + 1 >= frameNumber ||
+            texture.evictedFrame == frameNumber) {
+            continue;
+        }
+        if (victim == nullptr || texture.lastUsedFrame < victim->lastUsedFrame) {
+            victim = &texture;
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+    resize(commandBuffer, *victim, victim->residentMip + 1, nullptr);
+    victim->evictedFrame = frameNumber;
+    evictedMips++;
+    return true;
+}
+
+void TextureStreamer::refreshBudget() {
+    if (fixedBudget != 0) {
+        budgetBytes = fixedBudget;
+        return;
+    }
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = memoryBudget ? &budget : nullptr;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+    const auto &memoryProperties = properties.memoryProperties;
+    uint32_t heap = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+            memoryProperties.memoryHeaps[i].size > memoryProperties.memoryHeaps[heap].size) {
+            heap = i;
+        }
+    }
+    if (!memoryBudget) {
+        budgetBytes = static_cast<VkDeviceSize>(static_cast<double>(memoryProperties.memoryHeaps[heap].size) * fallbackFraction);
+        return;
+    }
+    // the budget covers the whole process and other processes, textures get a share of what the rest leaves
+    VkDeviceSize otherUsage = budget.heapUsage[heap] - min(budget.heapUsage[heap], residentBytes);
+    VkDeviceSize available = budget.heapBudget[heap] - min(budget.heapBudget[heap], otherUsage);
+    budgetBytes = static_cast<VkDeviceSize>(static_cast<double>(available) * budgetFraction);
+}
+
+StreamerStats TextureStreamer::stats() const {
+    StreamerStats result;
+    for (const auto &texture : textures) {
+        if (!texture.live) {
+            continue;
+        }
+        uint32_t mipCount = texture.file->header().mipCount;
+        result.textureCount++;
+        result.totalMips += mipCount;
+        result.residentMips += mipCount - texture.residentMip;
+        result.failedTextures += texture.failed;
+    }
+    result.residentBytes = residentBytes;
+    result.budgetBytes = budgetBytes;
+    result.uploadedBytes = uploadedBytes.load(memory_order_relaxed);
+    result.uploadSeconds = static_cast<double>(uploadNanoseconds.load(memory_order_relaxed)) * 1e-9;
+    result.evictedMips = evictedMips;
+    result.deniedUpgrades = deniedUpgrades;
+    result.failedLoads = failedLoads;
+    return result;
+}
+
+void TextureStreamer::printStats(ostream &out) const {
+    StreamerStats s = stats();
+    out << fixed << setprecision(1) << "textures : " << s.textureCount << ", " << toMiB(s.residentBytes) << " / " << toMiB(s.budgetBytes)
+        << " MiB resident, " << s.residentMips << " / " << s.totalMips << " mips, " << toMiB(s.uploadedBytes) << " MiB streamed at "
+        << s.uploadMiBPerSecond() << " MiB/s, " << s.evictedMips << " mips evicted, " << s.deniedUpgrades << " upgrades denied";
+    if (s.failedLoads > 0) {
+        out << ", " << s.failedLoads << " loads failed, " << s.failedTextures << " textures gave up";
+    }
+    out << endl;
+    out << defaultfloat;
+}
+} // namespace vkAssets
@@ -0,0 +1,315 @@
+#include "headers/transformStore.hpp"
+#include "headers/profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace vkScene {
+
+namespace {
+
+// blocks per job when composing local matrices, nodes per job when updating a level
+constexpr uint32_t composeGrain = 256;
+constexpr uint32_t updateGrain = 2048;
+}
+
+TransformStore::TransformStore(uint32_t capacity) : maxNodes(capacity), indices(capacity, invalidIndex), levelStarts{0} {
+    freeIds.reserve(capacity);
+    // handed out from the back, lowest ids first
+    for (uint32_t id = capacity; id > 0; id--) {
+        freeIds.push_back(id - 1);
+    }
+}
+
+TransformStore::Block TransformStore::emptyBlock() {
+    // padding lanes hold identity transforms, composing them is harmless
+    glm::aligned_vec4 zero{0.0f}, one{1.0f};
+    return {zero, zero, zero, zero, zero, zero, one, one, one, one};
+}
+
+void TransformStore::copyLane(Block &dst, uint32_t dstLane, const Block &src, uint32_t srcLane) {
+    static constexpr glm::aligned_vec4 Block::*fields[] = {
+        &Block::positionX, &Block::positionY, &Block::positionZ, &Block::rotationX, &Block::rotationY,
+        &Block::rotationZ, &Block::rotationW, &Block::scaleX,    &Block::scaleY,    &Block::scaleZ,
+    };
+    for (auto field : fields) {
+        (dst.*field)[dstLane] = (src.*field)[srcLane];
+    }
+}
+
+NodeId TransformStore::create(NodeId parent, const Transform &transform) {
+    if (freeIds.empty()) {
+        throw std::runtime_error{"transform store holds at most " + to_string(maxNodes) + " nodes!"};
+    }
+    uint32_t parentPosition = noParent;
+    uint32_t depth = 0;
+    if (parent != noParent) {
+        if (!alive(parent)) {
+            throw std::runtime_error{"parent transform node does not exist!"};
+        }
+        parentPosition = indices[parent];
+        depth = depths[parentPosition] + 1;
+    }
+    NodeId node = freeIds.back();
+    freeIds.pop_back();
+
+    // appended after its parent, only the depth order can break
+    uint32_t position = static_cast<uint32_t>(nodeIds.size());
+    if (ordered && (depths.empty() || depth >= depths.back())) {
+        if (depth + 1 == levelStarts.size()) {
+            levelStarts.push_back(position + 1);
+        } else {
+            levelStarts.back() = position + 1;
+        }
+    } else {
+        ordered = false;
+    }
+    if (position % 4 == 0) {
+        blocks.push_back(emptyBlock());
+    }
+    local.emplace_back(1.0f);
+    world.emplace_back(1.0f);
+    parents.push_back(parentPosition);
+    depths.push_back(depth);
+    nodeIds.push_back(node);
+    localDirty.push_back(1);
+    changedVersions.push_back(0);
+    indices[node] = position;
+    writeLanes(position, transform);
+    return node;
+}
+
+void TransformStore::destroy(NodeId node) {
+    if (!alive(node)) {
+        throw std::runtime_error{"transform node does not exist!"};
+    }
+    uint32_t first = indices[node];
+    // children always come after their parent, so one pass over what follows finds the whole subtree
+    vector<uint8_t> removed(nodeIds.size() - first, 0);
+    for (uint32_t position = first; position < nodeIds.size(); position++) {
+        uint32_t parent = parents[position];
+        bool inSubtree = position == first || (parent != noParent && parent >= first && removed[parent - first]);
+        if (!inSubtree || nodeIds[position] == noParent) {
+            continue;
+        }
+        removed[position - first] = 1;
+        indices[nodeIds[position]] = invalidIndex;
+        freeIds.push_back(nodeIds[position]);
+        nodeIds[position] = noParent;
+        deadCount++;
+    }
+    ordered = false;
+}
+
+bool TransformStore::alive(NodeId node) const {
+    return node < maxNodes && indices[node] != invalidIndex;
+}
+
+void TransformStore::setLocal(NodeId node, const Transform &transform) {
+    if (!alive(node)) {
+        throw std::runtime_error{"transform node does not exist!"};
+    }
+    writeLanes(indices[node], transform);
+    localDirty[indices[node]] = 1;
+}
+
+Transform TransformStore::getLocal(NodeId node) const {
+    if (!alive(node)) {
+        throw std::runtime_error{"transform node does not exist!"};
+    }
+    uint32_t position = indices[node];
+    const Block &block = blocks[position / 4];
+    uint32_t lane = position % 4;
+    Transform transform;
+    transform.position = {block.positionX[lane], block.positionY[lane], block.positionZ[lane]};
+    transform.rotation = glm::quat{block.rotationW[lane], block.rotationX[lane], block.rotationY[lane], block.rotationZ[lane]};
+    transform.scale = {block.scaleX[lane], block.scaleY[lane], block.scaleZ[lane]};
+    return transform;
+}
+
+glm::mat4 TransformStore::getWorld(NodeId node) const {
+    if (!alive(node)) {
+        throw std::runtime_error{"transform node does not exist!"};
+    }
+    return glm::mat4(world[indices[node]]);
+}
+
+void TransformStore::writeLanes(uint32_t position, const Transform &transform) {
+    Block &block = blocks[position / 4];
+    uint32_t lane = position % 4;
+    block.positionX[lane] = transform.position.x;
+    block.positionY[lane] = transform.position.y;
+    block.positionZ[lane] = transform.position.z;
+    block.rotationX[lane] = transform.rotation.x;
+    block.rotationY[lane] = transform.rotation.y;
+    block.rotationZ[lane] = transform.rotation.z;
+    block.rotationW[lane] = transform.rotation.w;
+    block.scaleX[lane] = transform.scale.x;
+    block.scaleY[lane] = transform.scale.y;
+    block.scaleZ[lane] = transform.scale.z;
+}
+
+void TransformStore::composeBlock(uint32_t blockIndex) {
+    const Block &block = blocks[blockIndex];
+    const glm::aligned_vec4 &x = block.rotationX, &y = block.rotationY, &z = block.rotationZ, &w = block.rotationW;
+    glm::aligned_vec4 xx = x * x, yy = y * y, zz = z * z;
+    glm::aligned_vec4 xy = x * y, xz = x * z, yz = y * z;
+    glm::aligned_vec4 wx = w * x, wy = w * y, wz = w * z;
+    glm::aligned_vec4 one{1.0f}, two{2.0f};
+
+    // rotation columns as glm::mat4_cast lays them out, each scaled by its axis
+    glm::aligned_vec4 c0x = (one - two * (yy + zz)) * block.scaleX;
+    glm::aligned_vec4 c0y = two * (xy + wz) * block.scaleX;
+    glm::aligned_vec4 c0z = two * (xz - wy) * block.scaleX;
+    glm::aligned_vec4 c1x = two * (xy - wz) * block.scaleY;
+    glm::aligned_vec4 c1y = (one - two * (xx + zz)) * block.scaleY;
+    glm::aligned_vec4 c1z = two * (yz + wx) * block.scaleY;
+    glm::aligned_vec4 c2x = two * (xz + wy) * block.scaleZ;
+    glm::aligned_vec4 c2y = two * (yz - wx) * block.scaleZ;
+    glm::aligned_vec4 c2z = (one - two * (xx + yy)) * block.scaleZ;
+
+    uint32_t first = blockIndex * 4;
+    uint32_t lanes = min(4u, static_cast<uint32_t>(local.size()) - first);
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        local[first + lane] = glm::aligned_mat4(c0x[lane], c0y[lane], c0z[lane], 0.0f,
+                                                c1x[lane], c1y[lane], c1z[lane], 0.0f,
+                                                c2x[lane], c2y[lane], c2z[lane], 0.0f,
+                                                block.positionX[lane], block.positionY[lane], block.positionZ[lane], 1.0f);
+    }
+}
+
+uint32_t TransformStore::updateRange(uint32_t begin, uint32_t end) {
+    uint32_t recomputed = 0;
+    for (uint32_t position = begin; position < end; position++) {
+        uint32_t parent = parents[position];
+        // the parent level is done, so its version tells whether it moved in this update
+        bool parentChanged = parent != noParent && changedVersions[parent] == version;
+        if (!localDirty[position] && !parentChanged) {
+            continue;
+        }
+        world[position] = parent == noParent ? local[position] : world[parent] * local[position];
+        changedVersions[position] = version;
+        localDirty[position] = 0;
+        recomputed++;
+    }
+    return recomputed;
+}
+
+uint32_t TransformStore::update(vkJobs::JobSystem *jobs) {
+    PROFILE_ZONE("update transforms");
+    if (!ordered) {
+        reorder();
+    }
+    version++;
+
+    auto compose = [this](uint32_t begin, uint32_t end) {
+        for (uint32_t block = begin; block < end; block++) {
+            uint32_t first = block * 4;
+            uint32_t last = min(first + 4, static_cast<uint32_t>(localDirty.size()));
+            if (any_of(localDirty.begin() + first, localDirty.begin() + last, [](uint8_t dirty) { return dirty != 0; })) {
+                composeBlock(block);
+            }
+        }
+    };
+    uint32_t blockCount = static_cast<uint32_t>(blocks.size());
+    if (jobs != nullptr && blockCount > composeGrain) {
+        jobs->parallelFor(blockCount, composeGrain, compose);
+    } else {
+        compose(0, blockCount);
+    }
+
+    // a level only reads the world matrices of the one before it
+    atomic<uint32_t> recomputed{0};
+    for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+        uint32_t begin = levelStarts[level];
+        uint32_t count = levelStarts[level + 1] - begin;
+        if (jobs != nullptr && count > updateGrain) {
+            jobs->parallelFor(count, updateGrain, [this, begin, &recomputed](uint32_t first, uint32_t last) {
+                recomputed.fetch_add(updateRange(begin + first, begin + last), memory_order_relaxed);
+            });
+        } else {
+            recomputed.fetch_add(updateRange(begin, begin + count), memory_order_relaxed);
+        }
+    }
+    lastRecomputed = recomputed.load();
+    return lastRecomputed;
+}
+
+uint32_t TransformStore::writeChanged(glm::mat4 *out, uint64_t &writtenVersion) const {
+    PROFILE_ZONE("write transforms");
+    uint32_t written = 0;
+    for (uint32_t position = 0; position < nodeIds.size(); position++) {
+        if (nodeIds[position] != noParent && changedVersions[position] > writtenVersion) {
+            memcpy(out + nodeIds[position], &world[position], sizeof(glm::mat4));
+            written++;
+        }
+    }
+    writtenVersion = version;
+    return written;
+}
+
+void TransformStore::reorder() {
+    PROFILE_ZONE("reorder transforms");
+    vector<uint32_t> order;
+    order.reserve(size());
+    for (uint32_t position = 0; position < nodeIds.size(); position++) {
+        if (nodeIds[position] != noParent) {
+            order.push_back(position);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+    vector<uint32_t> newPositions(nodeIds.size(), noParent);
+    for (uint32_t position = 0; position < order.size(); position++) {
+        newPositions[order[position]] = position;
+    }
+
+    vector<Block> sortedBlocks((order.size() + 3) / 4, emptyBlock());
+    vector<glm::aligned_mat4> sortedLocal(order.size()), sortedWorld(order.size());
+    vector<uint32_t> sortedParents(order.size()), sortedDepths(order.size());
+    vector<NodeId> sortedIds(order.size());
+    vector<uint8_t> sortedDirty(order.size());
+    vector<uint64_t> sortedVersions(order.size());
+    for (uint32_t position = 0; position < order.size(); position++) {
+        uint32_t old = order[position];
+        copyLane(sortedBlocks[position / 4], position % 4, blocks[old / 4], old % 4);
+        sortedLocal[position] = local[old];
+        sortedWorld[position] = world[old];
+        // a destroyed parent took its children with it
+        sortedParents[position] = parents[old] == noParent ? noParent : newPositions[parents[old]];
+        sortedDepths[position] = depths[old];
+        sortedIds[position] = nodeIds[old];
+        sortedDirty[position] = localDirty[old];
+        sortedVersions[position] = changedVersions[old];
+        indices[nodeIds[old]] = position;
+    }
+    blocks = std::move(sortedBlocks);
+    local = std::move(sortedLocal);
+    world = std::move(sortedWorld);
+    parents = std::move(sortedParents);
+    depths = std::move(sortedDepths);
+    nodeIds = std::move(sortedIds);
+    localDirty = std::move(sortedDirty);
+    changedVersions = std::move(sortedVersions);
+
+    // every depth up to the deepest node is populated, its parent is one level up
+    uint32_t levelCount = depths.empty() ? 0 : depths.back() + 1;
+    levelStarts.assign(levelCount + 1, 0);
+    for (uint32_t depth : depths) {
+        levelStarts[depth + 1]++;
+    }
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levelStarts[level + 1] += levelStarts[level];
+    }
+    ordered = true;
+    deadCount = 0;
+}
+
+void TransformStore::printStats(ostream &out) const {
+    out << "transforms : " << size() << " / " << maxNodes << " nodes, " << levelStarts.size() - 1 << " levels, " << lastRecomputed
+        << " recomputed by the last update" << endl;
+}
+} // namespace vkScene
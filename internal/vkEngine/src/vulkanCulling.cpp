@@ -0,0 +1,25 @@
+#include "headers/engine.hpp"
+
+using namespace std;
+
+void GEngine::createDrawCuller() {
+    PROFILE_ZONE("createDrawCuller");
+    VkShaderModule cullShader = VK_NULL_HANDLE;
+    if (!config.cpuCulling && shaderArchive && shaderArchive->contains("cull.comp")) {
+        cullShader = createShaderModule("cull.comp");
+    }
+    // culled while recording, the staging buffers it retires are read by the frame being recorded
+    auto retire = [this](function<void()> destroy) { retireAfterRecordedFrame(std::move(destroy)); };
+    drawCuller = make_unique<vkCulling::DrawCuller>(device, capabilities, *gpuAllocator, hostAllocator.callbacks(), retire,
+                                                    pipelineCache, cullShader, context->drawIndexedIndirectCount, config.maxDrawInstances,
+                                                    config.framesInFlight);
+    // the pipeline keeps what it needs
+    if (cullShader != VK_NULL_HANDLE) {
+        destroyShaderModule(cullShader);
+    }
+    cout << "draw culling on the " << vkCulling::pathName(drawCuller->path()) << " path" << endl;
+}
+
+vkCulling::DrawCuller &GEngine::getDrawCuller() {
+    return *drawCuller;
+}
@@ -1,9 +1,12 @@
+#include "headers/deviceCapabilities.hpp"
 #include "headers/engine.hpp"
 #include "headers/vkWSIHelpers.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstring>
 #include <headers/vulkanValidation.hpp>
-#include <optional>
-#include <set>
+#include <map>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -15,81 +18,141 @@ const vector<const char *> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
-struct QueueFamilyIndices {
-    std::optional<uint32_t> graphicsFamily;
-    std::optional<uint32_t> presentFamily;
+// headless devices never present, so they need no extensions at all
+const vector<const char *> &requiredDeviceExtensions(bool headless) {
+    static const vector<const char *> none{};
+    return headless ? none : deviceExtensions;
+}
+
+// score breakdown of a single physical device, the highest scoring suitable device is used
+struct DeviceScore {
+    std::string name;
+    bool suitable = true;
+    int64_t score = 0;
+    vector<string> reasons;
 
-    bool isComplete() {
-        return graphicsFamily.has_value() && presentFamily.has_value();
+    void add(int64_t points, const string &why) {
+        score += points;
+        reasons.push_back((points >= 0 ? "+" : "") + to_string(points) + " " + why);
+    }
+
+    void reject(const string &why) {
+        suitable = false;
+        reasons.push_back("rejected: " + why);
     }
 };
 
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, const VkSurfaceKHR &surface) {
-    // Logic to find graphics queue family
-    QueueFamilyIndices indices;
+int64_t deviceTypeScore(VkPhysicalDeviceType type) {
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return 10000;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return 4000;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return 2000;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return 500;
+    default:
+        return 0;
+    }
+}
 
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+const char *deviceTypeName(VkPhysicalDeviceType type) {
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return "discrete gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return "integrated gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return "virtual gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return "cpu";
+    default:
+        return "other";
+    }
+}
 
-    vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+// without a surface the swapchain support can only be checked once a session creates one
+DeviceScore scoreDevice(const DeviceCapabilities &caps, bool headless, bool hasSurface) {
+    const VkPhysicalDeviceProperties &deviceProperties = caps.properties;
+    const VkPhysicalDeviceFeatures &deviceFeatures = caps.features;
+    const VkPhysicalDeviceMemoryProperties &memoryProperties = caps.memoryProperties;
 
-    int i = 0;
-    for (const auto &queue : queueFamilies) {
-        if (queue.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
+    DeviceScore result;
+    result.name = deviceProperties.deviceName;
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
+    // hard requirements, headless runs never present so they only need graphics
+    const QueueFamilyIndices &indices = caps.queues;
+    if (!indices.isComplete(!headless)) {
+        result.reject(headless ? "no graphics queue" : "no graphics or present queue");
+    }
+    if (!headless) {
+        if (!caps.hasExtensions(deviceExtensions)) {
+            result.reject("missing swapchain extension");
+        } else if (hasSurface && (caps.swapChainSupport.formats.empty() || caps.swapChainSupport.presentModes.empty())) {
+            result.reject("inadequate swapchain support");
         }
+    }
 
-        if (indices.isComplete()) {
-            break;
+    // device type dominates, a cpu implementation should only win when nothing else is there
+    result.add(deviceTypeScore(deviceProperties.deviceType), string{"device type "} + deviceTypeName(deviceProperties.deviceType));
+
+    VkDeviceSize deviceLocalBytes = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            deviceLocalBytes = max(deviceLocalBytes, memoryProperties.memoryHeaps[i].size);
         }
-        i++;
     }
-    return indices;
-}
+    // 100 points per GiB of the largest device local heap, capped so vram never outweighs device type
+    int64_t vramMiB = static_cast<int64_t>(deviceLocalBytes / (1024 * 1024));
+    result.add(min<int64_t>(vramMiB * 100 / 1024, 3200), "device local heap " + to_string(vramMiB) + " MiB");
 
-bool checkDeviceExtensionSupport(VkPhysicalDevice device, const vector<const char *> &deviceExtensions) {
-    uint32_t extentionCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extentionCount, nullptr);
+    // queue family layout, dedicated transfer / compute families allow async work
+    if (indices.transferFamily.has_value()) {
+        result.add(300, "dedicated transfer queue family");
+    }
+    if (indices.computeFamily.has_value()) {
+        result.add(300, "async compute queue family");
+    }
+    if (!headless && indices.isComplete() && indices.graphicsFamily == indices.presentFamily) {
+        result.add(100, "graphics and present share a queue family");
+    }
 
-    vector<VkExtensionProperties> availableExtentions{extentionCount};
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extentionCount, availableExtentions.data());
+    // limits
+    const auto &limits = deviceProperties.limits;
+    result.add(limits.maxImageDimension2D / 1024 * 10, "max image dimension " + to_string(limits.maxImageDimension2D));
+    result.add(limits.maxComputeSharedMemorySize / 1024, "compute shared memory " + to_string(limits.maxComputeSharedMemorySize / 1024) + " KiB");
 
-    set<string> requiredExtensions{deviceExtensions.begin(), deviceExtensions.end()};
-    for (const auto &extention : availableExtentions) {
-        requiredExtensions.erase(extention.extensionName);
+    // optional features
+    if (deviceFeatures.multiDrawIndirect) {
+        result.add(100, "multiDrawIndirect");
+    }
+    if (deviceFeatures.geometryShader) {
+        result.add(50, "geometryShader");
+    }
+    if (deviceFeatures.samplerAnisotropy) {
+        result.add(50, "samplerAnisotropy");
+    }
+    if (deviceFeatures.textureCompressionBC) {
+        result.add(20, "textureCompressionBC");
     }
-    return requiredExtensions.empty();
-}
-
-tuple<bool, std::string> isDeviceSuitable(VkPhysicalDevice device, const VkSurfaceKHR &surface) {
-    VkPhysicalDeviceProperties deviceProperties;
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
-    bool isSuitable = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-                      deviceFeatures.geometryShader;
-    isSuitable &= findQueueFamilies(device, surface).isComplete();
-    isSuitable &= checkDeviceExtensionSupport(device, deviceExtensions);
+    return result;
+}
 
-    bool swapChainAdequete = false;
-    if (isSuitable) {
-        vkWSIHelper::SwapChainSupportDetails swapChainSupport = vkWSIHelper::querySwapChainSupport(device, surface);
-        swapChainAdequete = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+// the override is either a device index or a case sensitive substring of the device name
+bool matchesDeviceOverride(const string &deviceOverride, size_t index, const string &name) {
+    if (!deviceOverride.empty() && all_of(deviceOverride.begin(), deviceOverride.end(), ::isdigit)) {
+        // an index too large to parse names no device, a bad PRAGMA_DEVICE must not abort startup
+        size_t parsed = 0;
+        auto [end, error] = from_chars(deviceOverride.data(), deviceOverride.data() + deviceOverride.size(), parsed);
+        return error == errc{} && end == deviceOverride.data() + deviceOverride.size() && parsed == index;
     }
-    isSuitable &= swapChainAdequete;
-
-    return {isSuitable, deviceProperties.deviceName};
+    return name.find(deviceOverride) != string::npos;
 }
 
-void GEngine::pickPhysicalDevice() {
+void EngineContext::pickPhysicalDevice(VkSurfaceKHR surface) {
+    PROFILE_ZONE("pickPhysicalDevice");
     this->physicalDevice = VK_NULL_HANDLE;
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -99,41 +162,116 @@ void GEngine::pickPhysicalDevice() {
     vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    for (const auto &d : devices) {
+    // the environment wins over the config so a single run can be redirected
+    string deviceOverride = config.preferredDevice;
+    if (const char *env = getenv("PRAGMA_DEVICE"); env != nullptr && env[0] != '\0') {
+        deviceOverride = env;
+    }
+
+    // the queries of one device do not depend on any other, so every device is asked on its own job
+    vector<DeviceCapabilities> allCaps(devices.size());
+    jobSystem->parallelFor(deviceCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            allCaps[i] = queryDeviceCapabilities(devices[i], surface);
+        }
+    });
+    // sessions create their surfaces later, glfw knows whether the graphics family will be able to present to them
+    bool headless = !config.presentable;
+    if (!headless && surface == VK_NULL_HANDLE) {
+        for (size_t i = 0; i < devices.size(); i++) {
+            auto &queues = allCaps[i].queues;
+            if (queues.graphicsFamily.has_value() &&
+                glfwGetPhysicalDevicePresentationSupport(instance, devices[i], queues.graphicsFamily.value()) == GLFW_TRUE) {
+                queues.presentFamily = queues.graphicsFamily;
+            }
+        }
+    }
+
+    vector<DeviceScore> scores;
+    for (size_t i = 0; i < devices.size(); i++) {
+        scores.push_back(scoreDevice(allCaps[i], headless, surface != VK_NULL_HANDLE));
+        const auto &score = scores.back();
+        cout << "device [" << i << "] " << score.name << " : score " << score.score
+             << (score.suitable ? "" : " (unsuitable)") << endl;
+        for (const auto &reason : score.reasons) {
+            cout << "\t" << reason << endl;
+        }
+    }
 
-        auto [suitable, deviceName] = isDeviceSuitable(d, surface);
+    size_t picked = devices.size();
+    if (!deviceOverride.empty()) {
+        for (size_t i = 0; i < devices.size(); i++) {
+            if (matchesDeviceOverride(deviceOverride, i, scores[i].name)) {
+                if (scores[i].suitable) {
+                    picked = i;
+                } else {
+                    cout << "device override '" << deviceOverride << "' matched unsuitable device " << scores[i].name << ", ignoring it" << endl;
+                }
+                break;
+            }
+        }
+        if (picked == devices.size()) {
+            cout << "device override '" << deviceOverride << "' not usable, falling back to scoring" << endl;
+        }
+    }
 
-        if (suitable) {
-            this->physicalDevice = d;
-            cout << "Picked suitable device : " << deviceName << endl;
-            break;
+    if (picked == devices.size()) {
+        for (size_t i = 0; i < devices.size(); i++) {
+            if (scores[i].suitable && (picked == devices.size() || scores[i].score > scores[picked].score)) {
+                picked = i;
+            }
         }
     }
 
-    if (this->physicalDevice == VK_NULL_HANDLE) {
+    if (picked == devices.size()) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+    this->physicalDevice = devices[picked];
+    this->capabilities = std::move(allCaps[picked]);
+    cout << "Picked suitable device : " << scores[picked].name << endl;
 }
 
-void GEngine::createLogicalDevice() {
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
+void EngineContext::createLogicalDevice() {
+    PROFILE_ZONE("createLogicalDevice");
+    const QueueFamilyIndices &indices = capabilities.queues;
+
+    // queues wanted per family, capped by what the family offers
+    map<uint32_t, uint32_t> familyQueueCounts;
+    auto want = [&](uint32_t family, uint32_t count) {
+        uint32_t available = indices.queueCounts[family];
+        familyQueueCounts[family] = min(max(familyQueueCounts[family], count), available);
+    };
+    // a second graphics queue stands in for the transfer queue when there is no dedicated family
+    want(indices.graphicsFamily.value(), indices.transferFamily.has_value() ? 1 : 2);
+    if (config.presentable) {
+        want(indices.presentFamily.value(), 1);
+    }
+    // uploads and async compute are submitted to the first queue of their family only, more would sit unused
+    if (indices.transferFamily.has_value()) {
+        want(indices.transferFamily.value(), 1);
+    }
+    if (indices.computeFamily.has_value()) {
+        want(indices.computeFamily.value(), 1);
+    }
 
     // define the queue
     vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    set<uint32_t> uniqueQueueFamalies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-
-    int i = 1;
-    float queuePriority = 1.0f;
-    for (auto queueFamily : uniqueQueueFamalies) {
+    vector<float> queuePriorities(*max_element(indices.queueCounts.begin(), indices.queueCounts.end()), 1.0f);
+    for (auto [queueFamily, queueCount] : familyQueueCounts) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = queueCount;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
         queueCreateInfos.push_back(queueCreateInfo);
     }
     // set device features
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = capabilities.features.shaderSampledImageArrayDynamicIndexing;
+    deviceFeatures.shaderStorageBufferArrayDynamicIndexing = capabilities.features.shaderStorageBufferArrayDynamicIndexing;
+    // gpu driven culling, see vkCulling::DrawCuller
+    deviceFeatures.multiDrawIndirect = capabilities.features.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = capabilities.features.drawIndirectFirstInstance;
 
     // create info
     VkDeviceCreateInfo createInfo{};
@@ -143,8 +281,43 @@ void GEngine::createLogicalDevice() {
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    vector<const char *> extensions = requiredDeviceExtensions(!config.presentable);
+    // lets the pipeline cache tell hits from misses
+    pipelineCreationFeedback = capabilities.hasExtension(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    if (pipelineCreationFeedback) {
+        extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    }
+    // lets assets be copied to the gpu straight out of their file mapping
+    bool hostImport = config.importHostMemory && capabilities.minImportedHostPointerAlignment > 0;
+    if (hostImport) {
+        extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+    // only what the bindless table uses, new slots are written while frames in flight still read the set
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexing{};
+    descriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    bindless = capabilities.supportsBindless();
+    if (bindless) {
+        descriptorIndexing.runtimeDescriptorArray = VK_TRUE;
+        descriptorIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptorIndexing.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        descriptorIndexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptorIndexing.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        createInfo.pNext = &descriptorIndexing;
+        extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+    memoryBudget = capabilities.hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    // lets the culling dispatch decide how many draws are issued
+    bool drawIndirectCount = capabilities.hasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (drawIndirectCount) {
+        extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     // add layer validation
     if (vkValidate::enable) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(vkValidate::validationLayers.size());
@@ -153,25 +326,66 @@ void GEngine::createLogicalDevice() {
         createInfo.enabledLayerCount = 0;
     }
 
-    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+    if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator.callbacks(), &device) != VK_SUCCESS) {
         throw std::runtime_error{"failed to create logical device!"};
     }
+    if (hostImport) {
+        getMemoryHostPointerProperties =
+            reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(vkGetDeviceProcAddr(device, "vkGetMemoryHostPointerPropertiesEXT"));
+    }
+    if (drawIndirectCount) {
+        drawIndexedIndirectCount =
+            reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicQueue);
-    vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    graphicsQueueFamily = indices.graphicsFamily.value();
+    if (config.presentable) {
+        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        presentQueueFamily = indices.presentFamily.value();
+    } else {
+        presentQueue = VK_NULL_HANDLE;
+    }
+
+    auto getQueues = [&](uint32_t family, uint32_t first) {
+        vector<VkQueue> queues;
+        for (uint32_t q = first; q < familyQueueCounts[family]; q++) {
+            queues.emplace_back();
+            vkGetDeviceQueue(device, family, q, &queues.back());
+        }
+        return queues;
+    };
+
+    // without dedicated families the work falls back to the graphics family, preferably on its own queue
+    transferQueueFamily = indices.transferFamily.value_or(graphicsQueueFamily);
+    transferQueues = getQueues(transferQueueFamily, indices.transferFamily.has_value() ? 0 : 1);
+    if (transferQueues.empty()) {
+        transferQueues.push_back(graphicQueue);
+    }
+    computeQueueFamily = indices.computeFamily.value_or(graphicsQueueFamily);
+    computeQueues = getQueues(computeQueueFamily, indices.computeFamily.has_value() ? 0 : familyQueueCounts[computeQueueFamily]);
+    if (computeQueues.empty()) {
+        computeQueues.push_back(graphicQueue);
+    }
+
     cout << "succsesfully created a logical device" << endl;
+    cout << "\tgraphics family " << graphicsQueueFamily << ", transfer family " << transferQueueFamily << " (" << transferQueues.size()
+         << " queues), compute family " << computeQueueFamily << " (" << computeQueues.size() << " queues)" << endl;
 }
 
 void GEngine::createSurface() {
-    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+    PROFILE_ZONE("createSurface");
+    if (glfwCreateWindowSurface(instance, window, hostAllocator.callbacks(), &surface) != VK_SUCCESS) {
         throw std::runtime_error{"failed to create window surface!"};
     }
 }
 
-void GEngine::createSwapChain() {
-    vkWSIHelper::SwapChainSupportDetails swapChainSupport = vkWSIHelper::querySwapChainSupport(physicalDevice, surface);
+void GEngine::createSwapChain(VkSwapchainKHR oldSwapChain) {
+    PROFILE_ZONE("createSwapChain");
+    // gathered with the device for the first swapchain, recreateSwapChain refreshes it
+    const vkWSIHelper::SwapChainSupportDetails &swapChainSupport = capabilities.swapChainSupport;
 
     VkSurfaceFormatKHR surfaceFormat = vkWSIHelper::chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = vkWSIHelper::chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = vkWSIHelper::chooseSwapPresentMode(swapChainSupport.presentModes, config.presentPolicy);
     VkExtent2D extent = vkWSIHelper::chooseSwapExtent(window, swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -179,7 +393,7 @@ void GEngine::createSwapChain() {
         imageCount = swapChainSupport.capabilities.maxImageCount;
     }
 
-    VkSwapchainCreateInfoKHR createInfo;
+    VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface = surface;
     createInfo.minImageCount = imageCount;
@@ -188,11 +402,22 @@ void GEngine::createSwapChain() {
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // frames are cleared with transfer commands
+    if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        throw std::runtime_error{"swap chain images do not support transfer writes!"};
+    }
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    // and copied out when they are read back
+    if (config.output.enabled()) {
+        if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            throw std::runtime_error{"swap chain images do not support transfer reads, frames can not be read back!"};
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
-    uint32_t QueueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    uint32_t QueueFamilyIndices[] = {graphicsQueueFamily, presentQueueFamily};
 
-    if (indices.graphicsFamily != indices.presentFamily) {
+    if (graphicsQueueFamily != presentQueueFamily) {
         createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
         createInfo.queueFamilyIndexCount = 2;
         createInfo.pQueueFamilyIndices = QueueFamilyIndices;
@@ -207,8 +432,9 @@ void GEngine::createSwapChain() {
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
-    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+    // handing over the old swapchain lets the driver reuse its resources
+    createInfo.oldSwapchain = oldSwapChain;
+    if (vkCreateSwapchainKHR(device, &createInfo, hostAllocator.callbacks(), &swapChain) != VK_SUCCESS) {
         throw std::runtime_error{"failed to create swap chain!"};
     }
 
@@ -220,12 +446,86 @@ void GEngine::createSwapChain() {
     this->swapChainImageFormat = surfaceFormat.format;
 }
 
+void GEngine::recreateSwapChain(bool surfaceLost) {
+    PROFILE_ZONE("recreateSwapChain");
+    // a minimized window has a zero sized framebuffer, wait until it is visible again
+    int framebufferWidth = 0, framebufferHeight = 0;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    while (framebufferWidth == 0 || framebufferHeight == 0) {
+        if (glfwWindowShouldClose(window)) {
+            return;
+        }
+        glfwWaitEvents();
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    }
+    framebufferResized = false;
+
+    // frames in flight may still use the old swapchain, so it is retired instead of waiting for the device to idle
+    VkSwapchainKHR oldSwapChain = swapChain;
+    vector<VkImageView> oldImageViews = swapChainImageViews;
+    vector<VkFramebuffer> oldFramebuffers = framebuffers;
+    vector<VkSemaphore> oldRenderFinished = renderFinished;
+    VkFormat oldFormat = swapChainImageFormat;
+    VkSurfaceKHR oldSurface = VK_NULL_HANDLE;
+    if (surfaceLost) {
+        oldSurface = surface;
+        createSurface();
+
+        VkBool32 presentSupport = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, presentQueueFamily, surface, &presentSupport);
+        if (!presentSupport) {
+            throw std::runtime_error{"recreated surface is not supported by the present queue!"};
+        }
+    }
+
+    // the extent and transform change with the window
+    capabilities.swapChainSupport = vkWSIHelper::querySwapChainSupport(physicalDevice, surface);
+    // a swapchain of a lost surface can not be handed over
+    createSwapChain(surfaceLost ? VK_NULL_HANDLE : oldSwapChain);
+    createImageViews();
+    // pipelines created against the render pass stay compatible as long as the format does
+    VkRenderPass oldRenderPass = VK_NULL_HANDLE;
+    if (swapChainImageFormat != oldFormat) {
+        oldRenderPass = renderPass;
+        createRenderPass();
+    }
+    createFramebuffers();
+    // presents of the old swapchain may still wait on its semaphores
+    createPresentSemaphores();
+    imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+    createFrameGraph();
+    createReadback();
+
+    retireAfterFrames([this, oldSwapChain, oldImageViews, oldFramebuffers, oldRenderFinished, oldRenderPass, oldSurface]() {
+        for (auto framebuffer : oldFramebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, hostAllocator.callbacks());
+        }
+        for (auto semaphore : oldRenderFinished) {
+            vkDestroySemaphore(device, semaphore, hostAllocator.callbacks());
+        }
+        if (oldRenderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device, oldRenderPass, hostAllocator.callbacks());
+        }
+        for (auto imageView : oldImageViews) {
+            vkDestroyImageView(device, imageView, hostAllocator.callbacks());
+        }
+        vkDestroySwapchainKHR(device, oldSwapChain, hostAllocator.callbacks());
+        if (oldSurface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(instance, oldSurface, hostAllocator.callbacks());
+        }
+    });
+    cout << "recreated swap chain (" << swapChainExtent.width << "x" << swapChainExtent.height << ")" << endl;
+}
+
 void GEngine::createImageViews() {
-    swapChainImageViews.resize(swapChainImages.size());
-    for (size_t i = 0; i < swapChainImages.size(); i++) {
+    PROFILE_ZONE("createImageViews");
+    // headless runs have no swapchain, the views then point at the offscreen targets
+    const auto &images = config.headless ? offscreenImages : swapChainImages;
+    swapChainImageViews.resize(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
         VkImageViewCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.image = swapChainImages[i];
+        createInfo.image = images[i];
         createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
         createInfo.format = swapChainImageFormat;
         createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -238,7 +538,7 @@ void GEngine::createImageViews() {
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.levelCount = 1;
 
-        if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i])) {
+        if (vkCreateImageView(device, &createInfo, hostAllocator.callbacks(), &swapChainImageViews[i])) {
             throw std::runtime_error{"failed to create image views!"};
         }
     }
@@ -0,0 +1,453 @@
+#include "headers/engine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+using frameClock = chrono::steady_clock;
+
+static double elapsedMs(frameClock::time_point since) {
+    return chrono::duration<double, milli>(frameClock::now() - since).count();
+}
+
+void FrameTiming::add(double ms) {
+    lastMs = ms;
+    maxMs = max(maxMs, ms);
+    totalMs += ms;
+    samples++;
+    if (keepHistory) {
+        history.push_back(static_cast<float>(ms));
+    }
+}
+
+double FrameTiming::averageMs(uint64_t frames) const {
+    return frames == 0 ? 0.0 : totalMs / static_cast<double>(frames);
+}
+
+const FrameStats &GEngine::getFrameStats() const {
+    return frameStats;
+}
+
+const vector<StartupStage> &GEngine::getStartupStages() const {
+    return startupStages;
+}
+
+const vector<VkImage> &GEngine::targetImages() const {
+    return config.headless ? offscreenImages : swapChainImages;
+}
+
+void GEngine::createCommandPool() {
+    PROFILE_ZONE("createCommandPool");
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = graphicsQueueFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create command pool!"};
+    }
+}
+
+void GEngine::createFrames() {
+    PROFILE_ZONE("createFrames");
+    frames.resize(max(config.framesInFlight, 1u));
+    imagesInFlight.assign(targetImages().size(), VK_NULL_HANDLE);
+
+    vector<VkCommandBuffer> commandBuffers(frames.size());
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to allocate command buffers!"};
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    // created signaled so the first use of each frame slot does not wait forever
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].commandBuffer = commandBuffers[i];
+        if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(), &frames[i].imageAvailable) != VK_SUCCESS ||
+            vkCreateFence(device, &fenceInfo, hostAllocator.callbacks(), &frames[i].inFlight) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create synchronization objects for a frame!"};
+        }
+    }
+
+    gpuProfiler = make_unique<vkProfiler::GpuProfiler>(physicalDevice, device, graphicsQueueFamily, static_cast<uint32_t>(frames.size()),
+                                                       hostAllocator.callbacks());
+    recorder = make_unique<vkCommand::ParallelRecorder>(device, graphicsQueueFamily, static_cast<uint32_t>(frames.size()), *jobSystem,
+                                                        hostAllocator.callbacks());
+}
+
+void GEngine::createFrameRing() {
+    PROFILE_ZONE("createFrameRing");
+    // staging for the transfer queue and data for the async compute queue come from the ring as well
+    frameRing = make_unique<vkMemory::FrameRing>(device, capabilities, *gpuAllocator, hostAllocator.callbacks(),
+                                                 VkDeviceSize{config.frameRingKiB} * 1024, static_cast<uint32_t>(frames.size()),
+                                                 vector<uint32_t>{graphicsQueueFamily, transferQueueFamily, computeQueueFamily});
+}
+
+vkMemory::FrameRing &GEngine::getFrameRing() {
+    return *frameRing;
+}
+
+void GEngine::destroyFrames() {
+    recorder.reset();
+    gpuProfiler.reset();
+    for (auto &frame : frames) {
+        vkDestroySemaphore(device, frame.imageAvailable, hostAllocator.callbacks());
+        vkDestroyFence(device, frame.inFlight, hostAllocator.callbacks());
+    }
+    frames.clear();
+    vkDestroyCommandPool(device, commandPool, hostAllocator.callbacks());
+}
+
+void GEngine::addRecordTask(vkCommand::RecordTask task) {
+    recordTasks.push_back(std::move(task));
+}
+
+VkRenderPass GEngine::getRenderPass() const {
+    return renderPass;
+}
+
+VkExtent2D GEngine::getTargetExtent() const {
+    return swapChainExtent;
+}
+
+void GEngine::createRenderPass() {
+    PROFILE_ZONE("createRenderPass");
+    // the frame graph clears the target and places the barriers around the pass, so it only keeps what is there
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = swapChainImageFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorReference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(device, &renderPassInfo, hostAllocator.callbacks(), &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create render pass!"};
+    }
+}
+
+void GEngine::createFramebuffers() {
+    PROFILE_ZONE("createFramebuffers");
+    framebuffers.resize(swapChainImageViews.size());
+    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &swapChainImageViews[i];
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, hostAllocator.callbacks(), &framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create framebuffer!"};
+        }
+    }
+}
+
+void GEngine::createPresentSemaphores() {
+    PROFILE_ZONE("createPresentSemaphores");
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    renderFinished.assign(config.headless ? 0 : swapChainImages.size(), VK_NULL_HANDLE);
+    for (auto &semaphore : renderFinished) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(), &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create a present semaphore!"};
+        }
+    }
+}
+
+void GEngine::retireAfterFrames(std::function<void()> destroy) {
+    retiredResources.push_back({frameNumber, std::move(destroy)});
+}
+
+void GEngine::retireAfterRecordedFrame(std::function<void()> destroy) {
+    retiredResources.push_back({frameNumber + 1, std::move(destroy)});
+}
+
+void GEngine::destroyRetired(bool all) {
+    // frames before retireFrame are done once the fence of frame retireFrame - 1 has been waited on,
+    // which happens when that frame slot comes around again
+    while (!retiredResources.empty() &&
+           (all || frameNumber + 1 >= retiredResources.front().retireFrame + frames.size())) {
+        retiredResources.front().destroy();
+        retiredResources.pop_front();
+    }
+}
+
+void GEngine::createFrameGraph() {
+    PROFILE_ZONE("createFrameGraph");
+    if (!frameGraph) {
+        // rebuilt between frames, so the old transients only wait for the frames already submitted
+        auto retire = [this](function<void()> destroy) { retireAfterFrames(std::move(destroy)); };
+        frameGraph = make_unique<vkGraph::RenderGraph>(device, *gpuAllocator, hostAllocator.callbacks(), retire);
+    }
+    frameGraph->clear();
+
+    // offscreen targets are left ready to be read back, swapchain images ready to present
+    vkGraph::ImageInfo targetInfo{swapChainImageFormat, swapChainExtent};
+    vkGraph::ResourceState initial{VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED};
+    vkGraph::ResourceState final{VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+    if (config.headless) {
+        final = {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+    }
+    targetResource = frameGraph->importImage("target", targetInfo, initial, final);
+
+    // the gpu paths leave the draws ready for the indirect draws of the next frame
+    bool gpuCulling = drawCuller->path() != vkCulling::CullPath::Cpu;
+    vkGraph::ResourceId drawResource = 0, countResource = 0;
+    if (gpuCulling) {
+        vkGraph::ResourceState indirect{VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+        drawResource = frameGraph->importBuffer("draw commands", indirect, indirect);
+        countResource = frameGraph->importBuffer("draw count", indirect, indirect);
+        frameGraph->setBuffer(drawResource, drawCuller->drawBuffer());
+        frameGraph->setBuffer(countResource, drawCuller->countBuffer());
+    }
+    frameGraph->addPass(
+        "cull",
+        [&](vkGraph::RenderGraph::PassBuilder &pass) {
+            if (!gpuCulling) {
+                pass.keepAlive();
+                return;
+            }
+            pass.write(drawResource, vkGraph::Access::ComputeStorageWrite);
+            pass.write(countResource, vkGraph::Access::TransferWrite);
+            pass.write(countResource, vkGraph::Access::ComputeStorageWrite);
+        },
+        [this](VkCommandBuffer commandBuffer) {
+            PROFILE_GPU_ZONE(*gpuProfiler, commandBuffer, "culling");
+            drawCuller->cull(commandBuffer, currentFrame);
+        });
+
+    frameGraph->addPass(
+        "clear", [&](vkGraph::RenderGraph::PassBuilder &pass) { pass.write(targetResource, vkGraph::Access::TransferWrite); },
+        [this](VkCommandBuffer commandBuffer) {
+            PROFILE_GPU_ZONE(*gpuProfiler, commandBuffer, "clear");
+            // cycle the clear color so consecutive frames are distinguishable
+            float t = static_cast<float>(frameNumber % 256) / 255.0f;
+            VkClearColorValue clearColor = {{t, 0.2f, 1.0f - t, 1.0f}};
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdClearColorImage(commandBuffer, frameGraph->image(targetResource), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1,
+                                 &range);
+        });
+    // tasks draw on top of the clear
+    frameGraph->addPass(
+        "record tasks",
+        [&](vkGraph::RenderGraph::PassBuilder &pass) {
+            pass.write(targetResource, vkGraph::Access::ColorAttachmentWrite);
+            if (gpuCulling) {
+                pass.read(drawResource, vkGraph::Access::IndirectRead);
+                pass.read(countResource, vkGraph::Access::IndirectRead);
+            }
+        },
+        [this](VkCommandBuffer commandBuffer) {
+            VkFramebuffer framebuffer = framebuffers[currentImage];
+            const auto &secondaries = recorder->record(currentFrame, renderPass, framebuffer, recordTasks);
+            if (secondaries.empty()) {
+                return;
+            }
+            PROFILE_GPU_ZONE(*gpuProfiler, commandBuffer, "record tasks");
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = framebuffer;
+            renderPassInfo.renderArea = {{0, 0}, swapChainExtent};
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+            vkCmdEndRenderPass(commandBuffer);
+        });
+    // kept alive, nothing later in the graph reads what it writes
+    if (config.output.enabled()) {
+        frameGraph->addPass(
+            "readback",
+            [&](vkGraph::RenderGraph::PassBuilder &pass) {
+                pass.read(targetResource, vkGraph::Access::TransferRead);
+                pass.keepAlive();
+            },
+            [this](VkCommandBuffer commandBuffer) {
+                PROFILE_GPU_ZONE(*gpuProfiler, commandBuffer, "readback");
+                readback->copy(commandBuffer, frameGraph->image(targetResource));
+            });
+    }
+    frameGraph->compile();
+}
+
+void GEngine::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    PROFILE_ZONE("recordCommandBuffer");
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to begin recording command buffer!"};
+    }
+    gpuProfiler->beginFrame(commandBuffer, currentFrame);
+    uint32_t frameZone = gpuProfiler->beginZone(commandBuffer, "frame");
+    recordCrossQueueAcquires(commandBuffer);
+    {
+        PROFILE_GPU_ZONE(*gpuProfiler, commandBuffer, "texture streaming");
+        textureStreamer->update(commandBuffer, frameNumber);
+    }
+
+    currentImage = imageIndex;
+    frameGraph->setImage(targetResource, targetImages()[imageIndex], swapChainImageViews[imageIndex]);
+    frameGraph->execute(commandBuffer);
+
+    gpuProfiler->endZone(commandBuffer, frameZone);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to record command buffer!"};
+    }
+}
+
+void GEngine::drawFrame() {
+    PROFILE_ZONE("drawFrame");
+    auto frameStart = frameClock::now();
+    FrameData &frame = frames[currentFrame];
+
+    auto waitStart = frameClock::now();
+    {
+        PROFILE_ZONE("waitForFence");
+        vkWaitForFences(device, 1, &frame.inFlight, VK_TRUE, UINT64_MAX);
+    }
+    double fenceWaitMs = elapsedMs(waitStart);
+    destroyRetired();
+    recorder->beginFrame(currentFrame);
+
+    uint32_t imageIndex;
+    if (config.headless) {
+        imageIndex = static_cast<uint32_t>(frameNumber % offscreenImages.size());
+    } else {
+        PROFILE_ZONE("acquire");
+        auto acquireStart = frameClock::now();
+        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+        frameStats.acquire.add(elapsedMs(acquireStart));
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_ERROR_SURFACE_LOST_KHR) {
+            // nothing was submitted for this frame slot, so its fence is still signaled
+            recreateSwapChain(result == VK_ERROR_SURFACE_LOST_KHR);
+            return;
+        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error{"failed to acquire swap chain image!"};
+        }
+    }
+    // only once the frame is sure to be submitted, a frame given up above runs its tasks and uploads when it is retried
+    frameRing->beginFrame(currentFrame);
+    prepareScene(currentFrame);
+
+    // the image may still be used by an older frame when there are fewer images than frames in flight
+    if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != frame.inFlight) {
+        waitStart = frameClock::now();
+        vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        fenceWaitMs += elapsedMs(waitStart);
+    }
+    imagesInFlight[imageIndex] = frame.inFlight;
+    frameStats.fenceWait.add(fenceWaitMs);
+
+    vkResetFences(device, 1, &frame.inFlight);
+    vkResetCommandBuffer(frame.commandBuffer, 0);
+    if (readback) {
+        readback->acquire(frameNumber);
+    }
+    recordCommandBuffer(frame.commandBuffer, imageIndex);
+    frameRing->flushFrame();
+    // the first frames of each slot have nothing resolved yet
+    if (gpuProfiler->enabled() && frameNumber >= frames.size()) {
+        frameStats.gpuFrame.add(gpuProfiler->lastFrameMs());
+    }
+
+    vector<VkSemaphore> waitSemaphores;
+    vector<VkPipelineStageFlags> waitStages;
+    if (!config.headless) {
+        waitSemaphores.push_back(frame.imageAvailable);
+        waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    for (const auto &work : pendingCrossQueueWork) {
+        waitSemaphores.push_back(work.semaphore);
+        waitStages.push_back(work.waitStage);
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    if (!config.headless) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &renderFinished[imageIndex];
+    }
+
+    {
+        PROFILE_ZONE("submit");
+        if (vkQueueSubmit(graphicQueue, 1, &submitInfo, frame.inFlight) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to submit draw command buffer!"};
+        }
+        if (readback) {
+            readback->submit(graphicQueue);
+        }
+    }
+    // the cross queue work is consumed by this frame and retires with it
+    vector<CrossQueueWork> consumedWork = std::move(pendingCrossQueueWork);
+    pendingCrossQueueWork.clear();
+
+    VkResult presentResult = VK_SUCCESS;
+    if (!config.headless) {
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &renderFinished[imageIndex];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &swapChain;
+        presentInfo.pImageIndices = &imageIndex;
+
+        PROFILE_ZONE("present");
+        presentResult = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
+
+    currentFrame = (currentFrame + 1) % frames.size();
+    frameNumber++;
+    frameStats.frameCount++;
+    if (frameStats.frameCount == 1) {
+        frameStats.timeToFirstFrameMs = elapsedMs(runStart);
+    }
+    for (auto &work : consumedWork) {
+        retireAfterFrames(std::move(work.destroy));
+    }
+
+    // recreate after the frame is counted, so the old swapchain outlives this frame too
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR ||
+        presentResult == VK_ERROR_SURFACE_LOST_KHR || framebufferResized) {
+        recreateSwapChain(presentResult == VK_ERROR_SURFACE_LOST_KHR);
+    } else if (presentResult != VK_SUCCESS) {
+        throw std::runtime_error{"failed to present swap chain image!"};
+    }
+    frameStats.cpuFrame.add(elapsedMs(frameStart));
+}
@@ -0,0 +1,115 @@
+#include "headers/engine.hpp"
+#include <bit>
+#include <cstdint>
+
+using namespace std;
+
+vkAssets::GpuMesh GEngine::loadMesh(const std::string &path) {
+    PROFILE_ZONE("loadMesh");
+    auto file = make_shared<const vkAssets::MeshFile>(path);
+    const auto &header = file->header();
+
+    vkAssets::GpuMesh mesh;
+    mesh.vertexCount = header.vertexCount;
+    mesh.indexCount = header.indexCount;
+    mesh.meshletCount = header.meshletCount;
+    mesh.bounds = header.bounds;
+    for (uint32_t s = 0; s < meshFormat::StreamCount; s++) {
+        mesh.streams[s] = {header.streams[s].offset - header.payloadOffset, header.streams[s].size};
+    }
+
+    mesh.allocation = createBuffer(header.payloadSize,
+                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.buffer);
+
+    VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    VkPipelineStageFlags dstStage =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    // the import keeps the mapping alive until the copy has retired
+    shared_ptr<const MappedFile> mapping{file, &file->mapping()};
+    if (!copyFromHostMapping(mapping, header.payloadOffset, mesh.buffer, 0, header.payloadSize, dstAccess, dstStage)) {
+        // memcpy from the mapping into the persistently mapped staging ring, no copy in between
+        uploadBuffer(mesh.buffer, 0, file->payload(), header.payloadSize, dstAccess, dstStage);
+    }
+    return mesh;
+}
+
+void GEngine::destroyMesh(const vkAssets::GpuMesh &mesh) {
+    destroyBuffer(mesh.buffer, mesh.allocation);
+}
+
+bool GEngine::copyFromHostMapping(shared_ptr<const MappedFile> file, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset,
+                                  VkDeviceSize size, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage) {
+    if (context->getMemoryHostPointerProperties == nullptr) {
+        return false;
+    }
+    // the whole mapping is imported, its start is page aligned and asset files are padded to whole pages
+    VkDeviceSize alignment = capabilities.minImportedHostPointerAlignment;
+    void *hostPointer = const_cast<std::byte *>(file->data());
+    if (reinterpret_cast<uintptr_t>(hostPointer) % alignment != 0 || file->size() % alignment != 0) {
+        return false;
+    }
+
+    VkMemoryHostPointerPropertiesEXT pointerProperties{};
+    pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if (context->getMemoryHostPointerProperties(device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, hostPointer,
+                                                &pointerProperties) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkExternalMemoryBufferCreateInfo externalInfo{};
+    externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = &externalInfo;
+    bufferInfo.size = file->size();
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer importBuffer;
+    if (vkCreateBuffer(device, &bufferInfo, hostAllocator.callbacks(), &importBuffer) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, importBuffer, &requirements);
+    uint32_t typeBits = requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+    VkImportMemoryHostPointerInfoEXT importInfo{};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = hostPointer;
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &importInfo;
+    allocInfo.allocationSize = file->size();
+    allocInfo.memoryTypeIndex = typeBits != 0 ? static_cast<uint32_t>(countr_zero(typeBits)) : 0;
+
+    // some drivers refuse read only file mappings, the staging path handles those
+    VkDeviceMemory importMemory = VK_NULL_HANDLE;
+    if (typeBits == 0 || vkAllocateMemory(device, &allocInfo, hostAllocator.callbacks(), &importMemory) != VK_SUCCESS ||
+        vkBindBufferMemory(device, importBuffer, importMemory, 0) != VK_SUCCESS) {
+        if (importMemory != VK_NULL_HANDLE) {
+            vkFreeMemory(device, importMemory, hostAllocator.callbacks());
+        }
+        vkDestroyBuffer(device, importBuffer, hostAllocator.callbacks());
+        return false;
+    }
+
+    submitCrossQueue(
+        transferQueues[0], transferQueueFamily, transferCommandPool,
+        [&](VkCommandBuffer commandBuffer) {
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = srcOffset;
+            copyRegion.dstOffset = dstOffset;
+            copyRegion.size = size;
+            vkCmdCopyBuffer(commandBuffer, importBuffer, dst, 1, &copyRegion);
+        },
+        {{dst, dstOffset, size, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccess}}, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+        // holding the file keeps the imported pages mapped until the copy retired
+        [this, importBuffer, importMemory, file]() {
+            vkDestroyBuffer(device, importBuffer, hostAllocator.callbacks());
+            vkFreeMemory(device, importMemory, hostAllocator.callbacks());
+        });
+    return true;
+}
@@ -0,0 +1,59 @@
+#include "headers/engine.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// format used for headless render targets, supported as color attachment + transfer on every implementation
+const VkFormat offscreenFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+void GEngine::createOffscreenTargets() {
+    PROFILE_ZONE("createOffscreenTargets");
+    offscreenImages.resize(config.offscreenImageCount);
+    offscreenImageMemory.resize(config.offscreenImageCount);
+
+    for (uint32_t i = 0; i < config.offscreenImageCount; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = offscreenFormat;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &imageInfo, hostAllocator.callbacks(), &offscreenImages[i]) != VK_SUCCESS) {
+            throw std::runtime_error{"failed to create offscreen image!"};
+        }
+        offscreenImageMemory[i] = gpuAllocator->allocateImage(offscreenImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    this->swapChainExtent = {width, height};
+    this->swapChainImageFormat = offscreenFormat;
+    cout << "created " << config.offscreenImageCount << " offscreen targets (" << width << "x" << height << ")" << endl;
+}
+
+void GEngine::createReadback() {
+    PROFILE_ZONE("createReadback");
+    if (!config.output.enabled()) {
+        return;
+    }
+    // a recreated target keeps the output, truncating it again would lose the frames written so far
+    if (readback) {
+        readback->resize(swapChainImageFormat, swapChainExtent);
+        return;
+    }
+    // a slot for every frame in flight and every encoding one, so writing out never waits on the gpu
+    vkOutput::OutputConfig output = config.output;
+    output.slots = max(output.slots, static_cast<uint32_t>(frames.size()) + max(output.encoderThreads, 1u));
+    readback = make_unique<vkOutput::FrameReadback>(device, capabilities, *gpuAllocator, hostAllocator.callbacks(), swapChainImageFormat,
+                                                    swapChainExtent, output);
+    cout << "reading back frames to " << (output.fd >= 0 ? "fd " + to_string(output.fd) : output.path) << " as "
+         << vkOutput::formatName(output.format) << " (" << output.slots << " slots, " << max(output.encoderThreads, 1u) << " encoders)"
+         << endl;
+}
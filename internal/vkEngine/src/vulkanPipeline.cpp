@@ -0,0 +1,36 @@
+#include "headers/engine.hpp"
+#include <filesystem>
+
+using namespace std;
+
+void EngineContext::createPipelineCache() {
+    PROFILE_ZONE("createPipelineCache");
+    pipelineCache = make_unique<vkPipeline::PipelineCache>(physicalDevice, device, hostAllocator.callbacks(),
+                                                           config.pipelineCachePath, pipelineCreationFeedback);
+}
+
+vkPipeline::PipelineCache &GEngine::getPipelineCache() {
+    return *pipelineCache;
+}
+
+void EngineContext::loadShaderArchive() {
+    PROFILE_ZONE("loadShaderArchive");
+    // the engine itself does not need shaders yet, so a missing archive is not fatal
+    if (!filesystem::exists(config.shaderArchivePath)) {
+        cout << "no shader archive at " << config.shaderArchivePath << endl;
+        return;
+    }
+    shaderArchive = make_unique<vkPipeline::ShaderArchive>(config.shaderArchivePath);
+    cout << "mapped shader archive " << config.shaderArchivePath << " (" << shaderArchive->shaderCount() << " shaders)" << endl;
+}
+
+VkShaderModule GEngine::createShaderModule(string_view name) {
+    if (!shaderArchive) {
+        throw std::runtime_error{"no shader archive loaded!"};
+    }
+    return shaderArchive->createShaderModule(device, name, hostAllocator.callbacks());
+}
+
+void GEngine::destroyShaderModule(VkShaderModule module) {
+    vkDestroyShaderModule(device, module, hostAllocator.callbacks());
+}
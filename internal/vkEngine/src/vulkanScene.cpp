@@ -0,0 +1,62 @@
+#include "headers/engine.hpp"
+
+using namespace std;
+
+void GEngine::createInstanceBuffers() {
+    PROFILE_ZONE("createInstanceBuffers");
+    transformStore = make_unique<vkScene::TransformStore>(config.maxDrawInstances);
+    // written by the cpu every frame and read once by the gpu, host visible memory is the better place than a staging copy
+    VkDeviceSize size = VkDeviceSize{max(config.maxDrawInstances, 1u)} * sizeof(glm::mat4);
+    for (auto &frame : frames) {
+        frame.instanceMemory = createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.instanceBuffer);
+        frame.transformVersion = 0;
+    }
+}
+
+void GEngine::destroyInstanceBuffers() {
+    for (auto &frame : frames) {
+        destroyBuffer(frame.instanceBuffer, frame.instanceMemory);
+    }
+    transformStore.reset();
+}
+
+void GEngine::createDrawQueue() {
+    PROFILE_ZONE("createDrawQueue");
+    drawQueue = make_unique<vkDraw::DrawQueue>(device, *gpuAllocator, hostAllocator.callbacks(), config.maxDrawInstances,
+                                               static_cast<uint32_t>(frames.size()));
+}
+
+void GEngine::addFrameTask(function<void(uint64_t)> task) {
+    frameTasks.push_back(std::move(task));
+}
+
+void GEngine::prepareScene(uint32_t frameIndex) {
+    PROFILE_ZONE("prepareScene");
+    preparingFrame = true;
+    for (const auto &task : frameTasks) {
+        task(frameNumber);
+    }
+    preparingFrame = false;
+    // the fence of this frame slot has been waited on, the gpu is done reading its matrices and instances
+    FrameData &frame = frames[frameIndex];
+    transformStore->update(jobSystem);
+    transformStore->writeChanged(static_cast<glm::mat4 *>(frame.instanceMemory.mapped), frame.transformVersion);
+    drawQueue->sort(frameIndex);
+}
+
+vkScene::TransformStore &GEngine::getTransformStore() {
+    return *transformStore;
+}
+
+VkBuffer GEngine::getInstanceBuffer() const {
+    return frames[currentFrame].instanceBuffer;
+}
+
+uint32_t GEngine::getFrameIndex() const {
+    return currentFrame;
+}
+
+vkDraw::DrawQueue &GEngine::getDrawQueue() {
+    return *drawQueue;
+}
@@ -0,0 +1,38 @@
+#include "headers/engine.hpp"
+
+using namespace std;
+
+void GEngine::createBindlessTable() {
+    PROFILE_ZONE("createBindlessTable");
+    if (!context->bindless) {
+        cout << "descriptor indexing is not supported, bindless table disabled" << endl;
+        return;
+    }
+    // the frame being recorded may still read a released slot
+    auto retire = [this](function<void()> recycle) { retireAfterRecordedFrame(std::move(recycle)); };
+    bindlessTable = make_unique<vkDescriptors::BindlessTable>(device, capabilities, hostAllocator.callbacks(), retire);
+}
+
+void GEngine::createTextureStreamer() {
+    PROFILE_ZONE("createTextureStreamer");
+    // the frame being recorded still copies from what the streamer retires, so it waits for that frame too
+    auto retire = [this](function<void()> destroy) { retireAfterRecordedFrame(std::move(destroy)); };
+    textureStreamer = make_unique<vkAssets::TextureStreamer>(physicalDevice, device, *gpuAllocator, hostAllocator.callbacks(), retire,
+                                                             context->memoryBudget, VkDeviceSize{config.textureBudgetMiB} * 1024 * 1024,
+                                                             bindlessTable.get());
+}
+
+vkAssets::TextureStreamer &GEngine::getTextureStreamer() {
+    return *textureStreamer;
+}
+
+bool GEngine::hasBindless() const {
+    return bindlessTable != nullptr;
+}
+
+vkDescriptors::BindlessTable &GEngine::getBindlessTable() {
+    if (!bindlessTable) {
+        throw std::runtime_error{"bindless descriptors are not supported by this device!"};
+    }
+    return *bindlessTable;
+}
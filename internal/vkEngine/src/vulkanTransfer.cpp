@@ -0,0 +1,205 @@
+#include "headers/engine.hpp"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// uploads up to this size stage through the frame ring when they come from a frame task
+static constexpr VkDeviceSize ringUploadLimit = 64 * 1024;
+
+void EngineContext::createAllocator() {
+    PROFILE_ZONE("createAllocator");
+    gpuAllocator = std::make_unique<vkMemory::Allocator>(physicalDevice, device, hostAllocator.callbacks());
+}
+
+vkMemory::Allocation GEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                           VkBuffer &buffer, vkMemory::Strategy strategy) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, hostAllocator.callbacks(), &buffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create buffer!"};
+    }
+    return gpuAllocator->allocateBuffer(buffer, properties, strategy);
+}
+
+void GEngine::destroyBuffer(VkBuffer buffer, const vkMemory::Allocation &allocation) {
+    vkDestroyBuffer(device, buffer, hostAllocator.callbacks());
+    gpuAllocator->free(allocation);
+}
+
+std::vector<vkMemory::HeapStats> GEngine::getMemoryStats() const {
+    return gpuAllocator->getHeapStats();
+}
+
+void GEngine::createQueueCommandPools() {
+    PROFILE_ZONE("createQueueCommandPools");
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // every cross queue command buffer is recorded once and freed when its frame retires
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    poolInfo.queueFamilyIndex = transferQueueFamily;
+    if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &transferCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create transfer command pool!"};
+    }
+    poolInfo.queueFamilyIndex = computeQueueFamily;
+    if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(), &computeCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create compute command pool!"};
+    }
+}
+
+void GEngine::destroyQueueCommandPools() {
+    // work that never got picked up by a frame, the device is idle at this point
+    for (auto &work : pendingCrossQueueWork) {
+        work.destroy();
+    }
+    pendingCrossQueueWork.clear();
+    vkDestroyCommandPool(device, transferCommandPool, hostAllocator.callbacks());
+    vkDestroyCommandPool(device, computeCommandPool, hostAllocator.callbacks());
+}
+
+void GEngine::submitCrossQueue(VkQueue queue, uint32_t queueFamily, VkCommandPool pool,
+                               const std::function<void(VkCommandBuffer)> &record, const std::vector<BufferHandoff> &handoffs,
+                               VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, std::function<void()> destroy) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to allocate command buffers!"};
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    record(commandBuffer);
+
+    // buffers are exclusive to one family, hand them to the graphics family with a release / acquire pair.
+    // the written ranges are fully overwritten, so the graphics family never has to release them first
+    vector<VkBufferMemoryBarrier> releaseBarriers, acquireBarriers;
+    if (queueFamily != graphicsQueueFamily) {
+        for (const auto &handoff : handoffs) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = queueFamily;
+            barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+            barrier.buffer = handoff.buffer;
+            barrier.offset = handoff.offset;
+            barrier.size = handoff.size;
+
+            barrier.srcAccessMask = handoff.srcAccess;
+            barrier.dstAccessMask = 0;
+            releaseBarriers.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = handoff.dstAccess;
+            acquireBarriers.push_back(barrier);
+        }
+    }
+    if (!releaseBarriers.empty()) {
+        vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                             0, nullptr, static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(), 0, nullptr);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to record cross queue command buffer!"};
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(), &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to create cross queue semaphore!"};
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &semaphore;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error{"failed to submit cross queue work!"};
+    }
+
+    pendingCrossQueueWork.push_back({semaphore, dstStage, std::move(acquireBarriers),
+                                     [this, pool, commandBuffer, semaphore, destroy = std::move(destroy)]() {
+                                         vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+                                         vkDestroySemaphore(device, semaphore, hostAllocator.callbacks());
+                                         if (destroy) {
+                                             destroy();
+                                         }
+                                     }});
+}
+
+void GEngine::recordCrossQueueAcquires(VkCommandBuffer commandBuffer) {
+    vector<VkBufferMemoryBarrier> acquireBarriers;
+    VkPipelineStageFlags dstStages = 0;
+    for (const auto &work : pendingCrossQueueWork) {
+        acquireBarriers.insert(acquireBarriers.end(), work.acquireBarriers.begin(), work.acquireBarriers.end());
+        dstStages |= work.waitStage;
+    }
+    if (acquireBarriers.empty()) {
+        return;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0,
+                         0, nullptr, static_cast<uint32_t>(acquireBarriers.size()), acquireBarriers.data(), 0, nullptr);
+}
+
+void GEngine::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size,
+                           VkAccessFlags dstAccess, VkPipelineStageFlags dstStage) {
+    PROFILE_ZONE("uploadBuffer");
+    // small uploads of a frame task stage through the frame ring, the frame being prepared waits for the copy
+    // and the ring region is only rewound after that frame's fence. Anything else gets its own staging buffer,
+    // released in frame order, which is exactly what the ring strategy is for
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset = 0;
+    std::function<void()> destroy = []() {};
+    vkMemory::RingSlice slice;
+    if (preparingFrame && size <= ringUploadLimit && frameRing->tryAllocate(size, 16, slice)) {
+        memcpy(slice.mapped, data, static_cast<size_t>(size));
+        frameRing->flush(slice);
+        stagingBuffer = slice.buffer;
+        stagingOffset = slice.offset;
+    } else {
+        vkMemory::Allocation stagingAllocation = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                              stagingBuffer, vkMemory::Strategy::Linear);
+        memcpy(stagingAllocation.mapped, data, static_cast<size_t>(size));
+        destroy = [this, stagingBuffer, stagingAllocation]() {
+            destroyBuffer(stagingBuffer, stagingAllocation);
+        };
+    }
+
+    submitCrossQueue(
+        transferQueues[0], transferQueueFamily, transferCommandPool,
+        [&](VkCommandBuffer commandBuffer) {
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = dstOffset;
+            copyRegion.size = size;
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, dst, 1, &copyRegion);
+        },
+        {{dst, dstOffset, size, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccess}}, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, std::move(destroy));
+}
+
+void GEngine::submitAsyncCompute(const std::function<void(VkCommandBuffer)> &record, const std::vector<VkBuffer> &writtenBuffers,
+                                 VkAccessFlags dstAccess, VkPipelineStageFlags dstStage) {
+    PROFILE_ZONE("submitAsyncCompute");
+    vector<BufferHandoff> handoffs;
+    for (auto buffer : writtenBuffers) {
+        handoffs.push_back({buffer, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, dstAccess});
+    }
+    submitCrossQueue(computeQueues[0], computeQueueFamily, computeCommandPool, record, handoffs,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, nullptr);
+}
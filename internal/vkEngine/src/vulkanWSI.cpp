@@ -40,12 +40,25 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
     return availableFormats[0];
 }
 
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    for (const auto &availablePresentMod : availablePresentModes) {
-        if (availablePresentMod == VK_PRESENT_MODE_FIFO_KHR) {
-            return availablePresentMod;
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes, PresentPolicy policy) {
+    vector<VkPresentModeKHR> preferred;
+    switch (policy) {
+    case PresentPolicy::LowLatency:
+        preferred = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+        break;
+    case PresentPolicy::Throughput:
+        preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+        break;
+    case PresentPolicy::VSync:
+        break;
+    }
+
+    for (auto mode : preferred) {
+        if (find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()) {
+            return mode;
         }
     }
+    // FIFO is the only mode the spec guarantees
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
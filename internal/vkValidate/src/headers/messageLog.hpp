@@ -0,0 +1,114 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace vkValidate {
+
+enum class Severity : uint32_t {
+    Verbose,
+    Info,
+    Warning,
+    Error,
+};
+constexpr uint32_t severityCount = 4;
+
+Severity toSeverity(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+
+struct MessageCounts {
+    uint64_t bySeverity[severityCount] = {};
+    // printed after deduplication and rate limiting
+    uint64_t printed = 0;
+    uint64_t duplicates = 0;
+    uint64_t rateLimited = 0;
+    // the queue was full, these never reached the logger
+    uint64_t dropped = 0;
+};
+
+// Validation messages are pushed from whatever driver thread reports them onto a lock free
+// multi producer queue, a background thread formats and prints them. The same message id
+// printing the same text again is only counted, and every id prints at most maxPerSecond
+// messages a second, the rest is summed up once the second is over.
+class MessageLog {
+public:
+    explicit MessageLog(std::ostream &out, uint32_t maxPerSecond = 5, uint32_t maxQueued = 4096);
+    // prints what is still queued and a summary of the suppressed ids
+    ~MessageLog();
+    MessageLog(const MessageLog &) = delete;
+    MessageLog &operator=(const MessageLog &) = delete;
+
+    // never blocks, source must outlive the log
+    void push(Severity severity, VkDebugUtilsMessageTypeFlagsEXT type, int32_t messageId, const char *idName, const char *message,
+              const char *source);
+    // waits until everything pushed so far has been printed
+    void flush();
+
+    uint64_t count(Severity severity) const {
+        return bySeverity[static_cast<uint32_t>(severity)].load(std::memory_order_relaxed);
+    }
+    MessageCounts counts() const;
+    void printCounts(std::ostream &out) const;
+
+private:
+    struct Message {
+        Severity severity;
+        VkDebugUtilsMessageTypeFlagsEXT type;
+        int32_t messageId;
+        std::string idName;
+        std::string text;
+        const char *source;
+    };
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        Message message;
+    };
+    struct IdState {
+        std::string idName;
+        int32_t messageId = 0;
+        size_t lastTextHash = 0;
+        std::chrono::steady_clock::time_point windowStart;
+        uint32_t printedInWindow = 0;
+        uint64_t suppressedInWindow = 0;
+        uint64_t suppressed = 0;
+    };
+
+    std::ostream &out;
+    uint32_t maxPerSecond;
+    uint32_t maxQueued;
+
+    // producers exchange the head, only the logger thread touches the tail
+    std::atomic<Node *> head;
+    Node *tail;
+    std::atomic<uint32_t> queued{0};
+    // bumped on every push, the logger sleeps on it
+    std::atomic<uint32_t> published{0};
+    std::atomic<uint64_t> pushed{0};
+    std::atomic<uint64_t> processed{0};
+    std::atomic<bool> stopping{false};
+
+    std::atomic<uint64_t> bySeverity[severityCount] = {};
+    std::atomic<uint64_t> printed{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> rateLimited{0};
+    std::atomic<uint64_t> dropped{0};
+
+    // logger thread only
+    std::unordered_map<int64_t, IdState> ids;
+    std::thread logger;
+
+    Node *pop();
+    void loggerLoop();
+    void handle(const Message &message);
+    void reportSuppressed(IdState &state, std::chrono::steady_clock::time_point now);
+};
+
+// the log the debug callback writes to, started on first use
+MessageLog &messageLog();
+} // namespace vkValidate
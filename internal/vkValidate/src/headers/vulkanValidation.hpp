@@ -20,10 +20,12 @@ const bool enable = false;
 const bool enable = true;
 #endif
 
-void checkRequiredAreSupportedExtensions();
-void addValidation(VkInstanceCreateInfo &createInfo, VkDebugUtilsMessengerCreateInfoEXT &ref);
+// enumerates the instance extensions once, throws naming the first one that is missing
+void checkRequiredAreSupportedExtensions(const std::vector<const char *> &required);
+// extensions must outlive the vkCreateInstance call, createInfo only keeps a pointer to them
+void addValidation(VkInstanceCreateInfo &createInfo, VkDebugUtilsMessengerCreateInfoEXT &ref, const std::vector<const char *> &extensions);
 bool checkValidationLayerSupport();
-std::vector<const char *> getRequiredExtensions();
+std::vector<const char *> getRequiredExtensions(bool headless = false);
 VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
     VkDebugUtilsMessageTypeFlagsEXT messageType,
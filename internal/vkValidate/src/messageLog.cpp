@@ -0,0 +1,212 @@
+#include "headers/messageLog.hpp"
+#include <functional>
+#include <iostream>
+
+using namespace std;
+
+namespace vkValidate {
+
+namespace {
+const char *severityName(Severity severity) {
+    switch (severity) {
+    case Severity::Verbose:
+        return "verbose";
+    case Severity::Info:
+        return "info";
+    case Severity::Warning:
+        return "warning";
+    case Severity::Error:
+        return "error";
+    }
+    return "unknown";
+}
+
+const char *typeName(VkDebugUtilsMessageTypeFlagsEXT type) {
+    if (type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) {
+        return "performance";
+    }
+    if (type & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) {
+        return "validation";
+    }
+    return "general";
+}
+} // namespace
+
+Severity toSeverity(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+    if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        return Severity::Error;
+    }
+    if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        return Severity::Warning;
+    }
+    if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+        return Severity::Info;
+    }
+    return Severity::Verbose;
+}
+
+MessageLog::MessageLog(ostream &out, uint32_t maxPerSecond, uint32_t maxQueued)
+    : out(out), maxPerSecond(maxPerSecond), maxQueued(maxQueued) {
+    // the queue always holds one node, the last one popped
+    Node *stub = new Node{};
+    head.store(stub, memory_order_relaxed);
+    tail = stub;
+    logger = thread{&MessageLog::loggerLoop, this};
+}
+
+MessageLog::~MessageLog() {
+    stopping.store(true);
+    published.fetch_add(1);
+    published.notify_one();
+    logger.join();
+    delete tail;
+}
+
+void MessageLog::push(Severity severity, VkDebugUtilsMessageTypeFlagsEXT type, int32_t messageId, const char *idName,
+                      const char *message, const char *source) {
+    bySeverity[static_cast<uint32_t>(severity)].fetch_add(1, memory_order_relaxed);
+    if (queued.fetch_add(1, memory_order_relaxed) >= maxQueued) {
+        queued.fetch_sub(1, memory_order_relaxed);
+        dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    Node *node = new Node{};
+    node->message = {severity, type, messageId, idName != nullptr ? idName : "", message != nullptr ? message : "", source};
+    pushed.fetch_add(1, memory_order_relaxed);
+    // link after the exchange, the logger sees a half linked node as an empty queue until then
+    Node *previous = head.exchange(node, memory_order_acq_rel);
+    previous->next.store(node, memory_order_release);
+
+    published.fetch_add(1, memory_order_release);
+    published.notify_one();
+}
+
+MessageLog::Node *MessageLog::pop() {
+    Node *next = tail->next.load(memory_order_acquire);
+    if (next == nullptr) {
+        return nullptr;
+    }
+    // the popped node becomes the new stub, its message is moved out by the caller
+    delete tail;
+    tail = next;
+    return next;
+}
+
+void MessageLog::flush() {
+    uint64_t target = pushed.load(memory_order_acquire);
+    while (processed.load(memory_order_acquire) < target) {
+        this_thread::yield();
+    }
+}
+
+void MessageLog::loggerLoop() {
+    while (true) {
+        uint32_t seen = published.load(memory_order_acquire);
+        bool any = false;
+        while (Node *node = pop()) {
+            Message message = std::move(node->message);
+            queued.fetch_sub(1, memory_order_relaxed);
+            handle(message);
+            processed.fetch_add(1, memory_order_release);
+            any = true;
+        }
+        if (any) {
+            // one flush per batch instead of one per message
+            out.flush();
+            continue;
+        }
+
+        auto now = chrono::steady_clock::now();
+        for (auto &[id, state] : ids) {
+            if (state.suppressedInWindow > 0 && now - state.windowStart >= chrono::seconds{1}) {
+                reportSuppressed(state, now);
+            }
+        }
+        if (stopping.load()) {
+            break;
+        }
+        // a push still linking its node bumps published afterwards, so this wakes up for it
+        published.wait(seen, memory_order_acquire);
+    }
+
+    for (auto &[id, state] : ids) {
+        if (state.suppressed > 0) {
+            out << "validation id " << state.idName << " (" << state.messageId << ") : " << state.suppressed << " messages not printed"
+                << '\n';
+        }
+    }
+    out.flush();
+}
+
+void MessageLog::handle(const Message &message) {
+    // messages without an id are told apart by their id name
+    int64_t key = message.messageId != 0 ? message.messageId : static_cast<int64_t>(hash<string>{}(message.idName)) | (1ll << 62);
+    auto [it, inserted] = ids.try_emplace(key);
+    IdState &state = it->second;
+    size_t textHash = hash<string>{}(message.text);
+    auto now = chrono::steady_clock::now();
+    if (inserted) {
+        state.idName = message.idName;
+        state.messageId = message.messageId;
+        state.windowStart = now;
+    } else if (textHash == state.lastTextHash) {
+        duplicates.fetch_add(1, memory_order_relaxed);
+        state.suppressed++;
+        return;
+    }
+
+    if (now - state.windowStart >= chrono::seconds{1}) {
+        reportSuppressed(state, now);
+    }
+    if (state.printedInWindow >= maxPerSecond) {
+        rateLimited.fetch_add(1, memory_order_relaxed);
+        state.suppressedInWindow++;
+        state.suppressed++;
+        return;
+    }
+
+    state.printedInWindow++;
+    state.lastTextHash = textHash;
+    printed.fetch_add(1, memory_order_relaxed);
+    out << "validation layer (" << message.source << ", " << severityName(message.severity) << ", " << typeName(message.type)
+        << "): " << message.text << '\n';
+}
+
+void MessageLog::reportSuppressed(IdState &state, chrono::steady_clock::time_point now) {
+    if (state.suppressedInWindow > 0) {
+        out << "validation id " << state.idName << " (" << state.messageId << ") : " << state.suppressedInWindow
+            << " more in the last second" << '\n';
+    }
+    state.suppressedInWindow = 0;
+    state.printedInWindow = 0;
+    state.windowStart = now;
+}
+
+MessageCounts MessageLog::counts() const {
+    MessageCounts counts;
+    for (uint32_t i = 0; i < severityCount; i++) {
+        counts.bySeverity[i] = bySeverity[i].load(memory_order_relaxed);
+    }
+    counts.printed = printed.load(memory_order_relaxed);
+    counts.duplicates = duplicates.load(memory_order_relaxed);
+    counts.rateLimited = rateLimited.load(memory_order_relaxed);
+    counts.dropped = dropped.load(memory_order_relaxed);
+    return counts;
+}
+
+void MessageLog::printCounts(ostream &out) const {
+    MessageCounts counts = this->counts();
+    out << "validation messages :";
+    for (uint32_t i = 0; i < severityCount; i++) {
+        out << " " << counts.bySeverity[i] << " " << severityName(static_cast<Severity>(i)) << ",";
+    }
+    out << " " << counts.printed << " printed, " << counts.duplicates << " duplicates, " << counts.rateLimited << " rate limited, "
+        << counts.dropped << " dropped" << endl;
+}
+
+MessageLog &messageLog() {
+    static MessageLog log{cerr};
+    return log;
+}
+} // namespace vkValidate
@@ -1,4 +1,5 @@
 #include "headers/vulkanValidation.hpp"
+#include "headers/messageLog.hpp"
 #include <cstring>
 #include <vector>
 
@@ -8,7 +9,7 @@ const bool logSupported = false;
 
 namespace vkValidate {
 
-void checkRequiredAreSupportedExtensions() {
+void checkRequiredAreSupportedExtensions(const std::vector<const char *> &required) {
     // get supported extensions
     uint32_t extensionCount = 0;
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -23,24 +24,18 @@ void checkRequiredAreSupportedExtensions() {
         }
     }
 
-    uint32_t required_extrensions_count = 0;
-    const char **glfwNeededExtensions = glfwGetRequiredInstanceExtensions(&required_extrensions_count);
-
     // check if all the required extensions are supported!
-    // cout << "Check if all required extensions are supported : " << required_extrensions_count << endl;
-    for (uint16_t i = 0; i < required_extrensions_count; i++) {
+    for (const char *name : required) {
         bool supported = false;
-        //cout << "\t" << glfwNeededExtensions[i] << endl;
         for (const auto &e : extensions) {
-            if (strcmp(glfwNeededExtensions[i], e.extensionName) == 0) {
-                //cout << "\tsupported : " << e.extensionName << endl;
+            if (strcmp(name, e.extensionName) == 0) {
                 supported = true;
                 break;
             }
         }
 
         if (!supported) {
-            throw std::runtime_error(string{glfwNeededExtensions[i]} + " is need but not supported!");
+            throw std::runtime_error(string{name} + " is need but not supported!");
         }
     }
 }
@@ -81,8 +76,7 @@ void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &create
     createInfo.pUserData = (void *)(name);
 }
 
-void addValidation(VkInstanceCreateInfo &createInfo, VkDebugUtilsMessengerCreateInfoEXT &debugCreateInfo) {
-    auto extensions = vkValidate::getRequiredExtensions();
+void addValidation(VkInstanceCreateInfo &createInfo, VkDebugUtilsMessengerCreateInfoEXT &debugCreateInfo, const std::vector<const char *> &extensions) {
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -103,12 +97,14 @@ void addValidation(VkInstanceCreateInfo &createInfo, VkDebugUtilsMessengerCreate
     }
 }
 
-std::vector<const char *> getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    vector<const char *> extensions{glfwExtensions, glfwExtensions + glfwExtensionCount};
+std::vector<const char *> getRequiredExtensions(bool headless) {
+    vector<const char *> extensions;
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enable) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -123,7 +119,9 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
     void *pUserData) {
 
-    std::cerr << "validation layer (" << (char *)pUserData << "): " << pCallbackData->pMessage << std::endl;
+    // called on driver threads, printing happens on the logger thread
+    messageLog().push(toSeverity(messageSeverity), messageType, pCallbackData->messageIdNumber, pCallbackData->pMessageIdName,
+                      pCallbackData->pMessage, (const char *)pUserData);
 
     return VK_FALSE;
 }
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "include/fullscreen.glsl"
+
+layout(location = 0) out vec2 outUV;
+
+// one triangle covering the screen, no vertex buffer needed
+void main() {
+    FullscreenVertex vertex;
+    vertex.uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    outUV = vertex.uv;
+    gl_Position = vec4(vertex.uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,16 @@
+// the bindless table of vkDescriptors::BindlessTable, set 0 of every pipeline created with its layout
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D bindlessTextures[];
+
+// storage buffers are declared where they are used, any number of block types may alias binding 1 :
+// layout(std430, set = 0, binding = 1) readonly buffer DrawRecords { DrawRecord records[]; } drawRecords[];
+
+// vkDescriptors::DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint drawDataBuffer;
+    uint drawIndex;
+} draw;
+
+// slots differ between invocations of one draw call or dispatch, they have to be marked
+#define bindlessTexture(slot) bindlessTextures[nonuniformEXT(slot)]
@@ -0,0 +1,17 @@
+// vkCulling::CullInstance
+struct CullInstance {
+    vec4 sphere;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint instanceIndex;
+};
+
+// VkDrawIndexedIndirectCommand, 20 bytes apart in std430
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
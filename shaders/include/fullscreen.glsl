@@ -0,0 +1,4 @@
+// shared between the fullscreen triangle stages
+struct FullscreenVertex {
+    vec2 uv;
+};
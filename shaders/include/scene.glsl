@@ -0,0 +1,15 @@
+// world matrices of vkScene::TransformStore, GEngine::getInstanceBuffer of the frame
+layout(std430, set = 0, binding = 0) readonly buffer Transforms {
+    mat4 world[];
+};
+
+layout(push_constant) uniform Camera {
+    mat4 viewProjection;
+} camera;
+
+// mesh vertices at binding 0
+layout(location = 0) in vec3 inPosition;
+
+vec4 scenePosition(uint node) {
+    return camera.viewProjection * world[node] * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "include/scene.glsl"
+
+layout(location = 0) out vec3 outColor;
+
+// drawn by vkCulling::DrawCuller, the transform node is the first instance of every draw
+void main() {
+    gl_Position = scenePosition(uint(gl_InstanceIndex));
+    outColor = inPosition * 0.5 + 0.5;
+}
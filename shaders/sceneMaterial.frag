@@ -0,0 +1,13 @@
+#version 450
+
+// bound by vkDraw::DrawQueue as the set of the material
+layout(set = 1, binding = 0) uniform Material {
+    vec4 color;
+} material;
+
+layout(location = 0) in vec3 inColor;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(inColor * material.color.rgb, material.color.a);
+}
@@ -0,0 +1,14 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "include/scene.glsl"
+
+// vkDraw::DrawQueue::instanceBinding, one transform node per instance
+layout(location = 1) in uint inNode;
+
+layout(location = 0) out vec3 outColor;
+
+// drawn by vkDraw::DrawQueue, the instances of a batch are consecutive in its instance buffer
+void main() {
+    gl_Position = scenePosition(inNode);
+    outColor = inPosition * 0.5 + 0.5;
+}
@@ -1,9 +1,93 @@
 #include "headers/engine.hpp"
+#include "headers/sessionServer.hpp"
+#include <cstring>
 
 using namespace std;
 
-int main() {
-    GEngine app{800, 600};
+int main(int argc, char **argv) {
+    vkProfiler::setThreadName("main");
+    EngineConfig config{};
+    uint32_t sessionCount = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            config.headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config.headlessFrameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            config.preferredDevice = argv[++i];
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            config.framesInFlight = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--low-latency") == 0) {
+            config.presentPolicy = vkWSIHelper::PresentPolicy::LowLatency;
+        } else if (strcmp(argv[i], "--throughput") == 0) {
+            config.presentPolicy = vkWSIHelper::PresentPolicy::Throughput;
+        } else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            config.pipelineCachePath = argv[++i];
+        } else if (strcmp(argv[i], "--no-pipeline-cache") == 0) {
+            config.pipelineCachePath.clear();
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            config.shaderArchivePath = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            config.workerThreads = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--no-host-import") == 0) {
+            config.importHostMemory = false;
+        } else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            config.textureBudgetMiB = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            config.tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--cpu-culling") == 0) {
+            config.cpuCulling = true;
+        } else if (strcmp(argv[i], "--max-draws") == 0 && i + 1 < argc) {
+            config.maxDrawInstances = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            config.output.path = argv[++i];
+        } else if (strcmp(argv[i], "--output-fd") == 0 && i + 1 < argc) {
+            config.output.fd = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output-format") == 0 && i + 1 < argc) {
+            if (!vkOutput::parseFormat(argv[++i], config.output.format)) {
+                cerr << "unknown output format " << argv[i] << ", expected raw, ppm or png" << endl;
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--readback-slots") == 0 && i + 1 < argc) {
+            config.output.slots = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--encoders") == 0 && i + 1 < argc) {
+            config.output.encoderThreads = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--drop-frames") == 0) {
+            config.output.dropWhenBusy = true;
+        } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessionCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+    }
+    // frames streamed to stdout would be interleaved with the log otherwise
+    if (config.output.path == "-" || config.output.fd == 1) {
+        cout.rdbuf(cerr.rdbuf());
+    }
+
+    // several sessions render on one shared device, each with its own targets
+    if (sessionCount > 1) {
+        try {
+            SessionServer server{contextConfigFor(config)};
+            for (uint32_t s = 0; s < sessionCount; s++) {
+                EngineConfig sessionConfig = config;
+                // one output can not take the frames of several sessions, only the first one is read back
+                if (s > 0) {
+                    sessionConfig.output = {};
+                }
+                server.addSession(800, 600, sessionConfig);
+            }
+            server.run();
+            server.printStats(cout);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!config.tracePath.empty() && !vkProfiler::exportChromeTrace(config.tracePath)) {
+            cerr << "failed to write trace " << config.tracePath << endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    GEngine app{800, 600, config};
 
 #ifdef NDEBUG
     cout << "realse mode" << endl;
@@ -19,4 +103,4 @@ int main() {
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,332 @@
+#include "headers/meshFormat.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Vec3 {
+    float x = 0, y = 0, z = 0;
+};
+
+Vec3 operator-(Vec3 a, Vec3 b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+Vec3 operator+(Vec3 a, Vec3 b) {
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+Vec3 cross(Vec3 a, Vec3 b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+float dot(Vec3 a, Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+Vec3 normalize(Vec3 v) {
+    float length = sqrt(dot(v, v));
+    return length > 0.0f ? Vec3{v.x / length, v.y / length, v.z / length} : Vec3{};
+}
+Vec3 position(const meshFormat::Vertex &vertex) {
+    return {vertex.position[0], vertex.position[1], vertex.position[2]};
+}
+
+struct Mesh {
+    vector<meshFormat::Vertex> vertices;
+    vector<uint32_t> indices;
+};
+
+// obj index, 1 based, negative counts from the end, 0 when missing
+int resolveIndex(int index, size_t count) {
+    return index < 0 ? static_cast<int>(count) + index + 1 : index;
+}
+
+// resolved position / uv / normal indices of a face corner
+using Corner = array<int, 3>;
+
+struct CornerHash {
+    size_t operator()(const Corner &corner) const {
+        uint64_t packed = (uint64_t{static_cast<uint32_t>(corner[0])} << 32) ^ (uint64_t{static_cast<uint32_t>(corner[1])} << 16) ^
+                          static_cast<uint32_t>(corner[2]);
+        return hash<uint64_t>{}(packed);
+    }
+};
+
+bool loadObj(const filesystem::path &path, Mesh &mesh) {
+    ifstream in{path};
+    if (!in.is_open()) {
+        cerr << "failed to open " << path << endl;
+        return false;
+    }
+
+    vector<Vec3> positions, normals;
+    vector<array<float, 2>> uvs;
+    // one vertex per distinct position / uv / normal combination, by resolved indices since relative ones
+    // name another vertex after every v / vt / vn line
+    unordered_map<Corner, uint32_t, CornerHash> vertexIds;
+    bool hasNormals = true;
+
+    string line;
+    vector<uint32_t> polygon;
+    while (getline(in, line)) {
+        istringstream tokens{line};
+        string type;
+        tokens >> type;
+        if (type == "v") {
+            Vec3 p;
+            tokens >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        } else if (type == "vn") {
+            Vec3 n;
+            tokens >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        } else if (type == "vt") {
+            array<float, 2> uv{};
+            tokens >> uv[0] >> uv[1];
+            uvs.push_back(uv);
+        } else if (type == "f") {
+            polygon.clear();
+            string corner;
+            while (tokens >> corner) {
+                int p = 0, t = 0, n = 0;
+                if (sscanf(corner.c_str(), "%d/%d/%d", &p, &t, &n) != 3 && sscanf(corner.c_str(), "%d//%d", &p, &n) != 2 &&
+                    sscanf(corner.c_str(), "%d/%d", &p, &t) != 2 && sscanf(corner.c_str(), "%d", &p) != 1) {
+                    cerr << "bad face corner " << corner << " in " << path << endl;
+                    return false;
+                }
+                p = resolveIndex(p, positions.size());
+                t = resolveIndex(t, uvs.size());
+                n = resolveIndex(n, normals.size());
+                if (p <= 0 || p > static_cast<int>(positions.size()) || t < 0 || t > static_cast<int>(uvs.size()) || n < 0 ||
+                    n > static_cast<int>(normals.size())) {
+                    cerr << "face corner " << corner << " out of range in " << path << endl;
+                    return false;
+                }
+                auto found = vertexIds.find({p, t, n});
+                if (found != vertexIds.end()) {
+                    polygon.push_back(found->second);
+                    continue;
+                }
+
+                meshFormat::Vertex vertex{};
+                memcpy(vertex.position, &positions[p - 1], sizeof(vertex.position));
+                if (t > 0) {
+                    memcpy(vertex.uv, uvs[t - 1].data(), sizeof(vertex.uv));
+                }
+                if (n > 0) {
+                    memcpy(vertex.normal, &normals[n - 1], sizeof(vertex.normal));
+                } else {
+                    hasNormals = false;
+                }
+                uint32_t id = static_cast<uint32_t>(mesh.vertices.size());
+                mesh.vertices.push_back(vertex);
+                vertexIds.emplace(Corner{p, t, n}, id);
+                polygon.push_back(id);
+            }
+            // fan triangulation, obj polygons are convex
+            for (size_t i = 2; i < polygon.size(); i++) {
+                mesh.indices.insert(mesh.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+            }
+        }
+    }
+
+    if (!hasNormals) {
+        // area weighted smooth normals
+        vector<Vec3> accumulated(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            Vec3 origin = position(mesh.vertices[a]);
+            Vec3 normal = cross(position(mesh.vertices[b]) - origin, position(mesh.vertices[c]) - origin);
+            for (uint32_t v : {a, b, c}) {
+                accumulated[v] = accumulated[v] + normal;
+            }
+        }
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            Vec3 normal = normalize(accumulated[i]);
+            memcpy(mesh.vertices[i].normal, &normal, sizeof(mesh.vertices[i].normal));
+        }
+    }
+    return true;
+}
+
+meshFormat::Bounds computeBounds(const vector<meshFormat::Vertex> &vertices, const uint32_t *ids, size_t count) {
+    meshFormat::Bounds bounds{};
+    if (count == 0) {
+        return bounds;
+    }
+    Vec3 low = position(vertices[ids[0]]), high = low;
+    for (size_t i = 1; i < count; i++) {
+        Vec3 p = position(vertices[ids[i]]);
+        low = {min(low.x, p.x), min(low.y, p.y), min(low.z, p.z)};
+        high = {max(high.x, p.x), max(high.y, p.y), max(high.z, p.z)};
+    }
+    Vec3 center{(low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f};
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        Vec3 offset = position(vertices[ids[i]]) - center;
+        radiusSquared = max(radiusSquared, dot(offset, offset));
+    }
+    memcpy(bounds.center, &center, sizeof(bounds.center));
+    bounds.radius = sqrt(radiusSquared);
+    memcpy(bounds.min, &low, sizeof(bounds.min));
+    memcpy(bounds.max, &high, sizeof(bounds.max));
+    return bounds;
+}
+
+struct Meshlets {
+    vector<meshFormat::Meshlet> meshlets;
+    vector<uint32_t> vertices;
+    vector<uint8_t> triangles;
+};
+
+// greedy in index order, a meshlet is closed once the next triangle would overflow it
+Meshlets buildMeshlets(const Mesh &mesh) {
+    Meshlets result;
+    vector<uint32_t> localIndex(mesh.vertices.size(), ~0u);
+    meshFormat::Meshlet current{};
+
+    auto close = [&]() {
+        if (current.triangleCount == 0) {
+            return;
+        }
+        const uint32_t *ids = result.vertices.data() + current.vertexOffset;
+        meshFormat::Bounds bounds = computeBounds(mesh.vertices, ids, current.vertexCount);
+        memcpy(current.center, bounds.center, sizeof(current.center));
+        current.radius = bounds.radius;
+
+        Vec3 axis{};
+        vector<Vec3> triangleNormals;
+        for (uint32_t t = 0; t < current.triangleCount; t++) {
+            const uint8_t *corners = &result.triangles[(current.triangleOffset + t) * 3];
+            Vec3 a = position(mesh.vertices[ids[corners[0]]]);
+            Vec3 b = position(mesh.vertices[ids[corners[1]]]);
+            Vec3 c = position(mesh.vertices[ids[corners[2]]]);
+            Vec3 normal = cross(b - a, c - a);
+            axis = axis + normal;
+            triangleNormals.push_back(normalize(normal));
+        }
+        axis = normalize(axis);
+        float minDot = 1.0f;
+        for (const auto &normal : triangleNormals) {
+            minDot = min(minDot, dot(normal, axis));
+        }
+        memcpy(current.coneAxis, &axis, sizeof(current.coneAxis));
+        // sine of the cone spread, normals spread over a half space can always face the viewer
+        current.coneCutoff = minDot <= 0.0f ? 2.0f : sqrt(1.0f - minDot * minDot);
+
+        for (uint32_t i = 0; i < current.vertexCount; i++) {
+            localIndex[ids[i]] = ~0u;
+        }
+        result.meshlets.push_back(current);
+        current = {};
+        current.vertexOffset = static_cast<uint32_t>(result.vertices.size());
+        current.triangleOffset = static_cast<uint32_t>(result.triangles.size() / 3);
+    };
+
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        uint32_t newVertices = 0;
+        for (size_t c = 0; c < 3; c++) {
+            newVertices += localIndex[mesh.indices[i + c]] == ~0u ? 1 : 0;
+        }
+        if (current.vertexCount + newVertices > meshFormat::maxMeshletVertices ||
+            current.triangleCount + 1 > meshFormat::maxMeshletTriangles) {
+            close();
+        }
+        for (size_t c = 0; c < 3; c++) {
+            uint32_t vertex = mesh.indices[i + c];
+            if (localIndex[vertex] == ~0u) {
+                localIndex[vertex] = current.vertexCount++;
+                result.vertices.push_back(vertex);
+            }
+            result.triangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+        }
+        current.triangleCount++;
+    }
+    close();
+    return result;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+// meshConverter <input.obj> <output.pmesh>
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        cerr << "usage : meshConverter <input.obj> <output.pmesh>" << endl;
+        return EXIT_FAILURE;
+    }
+    filesystem::path inputPath = argv[1];
+    filesystem::path outputPath = argv[2];
+
+    Mesh mesh;
+    if (!loadObj(inputPath, mesh)) {
+        return EXIT_FAILURE;
+    }
+    if (mesh.indices.empty()) {
+        cerr << "no triangles in " << inputPath << endl;
+        return EXIT_FAILURE;
+    }
+    Meshlets meshlets = buildMeshlets(mesh);
+
+    meshFormat::MeshHeader header{};
+    header.magic = meshFormat::magic;
+    header.version = meshFormat::version;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+    vector<uint32_t> allVertices(mesh.vertices.size());
+    for (uint32_t i = 0; i < allVertices.size(); i++) {
+        allVertices[i] = i;
+    }
+    header.bounds = computeBounds(mesh.vertices, allVertices.data(), allVertices.size());
+
+    const pair<const void *, uint64_t> streams[meshFormat::StreamCount] = {
+        {mesh.vertices.data(), mesh.vertices.size() * sizeof(meshFormat::Vertex)},
+        {mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)},
+        {meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(meshFormat::Meshlet)},
+        {meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t)},
+        {meshlets.triangles.data(), meshlets.triangles.size()},
+    };
+    uint64_t offset = alignUp(sizeof(header), meshFormat::streamAlignment);
+    header.payloadOffset = offset;
+    for (uint32_t s = 0; s < meshFormat::StreamCount; s++) {
+        header.streams[s] = {offset, streams[s].second};
+        offset = alignUp(offset + streams[s].second, meshFormat::streamAlignment);
+    }
+    uint64_t fileSize = alignUp(offset, meshFormat::fileAlignment);
+    header.payloadSize = offset - header.payloadOffset;
+
+    // same as the shader packer, a running engine may have the old file mapped
+    filesystem::path tmpPath = outputPath;
+    tmpPath += ".tmp";
+    {
+        vector<char> zeros(meshFormat::fileAlignment, 0);
+        ofstream out{tmpPath, ios::binary | ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (uint32_t s = 0; s < meshFormat::StreamCount; s++) {
+            out.write(zeros.data(), static_cast<streamsize>(header.streams[s].offset - static_cast<uint64_t>(out.tellp())));
+            out.write(static_cast<const char *>(streams[s].first), static_cast<streamsize>(streams[s].second));
+        }
+        out.write(zeros.data(), static_cast<streamsize>(fileSize - static_cast<uint64_t>(out.tellp())));
+        if (!out.good()) {
+            cerr << "failed to write " << tmpPath << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    filesystem::rename(tmpPath, outputPath);
+
+    cout << "converted " << inputPath.string() << " : " << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles, "
+         << header.meshletCount << " meshlets, " << fileSize << " bytes" << endl;
+    return EXIT_SUCCESS;
+}
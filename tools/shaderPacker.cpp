@@ -0,0 +1,87 @@
+#include "headers/shaderArchiveFormat.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// shaderPacker <archive> <spirv dir> <file.spv>...
+// entries are named by their path relative to the spirv dir without the .spv extension
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "usage : shaderPacker <archive> <spirv dir> <file.spv>..." << endl;
+        return EXIT_FAILURE;
+    }
+    filesystem::path archivePath = argv[1];
+    filesystem::path spirvDir = argv[2];
+
+    struct Shader {
+        string name;
+        vector<char> code;
+    };
+    vector<Shader> shaders;
+    for (int i = 3; i < argc; i++) {
+        filesystem::path file = argv[i];
+        Shader shader;
+        shader.name = filesystem::relative(file, spirvDir).replace_extension().generic_string();
+        if (shader.name.size() >= shaderArchive::maxNameLength) {
+            cerr << "shader name too long : " << shader.name << endl;
+            return EXIT_FAILURE;
+        }
+        ifstream in{file, ios::binary};
+        if (!in.is_open()) {
+            cerr << "failed to open " << file << endl;
+            return EXIT_FAILURE;
+        }
+        shader.code.assign(istreambuf_iterator<char>{in}, istreambuf_iterator<char>{});
+        if (shader.code.empty() || shader.code.size() % 4 != 0) {
+            cerr << "not a spir-v module : " << file << endl;
+            return EXIT_FAILURE;
+        }
+        shaders.push_back(std::move(shader));
+    }
+    // sorted names keep the archive byte identical between builds and allow binary search at runtime
+    sort(shaders.begin(), shaders.end(), [](const Shader &a, const Shader &b) { return a.name < b.name; });
+
+    shaderArchive::ArchiveHeader header{};
+    header.magic = shaderArchive::magic;
+    header.version = shaderArchive::version;
+    header.entryCount = static_cast<uint32_t>(shaders.size());
+
+    auto align = [](uint64_t value) { return (value + shaderArchive::blobAlignment - 1) & ~(shaderArchive::blobAlignment - 1); };
+    vector<shaderArchive::ArchiveEntry> entries(shaders.size());
+    uint64_t offset = align(sizeof(header) + entries.size() * sizeof(shaderArchive::ArchiveEntry));
+    for (size_t i = 0; i < shaders.size(); i++) {
+        memset(entries[i].name, 0, sizeof(entries[i].name));
+        memcpy(entries[i].name, shaders[i].name.data(), shaders[i].name.size());
+        entries[i].offset = offset;
+        entries[i].size = shaders[i].code.size();
+        offset = align(offset + shaders[i].code.size());
+    }
+
+    // write next to the target and rename, a running engine may have the old archive mapped
+    filesystem::path tmpPath = archivePath;
+    tmpPath += ".tmp";
+    {
+        ofstream out{tmpPath, ios::binary | ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(entries.data()), static_cast<streamsize>(entries.size() * sizeof(shaderArchive::ArchiveEntry)));
+        for (size_t i = 0; i < shaders.size(); i++) {
+            out.seekp(static_cast<streamoff>(entries[i].offset));
+            out.write(shaders[i].code.data(), static_cast<streamsize>(shaders[i].code.size()));
+        }
+        if (!out.good()) {
+            cerr << "failed to write " << tmpPath << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    filesystem::rename(tmpPath, archivePath);
+
+    cout << "packed " << shaders.size() << " shaders into " << archivePath.string() << " (" << offset << " bytes)" << endl;
+    return EXIT_SUCCESS;
+}
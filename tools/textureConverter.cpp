@@ -0,0 +1,143 @@
+#include "headers/textureFormat.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // rgba8
+    vector<uint8_t> pixels;
+};
+
+// binary ppm ( P6, 8 bit ), every image tool can write it
+bool loadPpm(const filesystem::path &path, Image &image) {
+    ifstream in{path, ios::binary};
+    if (!in.is_open()) {
+        cerr << "failed to open " << path << endl;
+        return false;
+    }
+    string magic;
+    uint32_t maxValue = 0;
+    in >> magic;
+    // header fields may be separated by comments
+    auto next = [&](uint32_t &value) {
+        while (in >> ws && in.peek() == '#') {
+            string comment;
+            getline(in, comment);
+        }
+        in >> value;
+    };
+    next(image.width);
+    next(image.height);
+    next(maxValue);
+    in.get();
+    if (magic != "P6" || maxValue != 255 || image.width == 0 || image.height == 0 || !in.good()) {
+        cerr << path << " is not an 8 bit binary ppm" << endl;
+        return false;
+    }
+
+    size_t texels = size_t{image.width} * image.height;
+    vector<uint8_t> rgb(texels * 3);
+    in.read(reinterpret_cast<char *>(rgb.data()), static_cast<streamsize>(rgb.size()));
+    if (!in.good()) {
+        cerr << path << " is truncated" << endl;
+        return false;
+    }
+    image.pixels.resize(texels * 4);
+    for (size_t i = 0; i < texels; i++) {
+        memcpy(&image.pixels[i * 4], &rgb[i * 3], 3);
+        image.pixels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+// 2x2 box filter, odd edges reuse their last row / column
+Image downsample(const Image &source) {
+    Image result;
+    result.width = max(source.width / 2, 1u);
+    result.height = max(source.height / 2, 1u);
+    result.pixels.resize(size_t{result.width} * result.height * 4);
+    for (uint32_t y = 0; y < result.height; y++) {
+        for (uint32_t x = 0; x < result.width; x++) {
+            uint32_t x0 = min(x * 2, source.width - 1), x1 = min(x * 2 + 1, source.width - 1);
+            uint32_t y0 = min(y * 2, source.height - 1), y1 = min(y * 2 + 1, source.height - 1);
+            for (uint32_t c = 0; c < 4; c++) {
+                auto at = [&](uint32_t sx, uint32_t sy) { return uint32_t{source.pixels[(size_t{sy} * source.width + sx) * 4 + c]}; };
+                uint32_t sum = at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1);
+                result.pixels[(size_t{y} * result.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+// textureConverter <input.ppm> <output.ptex>
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        cerr << "usage : textureConverter <input.ppm> <output.ptex>" << endl;
+        return EXIT_FAILURE;
+    }
+    filesystem::path inputPath = argv[1];
+    filesystem::path outputPath = argv[2];
+
+    vector<Image> mips(1);
+    if (!loadPpm(inputPath, mips[0])) {
+        return EXIT_FAILURE;
+    }
+    while ((mips.back().width > 1 || mips.back().height > 1) && mips.size() < textureFormat::maxMipCount) {
+        mips.push_back(downsample(mips.back()));
+    }
+
+    textureFormat::TextureHeader header{};
+    header.magic = textureFormat::magic;
+    header.version = textureFormat::version;
+    header.format = textureFormat::formatRgba8Srgb;
+    header.width = mips[0].width;
+    header.height = mips[0].height;
+    header.mipCount = static_cast<uint32_t>(mips.size());
+
+    // smallest first, so the always resident tail is one contiguous range
+    uint64_t offset = alignUp(sizeof(header), textureFormat::mipAlignment);
+    for (size_t level = mips.size(); level-- > 0;) {
+        header.mips[level] = {offset, mips[level].pixels.size(), mips[level].width, mips[level].height};
+        offset = alignUp(offset + mips[level].pixels.size(), textureFormat::mipAlignment);
+    }
+    uint64_t fileSize = alignUp(offset, textureFormat::fileAlignment);
+
+    // same as the shader packer, a running engine may have the old file mapped
+    filesystem::path tmpPath = outputPath;
+    tmpPath += ".tmp";
+    {
+        vector<char> zeros(textureFormat::fileAlignment, 0);
+        ofstream out{tmpPath, ios::binary | ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (size_t level = mips.size(); level-- > 0;) {
+            out.write(zeros.data(), static_cast<streamsize>(header.mips[level].offset - static_cast<uint64_t>(out.tellp())));
+            out.write(reinterpret_cast<const char *>(mips[level].pixels.data()), static_cast<streamsize>(mips[level].pixels.size()));
+        }
+        out.write(zeros.data(), static_cast<streamsize>(fileSize - static_cast<uint64_t>(out.tellp())));
+        if (!out.good()) {
+            cerr << "failed to write " << tmpPath << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    filesystem::rename(tmpPath, outputPath);
+
+    cout << "converted " << inputPath.string() << " : " << header.width << "x" << header.height << ", " << header.mipCount << " mips, "
+         << fileSize << " bytes" << endl;
+    return EXIT_SUCCESS;
+}